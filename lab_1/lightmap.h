@@ -0,0 +1,684 @@
+#ifndef LIGHTMAP_H
+#define LIGHTMAP_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// 只用到 stbrp_pack_rects，静态实现中其余函数未被调用
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <imgui/imstb_rectpack.h>
+#pragma GCC diagnostic pop
+
+#include "model.h"
+#include "shader.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+const uint32_t LIGHTMAP_CACHE_MAGIC = 0x50414d4c; // "LMAP"
+const uint32_t LIGHTMAP_CACHE_VERSION = 1;
+
+// 模型空间中全部三角形的 BVH，只用于烘焙时的遮挡测试（任意命中即返回）
+class TriangleBVH {
+public:
+    void build(const vector<glm::vec3>& positions)
+    {
+        size_t count = positions.size() / 3;
+        vector<glm::vec3> centers(count);
+        order.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            centers[i] = (positions[3 * i] + positions[3 * i + 1] + positions[3 * i + 2]) / 3.0f;
+            order[i] = unsigned(i);
+        }
+        nodes.clear();
+        if (count == 0) return;
+        nodes.reserve(2 * count);
+        buildNode(positions, centers, 0, unsigned(count));
+
+        // 三角形按叶子顺序保存为一个顶点和两条边，遍历时顺序读取
+        triangles.resize(count * 3);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const glm::vec3* v = &positions[3 * size_t(order[i])];
+            triangles[3 * i] = v[0];
+            triangles[3 * i + 1] = v[1] - v[0];
+            triangles[3 * i + 2] = v[2] - v[0];
+        }
+    }
+
+    // origin 沿 direction 在 (0, maxT) 内是否被任一三角形遮挡
+    bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxT) const
+    {
+        if (nodes.empty()) return false;
+        glm::vec3 inverse = 1.0f / direction;
+        unsigned stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node& node = nodes[stack[--top]];
+            if (!hitBox(node, origin, inverse, maxT)) continue;
+            if (node.count > 0)
+            {
+                for (unsigned i = node.first; i < node.first + node.count; ++i)
+                    if (hitTriangle(i, origin, direction, maxT)) return true;
+                continue;
+            }
+            stack[top++] = node.first;  // 右子节点
+            stack[top++] = unsigned(&node - nodes.data()) + 1; // 左子节点紧跟在父节点之后
+        }
+        return false;
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        glm::vec3 lower, upper;
+        unsigned first;     // 叶子：第一个三角形；内部节点：右子节点
+        unsigned count;     // 叶子的三角形数，内部节点为 0
+    };
+
+    vector<Node> nodes;
+    vector<unsigned> order;
+    vector<glm::vec3> triangles;
+
+    // 按包围盒中心在最长轴上的中位数划分，叶子最多 4 个三角形
+    void buildNode(const vector<glm::vec3>& positions, const vector<glm::vec3>& centers, unsigned begin, unsigned end)
+    {
+        unsigned index = unsigned(nodes.size());
+        nodes.push_back(Node());
+        glm::vec3 lower(numeric_limits<float>::max()), upper(-numeric_limits<float>::max());
+        glm::vec3 centerLower = lower, centerUpper = upper;
+        for (unsigned i = begin; i < end; ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                lower = glm::min(lower, positions[3 * size_t(order[i]) + k]);
+                upper = glm::max(upper, positions[3 * size_t(order[i]) + k]);
+            }
+            centerLower = glm::min(centerLower, centers[order[i]]);
+            centerUpper = glm::max(centerUpper, centers[order[i]]);
+        }
+        nodes[index].lower = lower;
+        nodes[index].upper = upper;
+        if (end - begin <= 4)
+        {
+            nodes[index].first = begin;
+            nodes[index].count = end - begin;
+            return;
+        }
+
+        glm::vec3 extent = centerUpper - centerLower;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        unsigned middle = (begin + end) / 2;
+        nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                    [&](unsigned a, unsigned b) { return centers[a][axis] < centers[b][axis]; });
+        buildNode(positions, centers, begin, middle);
+        unsigned right = unsigned(nodes.size());
+        buildNode(positions, centers, middle, end);
+        nodes[index].first = right;
+        nodes[index].count = 0;
+    }
+
+    static bool hitBox(const Node& node, const glm::vec3& origin, const glm::vec3& inverse, float maxT)
+    {
+        glm::vec3 t0 = (node.lower - origin) * inverse;
+        glm::vec3 t1 = (node.upper - origin) * inverse;
+        glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+        float enter = max(max(tMin.x, tMin.y), max(tMin.z, 0.0f));
+        float exit = min(min(tMax.x, tMax.y), min(tMax.z, maxT));
+        return enter <= exit;
+    }
+
+    // Möller–Trumbore 求交
+    bool hitTriangle(unsigned i, const glm::vec3& origin, const glm::vec3& direction, float maxT) const
+    {
+        const glm::vec3& v0 = triangles[3 * size_t(i)];
+        const glm::vec3& e1 = triangles[3 * size_t(i) + 1];
+        const glm::vec3& e2 = triangles[3 * size_t(i) + 2];
+        glm::vec3 p = glm::cross(direction, e2);
+        float det = glm::dot(e1, p);
+        if (std::abs(det) < 1e-12f) return false;
+        float inv = 1.0f / det;
+        glm::vec3 s = origin - v0;
+        float u = glm::dot(s, p) * inv;
+        if (u < 0.0f || u > 1.0f) return false;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(direction, q) * inv;
+        if (v < 0.0f || u + v > 1.0f) return false;
+        float t = glm::dot(e2, q) * inv;
+        return t > 0.0f && t < maxT;
+    }
+};
+
+// CPU 光照贴图烘焙：为模型的所有网格生成第二套 UV，把环境光遮蔽和一个平行光的直接光照烘焙进一张贴图，
+// 运行时着色只需一次纹理读取。
+// 1. 分块：相邻（共享边）且法线与种子三角形夹角小于 chartAngle 的三角形归入同一块，
+//    每块投影到种子法线的切平面上，跨块共享的顶点被拆开；
+// 2. 装箱：按 texel 密度把各块缩放成矩形，用 stb_rect_pack 排进 atlasSize x atlasSize 的图集，
+//    放不下时降低密度（四周留白占了大半图集时改为把图集加倍）；
+// 3. 烘焙：把三角形光栅化到图集得到每个 texel 的位置和法线，所有核心并行追踪阴影光线和半球上的遮蔽光线，
+//    最后把有效 texel 向外扩张几圈，避免双线性过滤在块边缘取到空白 texel。
+// 结果（顶点拆分方式、第二套 UV 和贴图）按几何与设置的散列写入磁盘，下次启动直接读入
+class LightmapBaker {
+public:
+    int atlasSize = 1024;               // 图集的初始边长
+    int maxAtlasSize = 4096;
+    int padding = 2;                    // 每块四周留白的 texel 数
+    float chartAngle = 45.0f;           // 同一块内法线与种子法线的最大夹角（度）
+    int aoSamples = 32;                 // 每个 texel 的遮蔽光线数
+    float aoDistance = 0.1f;            // 遮蔽光线的最大长度，相对于模型包围盒对角线
+    glm::vec3 sunDirection = glm::vec3(0.4f, 1.0f, 0.3f);  // 指向光源的方向（模型空间）
+    glm::vec3 sunColor = glm::vec3(0.8f);
+    glm::vec3 ambientColor = glm::vec3(0.35f);
+    int threads = 0;                    // 0 表示使用全部硬件线程
+
+    unsigned int texture = 0;
+    int size = 0;                       // 实际使用的图集边长
+
+    // 为 model 生成第二套 UV 并烘焙贴图。cachePath 非空时先尝试读入缓存，失败后重新烘焙并写回
+    bool bake(Model& model, const string& cachePath = "")
+    {
+        for (const Mesh& mesh : model.meshes)
+        {
+            if (mesh.vertices.empty() && mesh.indexCount > 0)
+            {
+                cout << "lightmap: mesh data was not kept (load the model with keepData)" << endl;
+                return false;
+            }
+        }
+        auto start = chrono::steady_clock::now();
+        uint64_t key = cacheKey(model);
+        vector<Layout> layouts;
+        vector<glm::vec3> texels;
+        bool cached = !cachePath.empty() && loadCache(cachePath, key, model, layouts, texels);
+        if (!cached)
+        {
+            if (!buildLayouts(model, layouts)) return false;
+            texels = render(model, layouts);
+            if (!cachePath.empty() && !saveCache(cachePath, key, layouts, texels))
+                cout << "failed to write lightmap cache " << cachePath << endl;
+        }
+        for (size_t m = 0; m < model.meshes.size(); ++m)
+            model.meshes[m].setLightmapLayout(layouts[m].remap, layouts[m].indices, layouts[m].coords);
+        upload(texels);
+
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "lightmap " << size << "x" << size << (cached ? " loaded from " + cachePath : " baked")
+             << " in " << ms << " ms" << endl;
+        return true;
+    }
+
+    // 把贴图绑定到 unit 号纹理单元，设置着色器中的 lightmap 采样器
+    void bind(Shader& shader, int unit = 15) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        shader.setInt("lightmap", unit);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    // 一个网格拆分后的顶点：新顶点 i 复制原顶点 remap[i]，第二套 UV 为 coords[i]
+    struct Layout {
+        vector<unsigned int> remap;
+        vector<unsigned int> indices;
+        vector<glm::vec2> coords;
+    };
+
+    // 同一块的三角形（网格内编号）和投影平面
+    struct Chart {
+        unsigned mesh;
+        vector<unsigned> triangles;
+        glm::vec3 axisU, axisV;
+        glm::vec2 lower, upper;
+    };
+
+    // 几何（位置、法线、索引）与影响结果的设置共同决定缓存是否有效，哈希与网格缓存（meshcache.h）共用
+    uint64_t cacheKey(const Model& model) const
+    {
+        uint64_t h = hashBytes(&LIGHTMAP_CACHE_VERSION, sizeof(LIGHTMAP_CACHE_VERSION));
+        for (const Mesh& mesh : model.meshes)
+        {
+            for (const Vertex& v : mesh.vertices)
+            {
+                h = hashBytes(&v.Position, sizeof(v.Position), h);
+                h = hashBytes(&v.Normal, sizeof(v.Normal), h);
+            }
+            h = hashBytes(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int), h);
+        }
+        float settings[15] = {float(atlasSize), float(maxAtlasSize), float(padding), chartAngle, float(aoSamples), aoDistance,
+                              sunDirection.x, sunDirection.y, sunDirection.z, sunColor.x, sunColor.y, sunColor.z,
+                              ambientColor.x, ambientColor.y, ambientColor.z};
+        return hashBytes(settings, sizeof(settings), h);
+    }
+
+    static glm::vec3 position(const Mesh& mesh, unsigned triangle, int k)
+    {
+        return mesh.vertices[mesh.indices[3 * size_t(triangle) + k]].Position;
+    }
+
+    // 按共享边和法线夹角把每个网格的三角形分块
+    vector<Chart> buildCharts(const Model& model) const
+    {
+        struct PositionHash {
+            size_t operator()(const glm::vec3& p) const
+            {
+                return size_t(hashBytes(&p, sizeof(p)));
+            }
+        };
+        float cosLimit = cos(glm::radians(chartAngle));
+        vector<Chart> charts;
+        for (unsigned m = 0; m < model.meshes.size(); ++m)
+        {
+            const Mesh& mesh = model.meshes[m];
+            size_t count = mesh.indices.size() / 3;
+
+            // 顶点常按面重复（OBJ 导入时不合并），按位置焊接后再找共享边
+            unordered_map<glm::vec3, unsigned, PositionHash> welded;
+            vector<unsigned> weld(mesh.vertices.size());
+            for (size_t i = 0; i < mesh.vertices.size(); ++i)
+            {
+                glm::vec3 p = mesh.vertices[i].Position + glm::vec3(0.0f); // 把 -0 归为 +0
+                weld[i] = welded.emplace(p, unsigned(welded.size())).first->second;
+            }
+            unordered_map<uint64_t, vector<unsigned>> edges;
+            vector<glm::vec3> normals(count);
+            for (size_t t = 0; t < count; ++t)
+            {
+                glm::vec3 n = glm::cross(position(mesh, unsigned(t), 1) - position(mesh, unsigned(t), 0),
+                                         position(mesh, unsigned(t), 2) - position(mesh, unsigned(t), 0));
+                float length = glm::length(n);
+                normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+                for (int k = 0; k < 3; ++k)
+                {
+                    uint64_t a = weld[mesh.indices[3 * t + k]], b = weld[mesh.indices[3 * t + (k + 1) % 3]];
+                    edges[min(a, b) << 32 | max(a, b)].push_back(unsigned(t));
+                }
+            }
+
+            vector<char> assigned(count, 0);
+            vector<unsigned> queue;
+            for (size_t seed = 0; seed < count; ++seed)
+            {
+                if (assigned[seed]) continue;
+                Chart chart;
+                chart.mesh = m;
+                glm::vec3 n = normals[seed];
+                queue.assign(1, unsigned(seed));
+                assigned[seed] = 1;
+                for (size_t q = 0; q < queue.size(); ++q)
+                {
+                    unsigned t = queue[q];
+                    chart.triangles.push_back(t);
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        uint64_t a = weld[mesh.indices[3 * size_t(t) + k]], b = weld[mesh.indices[3 * size_t(t) + (k + 1) % 3]];
+                        for (unsigned neighbor : edges[min(a, b) << 32 | max(a, b)])
+                        {
+                            if (assigned[neighbor] || glm::dot(normals[neighbor], n) < cosLimit) continue;
+                            assigned[neighbor] = 1;
+                            queue.push_back(neighbor);
+                        }
+                    }
+                }
+                glm::vec3 helper = std::abs(n.x) > 0.5f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                chart.axisU = glm::normalize(glm::cross(n, helper));
+                chart.axisV = glm::cross(n, chart.axisU);
+                chart.lower = glm::vec2(numeric_limits<float>::max());
+                chart.upper = glm::vec2(-numeric_limits<float>::max());
+                for (unsigned t : chart.triangles)
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        glm::vec3 p = position(mesh, t, k);
+                        glm::vec2 uv(glm::dot(p, chart.axisU), glm::dot(p, chart.axisV));
+                        chart.lower = glm::min(chart.lower, uv);
+                        chart.upper = glm::max(chart.upper, uv);
+                    }
+                charts.push_back(std::move(chart));
+            }
+        }
+        return charts;
+    }
+
+    // 分块、装箱，得到每个网格拆分后的顶点和第二套 UV
+    bool buildLayouts(const Model& model, vector<Layout>& layouts)
+    {
+        vector<Chart> charts = buildCharts(model);
+        if (charts.empty()) return false;
+        double area = 0.0;
+        for (const Chart& chart : charts)
+        {
+            glm::vec2 extent = chart.upper - chart.lower;
+            area += double(extent.x) * extent.y;
+        }
+
+        // 初始密度让各块的投影矩形约占图集的一半
+        size = atlasSize;
+        float density = area > 0.0 ? float(sqrt(0.5 * double(size) * size / area)) : 1.0f;
+        vector<stbrp_rect> rects(charts.size());
+        for (int attempt = 0;; ++attempt)
+        {
+            double paddingArea = 0.0;
+            bool fits = true;
+            for (size_t c = 0; c < charts.size(); ++c)
+            {
+                glm::vec2 extent = (charts[c].upper - charts[c].lower) * density;
+                rects[c].id = int(c);
+                rects[c].w = int(ceil(extent.x)) + 1 + 2 * padding;
+                rects[c].h = int(ceil(extent.y)) + 1 + 2 * padding;
+                paddingArea += double(rects[c].w) * rects[c].h - double(extent.x) * extent.y;
+                fits = fits && rects[c].w <= size && rects[c].h <= size;
+            }
+            if (fits)
+            {
+                stbrp_context context;
+                vector<stbrp_node> nodes(size);
+                stbrp_init_target(&context, size, size, nodes.data(), int(nodes.size()));
+                if (stbrp_pack_rects(&context, rects.data(), int(rects.size()))) break;
+            }
+            if (attempt >= 64)
+            {
+                cout << "lightmap: failed to pack " << charts.size() << " charts" << endl;
+                return false;
+            }
+            if (paddingArea > 0.5 * double(size) * size && size < maxAtlasSize)
+            {
+                size *= 2;
+                density *= 2.0f;
+            }
+            else density *= 0.9f;
+        }
+
+        // 每块的顶点单独复制一份，块内共享的顶点仍然共享
+        layouts.assign(model.meshes.size(), Layout());
+        vector<vector<unsigned>> remapped(model.meshes.size());
+        for (size_t m = 0; m < model.meshes.size(); ++m)
+            layouts[m].indices.resize(model.meshes[m].indices.size());
+        for (size_t c = 0; c < charts.size(); ++c)
+        {
+            const Chart& chart = charts[c];
+            const Mesh& mesh = model.meshes[chart.mesh];
+            Layout& layout = layouts[chart.mesh];
+            glm::vec2 origin = glm::vec2(rects[c].x + padding, rects[c].y + padding) + glm::vec2(0.5f);
+            unordered_map<unsigned, unsigned> local;
+            for (unsigned t : chart.triangles)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    unsigned source = mesh.indices[3 * size_t(t) + k];
+                    auto inserted = local.emplace(source, unsigned(layout.remap.size()));
+                    if (inserted.second)
+                    {
+                        glm::vec3 p = mesh.vertices[source].Position;
+                        glm::vec2 uv(glm::dot(p, chart.axisU), glm::dot(p, chart.axisV));
+                        layout.remap.push_back(source);
+                        layout.coords.push_back((origin + (uv - chart.lower) * density) / float(size));
+                    }
+                    layout.indices[3 * size_t(t) + k] = inserted.first->second;
+                }
+            }
+        }
+        cout << "lightmap: " << charts.size() << " charts packed into " << size << "x" << size
+             << " at " << density << " texels per unit" << endl;
+        return true;
+    }
+
+    // 光栅化得到每个 texel 的位置和法线，并行烘焙后向外扩张
+    vector<glm::vec3> render(const Model& model, const vector<Layout>& layouts) const
+    {
+        struct Sample {
+            glm::vec3 position, normal, face;
+        };
+        vector<Sample> samples(size_t(size) * size);
+        vector<char> covered(samples.size(), 0);
+        vector<glm::vec3> positions;
+        glm::vec3 lower(numeric_limits<float>::max()), upper(-numeric_limits<float>::max());
+        for (size_t m = 0; m < model.meshes.size(); ++m)
+        {
+            const Mesh& mesh = model.meshes[m];
+            const Layout& layout = layouts[m];
+            for (size_t t = 0; t + 2 < layout.indices.size(); t += 3)
+            {
+                glm::vec3 p[3], n[3];
+                glm::vec2 uv[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    unsigned v = layout.indices[t + k];
+                    p[k] = mesh.vertices[layout.remap[v]].Position;
+                    n[k] = mesh.vertices[layout.remap[v]].Normal;
+                    uv[k] = layout.coords[v] * float(size);
+                    positions.push_back(p[k]);
+                    lower = glm::min(lower, p[k]);
+                    upper = glm::max(upper, p[k]);
+                }
+                glm::vec3 face = glm::cross(p[1] - p[0], p[2] - p[0]);
+                float faceLength = glm::length(face);
+                if (faceLength <= 0.0f) continue;
+                face /= faceLength;
+
+                // 取 texel 中心落在三角形内的 texel，重心坐标插值位置和法线
+                float denom = (uv[1].y - uv[2].y) * (uv[0].x - uv[2].x) + (uv[2].x - uv[1].x) * (uv[0].y - uv[2].y);
+                if (std::abs(denom) < 1e-12f) continue;
+                int x0 = max(int(floor(min(min(uv[0].x, uv[1].x), uv[2].x))), 0);
+                int x1 = min(int(ceil(max(max(uv[0].x, uv[1].x), uv[2].x))), size - 1);
+                int y0 = max(int(floor(min(min(uv[0].y, uv[1].y), uv[2].y))), 0);
+                int y1 = min(int(ceil(max(max(uv[0].y, uv[1].y), uv[2].y))), size - 1);
+                for (int y = y0; y <= y1; ++y)
+                {
+                    for (int x = x0; x <= x1; ++x)
+                    {
+                        glm::vec2 c(x + 0.5f, y + 0.5f);
+                        float b0 = ((uv[1].y - uv[2].y) * (c.x - uv[2].x) + (uv[2].x - uv[1].x) * (c.y - uv[2].y)) / denom;
+                        float b1 = ((uv[2].y - uv[0].y) * (c.x - uv[2].x) + (uv[0].x - uv[2].x) * (c.y - uv[2].y)) / denom;
+                        float b2 = 1.0f - b0 - b1;
+                        if (b0 < -1e-4f || b1 < -1e-4f || b2 < -1e-4f) continue;
+                        size_t i = size_t(y) * size + x;
+                        glm::vec3 normal = b0 * n[0] + b1 * n[1] + b2 * n[2];
+                        float length = glm::length(normal);
+                        samples[i].position = b0 * p[0] + b1 * p[1] + b2 * p[2];
+                        samples[i].normal = length > 0.0f ? normal / length : face;
+                        samples[i].face = face;
+                        covered[i] = 1;
+                    }
+                }
+            }
+        }
+
+        TriangleBVH bvh;
+        bvh.build(positions);
+        float diagonal = glm::length(upper - lower);
+        float bias = 1e-4f * diagonal;
+        float aoLength = aoDistance * diagonal;
+        glm::vec3 sun = glm::normalize(sunDirection);
+
+        // 每个 texel 用自己的编号作随机数种子，结果与线程数无关
+        vector<glm::vec3> texels(samples.size(), glm::vec3(0.0f));
+        auto shade = [&](size_t i) {
+            const Sample& s = samples[i];
+            glm::vec3 origin = s.position + s.face * bias;
+            glm::vec3 color(0.0f);
+            float cosine = glm::dot(s.normal, sun);
+            if (cosine > 0.0f && glm::dot(s.face, sun) > 0.0f && !bvh.occluded(origin, sun, numeric_limits<float>::max()))
+                color += sunColor * cosine;
+
+            uint32_t state = uint32_t(i) * 747796405u + 2891336453u;
+            auto next = [&]() {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return (state >> 8) * (1.0f / 16777216.0f);
+            };
+            glm::vec3 helper = std::abs(s.normal.x) > 0.5f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 b1 = glm::normalize(glm::cross(s.normal, helper)), b2 = glm::cross(s.normal, b1);
+            int open = 0;
+            int sqrtSamples = max(1, int(lround(sqrt(float(aoSamples)))));
+            for (int j = 0; j < sqrtSamples; ++j)
+            {
+                for (int k = 0; k < sqrtSamples; ++k)
+                {
+                    // 分层的余弦加权半球采样
+                    float r = sqrt((j + next()) / sqrtSamples), phi = 2.0f * glm::pi<float>() * (k + next()) / sqrtSamples;
+                    glm::vec3 d = r * cos(phi) * b1 + r * sin(phi) * b2 + sqrt(max(0.0f, 1.0f - r * r)) * s.normal;
+                    if (glm::dot(d, s.face) <= 0.0f) continue; // 插值法线偏离几何法线时可能朝向表面内部
+                    open += !bvh.occluded(origin, d, aoLength);
+                }
+            }
+            color += ambientColor * (float(open) / float(sqrtSamples * sqrtSamples));
+            texels[i] = color;
+        };
+
+        int workers = threads > 0 ? threads : max(1, int(thread::hardware_concurrency()));
+        atomic<size_t> nextRow(0);
+        vector<thread> pool;
+        for (int w = 0; w < workers; ++w)
+        {
+            pool.emplace_back([&]() {
+                for (size_t y; (y = nextRow.fetch_add(1)) < size_t(size);)
+                    for (size_t i = y * size; i < (y + 1) * size; ++i)
+                        if (covered[i]) shade(i);
+            });
+        }
+        for (thread& t : pool) t.join();
+
+        // 空白 texel 取相邻有效 texel 的平均，扩张 padding 圈
+        for (int pass = 0; pass < padding; ++pass)
+        {
+            vector<char> next = covered;
+            for (int y = 0; y < size; ++y)
+            {
+                for (int x = 0; x < size; ++x)
+                {
+                    size_t i = size_t(y) * size + x;
+                    if (covered[i]) continue;
+                    glm::vec3 sum(0.0f);
+                    int count = 0;
+                    for (int dy = -1; dy <= 1; ++dy)
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            int nx = x + dx, ny = y + dy;
+                            if (nx < 0 || ny < 0 || nx >= size || ny >= size || !covered[size_t(ny) * size + nx]) continue;
+                            sum += texels[size_t(ny) * size + nx];
+                            count++;
+                        }
+                    if (count == 0) continue;
+                    texels[i] = sum / float(count);
+                    next[i] = 1;
+                }
+            }
+            covered.swap(next);
+        }
+        size_t filled = 0;
+        for (size_t i = 0; i < samples.size(); ++i) filled += covered[i] != 0;
+        cout << "lightmap: " << positions.size() / 3 << " triangles, " << bvh.nodeCount() << " BVH nodes, "
+             << workers << " threads, " << filled * 100 / samples.size() << "% of texels used" << endl;
+        return texels;
+    }
+
+    void upload(const vector<glm::vec3>& texels)
+    {
+        if (texture == 0) glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, texels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // 缓存文件：magic、版本、散列、图集边长、网格数，每个网格的顶点数和索引数，
+    // 随后依次是各网格的 remap、coords、indices，最后是 size x size 个 RGB 浮点 texel
+    bool saveCache(const string& path, uint64_t key, const vector<Layout>& layouts, const vector<glm::vec3>& texels) const
+    {
+        string temp = path + ".tmp";
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            if (!out) return false;
+            uint32_t header[3] = {LIGHTMAP_CACHE_MAGIC, LIGHTMAP_CACHE_VERSION, uint32_t(layouts.size())};
+            int32_t atlas = size;
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+            out.write(reinterpret_cast<const char*>(&atlas), sizeof(atlas));
+            for (const Layout& layout : layouts)
+            {
+                uint32_t counts[2] = {uint32_t(layout.remap.size()), uint32_t(layout.indices.size())};
+                out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+            }
+            for (const Layout& layout : layouts)
+            {
+                out.write(reinterpret_cast<const char*>(layout.remap.data()), layout.remap.size() * sizeof(unsigned int));
+                out.write(reinterpret_cast<const char*>(layout.coords.data()), layout.coords.size() * sizeof(glm::vec2));
+                out.write(reinterpret_cast<const char*>(layout.indices.data()), layout.indices.size() * sizeof(unsigned int));
+            }
+            out.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(glm::vec3));
+            if (!out) return false;
+        }
+        std::remove(path.c_str()); // Windows 上 rename 不覆盖已有文件
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    bool loadCache(const string& path, uint64_t key, const Model& model, vector<Layout>& layouts, vector<glm::vec3>& texels)
+    {
+        ifstream in(path, ios::binary);
+        if (!in) return false;
+        uint32_t header[3];
+        uint64_t storedKey;
+        int32_t atlas;
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        in.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+        in.read(reinterpret_cast<char*>(&atlas), sizeof(atlas));
+        if (!in || header[0] != LIGHTMAP_CACHE_MAGIC || header[1] != LIGHTMAP_CACHE_VERSION ||
+            header[2] != model.meshes.size() || storedKey != key || atlas <= 0 || atlas > maxAtlasSize)
+            return false;
+
+        layouts.assign(model.meshes.size(), Layout());
+        for (size_t m = 0; m < layouts.size(); ++m)
+        {
+            uint32_t counts[2];
+            in.read(reinterpret_cast<char*>(counts), sizeof(counts));
+            if (!in || counts[1] != model.meshes[m].indices.size()) return false;
+            layouts[m].remap.resize(counts[0]);
+            layouts[m].coords.resize(counts[0]);
+            layouts[m].indices.resize(counts[1]);
+        }
+        for (size_t m = 0; m < layouts.size(); ++m)
+        {
+            Layout& layout = layouts[m];
+            in.read(reinterpret_cast<char*>(layout.remap.data()), layout.remap.size() * sizeof(unsigned int));
+            in.read(reinterpret_cast<char*>(layout.coords.data()), layout.coords.size() * sizeof(glm::vec2));
+            in.read(reinterpret_cast<char*>(layout.indices.data()), layout.indices.size() * sizeof(unsigned int));
+            if (!in) return false;
+            for (unsigned int source : layout.remap)
+                if (source >= model.meshes[m].vertices.size()) return false;
+            for (unsigned int index : layout.indices)
+                if (index >= layout.remap.size()) return false;
+        }
+        texels.resize(size_t(atlas) * atlas);
+        in.read(reinterpret_cast<char*>(texels.data()), texels.size() * sizeof(glm::vec3));
+        if (!in) return false;
+        size = atlas;
+        return true;
+    }
+};
+#endif
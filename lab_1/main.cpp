@@ -8,6 +8,7 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "lightmap.h"
 
 #include <iostream>
 
@@ -35,6 +36,11 @@ glm::vec3 modelTranslation(0.0f, 0.0f, 0.0f);  // 模型的平移
 glm::vec3 modelRotation(0.0f, 0.0f, 0.0f);        // 模型的旋转角度（绕Y轴旋转）
 float modelScale = 1.0f;                          // 模型的缩放系数
 
+// lighting
+LightmapBaker lightmapBaker;    // 加载模型后烘焙光照贴图
+bool useLightmap = true;        // L 键切换
+bool lightmapKeyDown = false;
+
 int main()
 {
     // glfw: initialize and configure
@@ -86,7 +92,13 @@ int main()
 
     // load models
     // -----------
-    Model ourModel("../model/tower/wooden watch tower2.obj");
+    string modelPath = "../model/tower/wooden watch tower2.obj";
+    Model ourModel(modelPath, false, true); // 烘焙光照贴图需要 CPU 端的顶点
+
+    // bake lighting (cached next to the model)
+    // ----------------------------------------
+    if (!lightmapBaker.bake(ourModel, modelPath + ".lightmap"))
+        useLightmap = false;
 
     
     // draw in wireframe
@@ -129,6 +141,9 @@ int main()
         model = glm::scale(model, glm::vec3(modelScale));  
         
         ourShader.setMat4("model", model);
+        ourShader.setBool("useLightmap", useLightmap);
+        if (useLightmap)
+            lightmapBaker.bind(ourShader);
         ourModel.Draw(ourShader);
 
 
@@ -191,6 +206,12 @@ void processInput(GLFWwindow *window)
         modelScale -= 0.0005f; // 缩小
     modelScale = std::max(0.1f, modelScale); // 限制最小缩放为0.1，防止变为0或负值
 
+    // 光照贴图开关（按下时切换一次）
+    bool lightmapKey = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+    if (lightmapKey && !lightmapKeyDown && lightmapBaker.texture != 0)
+        useLightmap = !useLightmap;
+    lightmapKeyDown = lightmapKey;
+
     std::cout << "modelTranslation: (" << modelTranslation.x << ", " << modelTranslation.y << ", " << modelTranslation.z << ")" << "\n";
     std::cout << "modelRotation: (" << modelRotation.x << ", " << modelRotation.y << ", " << modelRotation.z << ")" << "\n";
     std::cout << "modelScale: " << modelScale << "\n";
@@ -29,6 +29,8 @@ struct Vertex {
 	int m_BoneIDs[MAX_BONE_INFLUENCE];
 	//weights from each bone
 	float m_Weights[MAX_BONE_INFLUENCE];
+    // 光照贴图的第二套 UV，由 LightmapBaker 生成
+    glm::vec2 LightmapCoords;
 };
 
 struct Texture {
@@ -44,16 +46,31 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    size_t indexCount = 0;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
     {
-        this->vertices = vertices;
-        this->indices = indices;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
         this->textures = textures;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // 直接从外部内存（如映射的网格缓存）上传顶点和索引，默认不在 CPU 端保留副本；
+    // keepData 为 true 时另外复制到 vertices/indices，供需要读取几何的代码使用
+    Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, vector<Texture> textures, bool keepData = false)
+    {
+        if (keepData)
+        {
+            this->vertices.assign(vertexData, vertexData + vertexCount);
+            this->indices.assign(indexData, indexData + indexCount);
+        }
+        this->textures = textures;
+
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
     }
 
     // render the mesh
@@ -87,20 +104,45 @@ public:
         
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // 换成光照贴图烘焙后的顶点布局：新顶点 i 复制原顶点 remap[i] 并带上第二套 UV coords[i]，
+    // 索引换成 newIndices，然后重新上传到原来的缓冲（VAO 的属性设置不变）
+    void setLightmapLayout(const vector<unsigned int>& remap, const vector<unsigned int>& newIndices, const vector<glm::vec2>& coords)
+    {
+        vector<Vertex> split(remap.size());
+        for (size_t i = 0; i < remap.size(); i++)
+        {
+            split[i] = vertices[remap[i]];
+            split[i].LightmapCoords = coords[i];
+        }
+        vertices.swap(split);
+        indices = newIndices;
+        indexCount = indices.size();
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
+
 private:
     // render data 
     unsigned int VBO, EBO;
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t count)
     {
+        indexCount = count;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -112,10 +154,10 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);  
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -140,6 +182,9 @@ private:
 		// weights
 		glEnableVertexAttribArray(6);
 		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+        // lightmap coords
+        glEnableVertexAttribArray(7);
+        glVertexAttribPointer(7, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, LightmapCoords));
         glBindVertexArray(0);
     }
 };
@@ -0,0 +1,351 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include "mesh.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// 只读的文件内存映射
+class MappedFile {
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const string& path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) { close(); return false; }
+        base = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!base) { close(); return false; }
+        length = size_t(fileSize.QuadPart);
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { close(); return false; }
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) { close(); return false; }
+        base = static_cast<const char*>(p);
+        length = size_t(st.st_size);
+        madvise(p, length, MADV_SEQUENTIAL); // 整个文件只顺序读一遍
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base) munmap(const_cast<char*>(base), length);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+inline uint64_t hashBytes(const void* data, size_t bytes, uint64_t h = 0x9e3779b97f4a7c15ull)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    auto mix = [&](uint64_t w) {
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    };
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        mix(w);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, bytes - i);
+    mix(tail ^ uint64_t(bytes) << 56);
+    return h;
+}
+
+const uint32_t MESH_CACHE_MAGIC = 0x4353484d; // "MHSC"
+const uint32_t MESH_CACHE_VERSION = 1;
+const size_t MESH_CACHE_ALIGNMENT = 64;
+
+// 源文件的大小、修改时间和内容散列
+struct SourceStamp {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+};
+
+// 文件布局：MeshCacheHeader，meshCount 个 MeshCacheEntry，textureCount 个 MeshCacheTexture，
+// 纹理类型和路径的字符串，然后是每个网格 64 字节对齐的顶点块和索引块。
+// 顶点块就是 Vertex 数组，映射后直接交给 glBufferData
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    SourceStamp source;
+    uint32_t vertexSize;    // sizeof(Vertex)，结构体变化后缓存自动失效
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint32_t reserved;
+    uint64_t fileSize;      // 用来发现被截断的文件
+};
+
+struct MeshCacheEntry {
+    uint64_t vertexOffset, vertexCount;
+    uint64_t indexOffset, indexCount;
+    uint32_t firstTexture, textureCount;
+};
+
+// 纹理引用：类型（texture_diffuse 等）和相对模型目录的路径，在字符串区中的位置
+struct MeshCacheTexture {
+    uint32_t typeOffset, typeLength;
+    uint32_t pathOffset, pathLength;
+};
+
+// 写入缓存的一个网格
+struct MeshData {
+    const Vertex* vertices;
+    size_t vertexCount;
+    const unsigned int* indices;
+    size_t indexCount;
+    vector<Texture> textures;
+};
+
+// 模型导入结果的二进制缓存。第一次导入后写在模型旁边，之后映射该文件，
+// 顶点和索引不经过 vector<Vertex> 直接上传。
+// 源文件大小不同则缓存失效；大小和修改时间都相同时直接使用；只有修改时间不同（复制、检出等）时
+// 再比较内容散列，相同则沿用缓存并更新记录的修改时间。
+// 只记录 .obj 等主文件，单独修改 .mtl 后需要删除缓存
+class MeshCache {
+public:
+    // 打开并校验 cachePath，sourcePath 为模型文件
+    bool open(const string& cachePath, const string& sourcePath)
+    {
+        close();
+        MeshCacheHeader header;
+        {
+            ifstream in(cachePath, ios::binary);
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        }
+        if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION || header.vertexSize != sizeof(Vertex))
+            return false;
+        SourceStamp current;
+        if (!stamp(sourcePath, current, false) || current.size != header.source.size) return false;
+        if (current.mtime != header.source.mtime)
+        {
+            if (!stamp(sourcePath, current, true) || current.hash != header.source.hash) return false;
+            // 内容没变，记下新的修改时间，下次不必再算散列
+            fstream out(cachePath, ios::binary | ios::in | ios::out);
+            out.seekp(offsetof(MeshCacheHeader, source) + offsetof(SourceStamp, mtime));
+            out.write(reinterpret_cast<const char*>(&current.mtime), sizeof(current.mtime));
+        }
+
+        if (!file.open(cachePath) || file.size() < sizeof(MeshCacheHeader)) return false;
+        const MeshCacheHeader* h = reinterpret_cast<const MeshCacheHeader*>(file.data());
+        if (h->fileSize != file.size() || !validate(*h)) { close(); return false; }
+        return true;
+    }
+
+    void close() { file.close(); }
+
+    size_t meshCount() const { return header().meshCount; }
+    const MeshCacheEntry& entry(size_t mesh) const { return entries()[mesh]; }
+    const Vertex* vertices(size_t mesh) const { return reinterpret_cast<const Vertex*>(file.data() + entry(mesh).vertexOffset); }
+    const unsigned int* indices(size_t mesh) const { return reinterpret_cast<const unsigned int*>(file.data() + entry(mesh).indexOffset); }
+
+    // 网格 mesh 的第 i 个纹理引用
+    string textureType(size_t mesh, size_t i) const
+    {
+        const MeshCacheTexture& t = textures()[entry(mesh).firstTexture + i];
+        return string(strings() + t.typeOffset, t.typeLength);
+    }
+    string texturePath(size_t mesh, size_t i) const
+    {
+        const MeshCacheTexture& t = textures()[entry(mesh).firstTexture + i];
+        return string(strings() + t.pathOffset, t.pathLength);
+    }
+
+    // 把刚导入、仍在 CPU 端保留数据的 meshes 写入 cachePath
+    static bool write(const string& cachePath, const string& sourcePath, const vector<Mesh>& meshes)
+    {
+        vector<MeshData> data;
+        for (const Mesh& mesh : meshes)
+            data.push_back({mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), mesh.textures});
+        return write(cachePath, sourcePath, data);
+    }
+
+    // 先写临时文件再改名，中途失败不会留下半个缓存
+    static bool write(const string& cachePath, const string& sourcePath, const vector<MeshData>& meshes)
+    {
+        MeshCacheHeader header = {};
+        header.magic = MESH_CACHE_MAGIC;
+        header.version = MESH_CACHE_VERSION;
+        if (!stamp(sourcePath, header.source, true)) return false;
+        header.vertexSize = sizeof(Vertex);
+        header.meshCount = uint32_t(meshes.size());
+
+        vector<MeshCacheEntry> entries(meshes.size());
+        vector<MeshCacheTexture> textures;
+        string strings;
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            entries[m].firstTexture = uint32_t(textures.size());
+            entries[m].textureCount = uint32_t(meshes[m].textures.size());
+            for (const Texture& texture : meshes[m].textures)
+            {
+                MeshCacheTexture t;
+                t.typeOffset = uint32_t(strings.size());
+                t.typeLength = uint32_t(texture.type.size());
+                strings += texture.type;
+                t.pathOffset = uint32_t(strings.size());
+                t.pathLength = uint32_t(texture.path.size());
+                strings += texture.path;
+                textures.push_back(t);
+            }
+        }
+        header.textureCount = uint32_t(textures.size());
+
+        uint64_t offset = sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheEntry) +
+                          textures.size() * sizeof(MeshCacheTexture) + strings.size();
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            entries[m].vertexOffset = align(offset);
+            entries[m].vertexCount = meshes[m].vertexCount;
+            offset = entries[m].vertexOffset + entries[m].vertexCount * sizeof(Vertex);
+            entries[m].indexOffset = align(offset);
+            entries[m].indexCount = meshes[m].indexCount;
+            offset = entries[m].indexOffset + entries[m].indexCount * sizeof(unsigned int);
+        }
+        header.fileSize = offset;
+
+        string temp = cachePath + ".tmp";
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MeshCacheEntry));
+            out.write(reinterpret_cast<const char*>(textures.data()), textures.size() * sizeof(MeshCacheTexture));
+            out.write(strings.data(), strings.size());
+            for (size_t m = 0; m < meshes.size(); ++m)
+            {
+                pad(out, entries[m].vertexOffset);
+                out.write(reinterpret_cast<const char*>(meshes[m].vertices), meshes[m].vertexCount * sizeof(Vertex));
+                pad(out, entries[m].indexOffset);
+                out.write(reinterpret_cast<const char*>(meshes[m].indices), meshes[m].indexCount * sizeof(unsigned int));
+            }
+            if (!out) return false;
+        }
+        remove(cachePath.c_str()); // Windows 上 rename 不覆盖已有文件
+        return rename(temp.c_str(), cachePath.c_str()) == 0;
+    }
+
+private:
+    MappedFile file;
+
+    const MeshCacheHeader& header() const { return *reinterpret_cast<const MeshCacheHeader*>(file.data()); }
+    const MeshCacheEntry* entries() const { return reinterpret_cast<const MeshCacheEntry*>(file.data() + sizeof(MeshCacheHeader)); }
+    const MeshCacheTexture* textures() const { return reinterpret_cast<const MeshCacheTexture*>(entries() + header().meshCount); }
+    const char* strings() const { return reinterpret_cast<const char*>(textures() + header().textureCount); }
+
+    static uint64_t align(uint64_t offset) { return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT; }
+
+    static void pad(ofstream& out, uint64_t offset)
+    {
+        static const char zeros[MESH_CACHE_ALIGNMENT] = {};
+        uint64_t position = uint64_t(out.tellp());
+        out.write(zeros, offset - position);
+    }
+
+    // 源文件的大小和修改时间，withHash 为 true 时映射整个文件计算内容散列
+    static bool stamp(const string& path, SourceStamp& result, bool withHash)
+    {
+        error_code error;
+        uintmax_t size = filesystem::file_size(path, error);
+        if (error) return false;
+        auto time = filesystem::last_write_time(path, error);
+        if (error) return false;
+        result.size = uint64_t(size);
+        result.mtime = int64_t(time.time_since_epoch().count());
+        result.hash = 0;
+        if (withHash)
+        {
+            MappedFile source;
+            if (!source.open(path)) return false;
+            result.hash = hashBytes(source.data(), source.size());
+        }
+        return true;
+    }
+
+    // 各段都落在文件之内
+    bool validate(const MeshCacheHeader& h) const
+    {
+        uint64_t tables = sizeof(MeshCacheHeader) + uint64_t(h.meshCount) * sizeof(MeshCacheEntry) +
+                          uint64_t(h.textureCount) * sizeof(MeshCacheTexture);
+        if (tables > h.fileSize) return false;
+        uint64_t stringsSize = 0;
+        for (uint32_t m = 0; m < h.meshCount; ++m)
+        {
+            const MeshCacheEntry& e = entries()[m];
+            if (e.vertexOffset % MESH_CACHE_ALIGNMENT || e.indexOffset % MESH_CACHE_ALIGNMENT) return false;
+            if (e.vertexOffset < tables || e.vertexOffset + e.vertexCount * sizeof(Vertex) > h.fileSize) return false;
+            if (e.indexOffset < tables || e.indexOffset + e.indexCount * sizeof(unsigned int) > h.fileSize) return false;
+            if (uint64_t(e.firstTexture) + e.textureCount > h.textureCount) return false;
+        }
+        for (uint32_t i = 0; i < h.textureCount; ++i)
+        {
+            const MeshCacheTexture& t = textures()[i];
+            stringsSize = max(stringsSize, max(uint64_t(t.typeOffset) + t.typeLength, uint64_t(t.pathOffset) + t.pathLength));
+        }
+        return tables + stringsSize <= h.fileSize;
+    }
+};
+#endif
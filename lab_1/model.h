@@ -6,11 +6,15 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
+#ifndef MODEL_NO_ASSIMP
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#endif
 
 #include "mesh.h"
+#include "meshcache.h"
+#include "objloader.h"
 #include "shader.h"
 
 #include <string>
@@ -19,6 +23,8 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <cctype>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
@@ -31,9 +37,11 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    bool keepData;          // 从网格缓存或 OBJ 读入时是否在 Mesh 中保留顶点和索引的副本
+    bool loadedFromCache = false;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, bool keepData = false) : gammaCorrection(gamma), keepData(keepData)
     {
         loadModel(path);
     }
@@ -46,8 +54,63 @@ public:
     }
     
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // loads a model from file and stores the resulting meshes in the meshes vector.
+    // .obj 用内置的并行 ObjLoader 读取，其他格式交给 ASSIMP；定义 MODEL_NO_ASSIMP 时不链接 ASSIMP，只支持 .obj
     void loadModel(string const &path)
+    {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // 有效的网格缓存直接映射，顶点和索引从映射上传
+        string cachePath = path + ".meshcache";
+        MeshCache cache;
+        if (cache.open(cachePath, path))
+        {
+            loadCache(cache);
+            loadedFromCache = true;
+            return;
+        }
+
+        string extension = path.substr(path.find_last_of('.') + 1);
+        transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(tolower(c)); });
+        if (extension == "obj")
+        {
+            loadObj(path, cachePath);
+            return;
+        }
+#ifdef MODEL_NO_ASSIMP
+        cout << "ERROR::MODEL:: built without ASSIMP, only .obj is supported: " << path << endl;
+#else
+        if (loadAssimp(path) && !MeshCache::write(cachePath, path, meshes))
+            cout << "failed to write mesh cache " << cachePath << endl;
+#endif
+    }
+
+    // 读入的顶点和索引直接上传，并在释放前写入网格缓存
+    void loadObj(string const &path, string const &cachePath)
+    {
+        ObjLoader loader;
+        vector<ObjMesh> objMeshes;
+        if (!loader.load(path, objMeshes))
+        {
+            cout << "ERROR::OBJ:: failed to read " << path << endl;
+            return;
+        }
+        vector<MeshData> data;
+        for (const ObjMesh& mesh : objMeshes)
+        {
+            vector<Texture> textures;
+            for (const auto& texture : mesh.textures)
+                textures.push_back(loadTexture(texture.first, texture.second));
+            meshes.push_back(Mesh(mesh.vertices.get(), mesh.count, mesh.indices.get(), mesh.count, textures, keepData));
+            data.push_back({mesh.vertices.get(), mesh.count, mesh.indices.get(), mesh.count, textures});
+        }
+        if (!MeshCache::write(cachePath, path, data))
+            cout << "failed to write mesh cache " << cachePath << endl;
+    }
+
+#ifndef MODEL_NO_ASSIMP
+    bool loadAssimp(string const &path)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
@@ -56,15 +119,28 @@ private:
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
-
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+        return true;
     }
+#endif
 
+    // 按缓存中的网格和纹理引用建立 Mesh，纹理文件照常读取
+    void loadCache(const MeshCache &cache)
+    {
+        for (size_t m = 0; m < cache.meshCount(); m++)
+        {
+            const MeshCacheEntry& entry = cache.entry(m);
+            vector<Texture> textures;
+            for (uint32_t i = 0; i < entry.textureCount; i++)
+                textures.push_back(loadTexture(cache.texturePath(m, i), cache.textureType(m, i)));
+            meshes.push_back(Mesh(cache.vertices(m), size_t(entry.vertexCount), cache.indices(m), size_t(entry.indexCount), textures, keepData));
+        }
+    }
+
+#ifndef MODEL_NO_ASSIMP
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
     void processNode(aiNode *node, const aiScene *scene)
     {
@@ -131,6 +207,7 @@ private:
             }
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            vertex.LightmapCoords = glm::vec2(0.0f, 0.0f);
 
             vertices.push_back(vertex);
         }
@@ -177,29 +254,29 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
         return textures;
     }
+#endif
+
+    // loads the texture at path (relative to the model directory) unless it was loaded before.
+    Texture loadTexture(const string &path, const string &typeName)
+    {
+        // check if texture was loaded before and if so, reuse it: skip loading a new texture
+        for(unsigned int j = 0; j < textures_loaded.size(); j++)
+        {
+            if(textures_loaded[j].path == path)
+                return textures_loaded[j]; // a texture with the same filepath has already been loaded (optimization)
+        }
+        // if texture hasn't been loaded already, load it
+        Texture texture;
+        texture.id = TextureFromFile(path.c_str(), this->directory);
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+        return texture;
+    }
 };
 
 
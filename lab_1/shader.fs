@@ -2,10 +2,15 @@
 out vec4 FragColor;
 
 in vec2 TexCoords;
+in vec2 LightmapCoords;
 
 uniform sampler2D texture_diffuse1;
+uniform sampler2D lightmap;       // 烘焙的环境光遮蔽和直接光照
+uniform bool useLightmap;
 
 void main()
 {    
     FragColor = texture(texture_diffuse1, TexCoords);
+    if (useLightmap)
+        FragColor.rgb *= texture(lightmap, LightmapCoords).rgb;
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 7) in vec2 aLightmapCoords;
 
 out vec2 TexCoords;
+out vec2 LightmapCoords;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -12,5 +14,6 @@ uniform mat4 projection;
 void main()
 {
     TexCoords = aTexCoords;    
+    LightmapCoords = aLightmapCoords;
     gl_Position = projection * view * model * vec4(aPos.x, aPos.y, aPos.z, 1.0);
 }
\ No newline at end of file
@@ -44,16 +44,31 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    size_t indexCount = 0;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
     {
-        this->vertices = vertices;
-        this->indices = indices;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
         this->textures = textures;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // 直接从外部内存（如映射的网格缓存）上传顶点和索引，默认不在 CPU 端保留副本；
+    // keepData 为 true 时另外复制到 vertices/indices，供需要读取几何的代码使用
+    Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, vector<Texture> textures, bool keepData = false)
+    {
+        if (keepData)
+        {
+            this->vertices.assign(vertexData, vertexData + vertexCount);
+            this->indices.assign(indexData, indexData + indexCount);
+        }
+        this->textures = textures;
+
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
     }
 
     // render the mesh
@@ -87,7 +102,7 @@ public:
         
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
@@ -99,8 +114,10 @@ private:
     unsigned int VBO, EBO;
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t count)
     {
+        indexCount = count;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -112,10 +129,10 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);  
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -0,0 +1,484 @@
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "meshcache.h"
+
+#include <charconv>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+// 加载结果中的一个网格：同一材质的所有三角形，count 个顶点和同样多的索引。
+// 缓冲用 new[] 分配、不做零初始化，由各线程并行写入，首次写入时的缺页也分摊到各线程。
+// textures 为（相对模型目录的路径，类型）
+struct ObjMesh {
+    unique_ptr<Vertex[]> vertices;
+    unique_ptr<unsigned int[]> indices;
+    size_t count = 0;
+    vector<pair<string, string>> textures;
+};
+
+// 不依赖 Assimp 的 OBJ/MTL 读取，结果与 Model 用 Assimp 导入（Triangulate | GenSmoothNormals |
+// FlipUVs | CalcTangentSpace，再翻转一次 v）得到的 Vertex 一致：每个面角一个顶点，多边形按扇形三角化，
+// 没有法线时按共享位置平均面法线，有纹理坐标时计算每个面的切线和副切线。
+// 文件映射后按行边界切成若干块，各块在所有核心上并行解析（浮点数用 from_chars），
+// 然后按前缀和确定每块的全局下标，再并行把三角形写进各材质的网格。
+// 与 Assimp 不同，网格只按材质划分，不再按 o/g 拆开
+class ObjLoader {
+public:
+    int threads = 0;    // 0 表示使用全部硬件线程
+
+    bool load(const string& path, vector<ObjMesh>& meshes)
+    {
+        MappedFile file;
+        if (!file.open(path)) return false;
+        size_t slash = path.find_last_of('/');
+        string directory = slash == string::npos ? "." : path.substr(0, slash);
+        int workers = threads > 0 ? threads : max(1, int(thread::hardware_concurrency()));
+
+        // 1. 按行边界切块并行解析
+        vector<pair<const char*, const char*>> ranges = split(file.data(), file.size(), workers);
+        vector<Chunk> chunks(ranges.size());
+        parallelFor(chunks.size(), workers, [&](size_t c) { parse(ranges[c].first, ranges[c].second, chunks[c]); });
+
+        // 2. 每块的顶点、纹理坐标、法线在全局数组中的起点，修正相对（负）下标，拼接数组
+        vector<size_t> positionBase(chunks.size() + 1, 0), texcoordBase(chunks.size() + 1, 0), normalBase(chunks.size() + 1, 0);
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            positionBase[c + 1] = positionBase[c] + chunks[c].positions.size();
+            texcoordBase[c + 1] = texcoordBase[c] + chunks[c].texcoords.size();
+            normalBase[c + 1] = normalBase[c] + chunks[c].normals.size();
+        }
+        vector<glm::vec3> positions(positionBase.back()), normals(normalBase.back());
+        vector<glm::vec2> texcoords(texcoordBase.back());
+        parallelFor(chunks.size(), workers, [&](size_t c) {
+            Chunk& chunk = chunks[c];
+            copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionBase[c]);
+            copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + texcoordBase[c]);
+            copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBase[c]);
+            if (!chunk.hasRelative) return;
+            for (Corner& corner : chunk.corners)
+            {
+                if (corner.relative & 1) corner.v += int32_t(positionBase[c]);
+                if (corner.relative & 2) corner.t += int32_t(texcoordBase[c]);
+                if (corner.relative & 4) corner.n += int32_t(normalBase[c]);
+            }
+        });
+
+        // 3. 材质：usemtl 的作用延续到后面的块，按首次出现的顺序编号；每块切成若干同材质的三角形段，
+        //    段在所属材质网格中的位置按文件顺序排定
+        vector<string> materialNames(1, "");
+        unordered_map<string, int> materialIds = {{"", 0}};
+        vector<string> libraries;
+        vector<Segment> segments;
+        int current = 0;
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            const Chunk& chunk = chunks[c];
+            libraries.insert(libraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+            size_t begin = 0;
+            for (const auto& change : chunk.materials)
+            {
+                if (change.first > begin) segments.push_back({c, begin, change.first, current, 0});
+                begin = change.first;
+                auto inserted = materialIds.emplace(change.second, int(materialNames.size()));
+                if (inserted.second) materialNames.push_back(change.second);
+                current = inserted.first->second;
+            }
+            size_t triangles = chunk.corners.size() / 3;
+            if (triangles > begin) segments.push_back({c, begin, triangles, current, 0});
+        }
+        vector<size_t> triangleCount(materialNames.size(), 0);
+        for (Segment& segment : segments)
+        {
+            segment.offset = triangleCount[segment.material];
+            triangleCount[segment.material] += segment.end - segment.begin;
+        }
+
+        // 4. 并行填写顶点：每个面角一个顶点，索引依次递增
+        vector<int> meshOf(materialNames.size(), -1);
+        meshes.clear();
+        for (size_t m = 0; m < materialNames.size(); ++m)
+        {
+            if (triangleCount[m] == 0) continue;
+            meshOf[m] = int(meshes.size());
+            meshes.emplace_back();
+            meshes.back().count = triangleCount[m] * 3;
+            meshes.back().vertices.reset(new Vertex[meshes.back().count]);
+            meshes.back().indices.reset(new unsigned int[meshes.back().count]);
+        }
+        vector<char> segmentMissing(segments.size(), 0);
+        parallelFor(segments.size(), workers, [&](size_t s) {
+            const Segment& segment = segments[s];
+            const Chunk& chunk = chunks[segment.chunk];
+            ObjMesh& mesh = meshes[meshOf[segment.material]];
+            bool missing = false;
+            for (size_t t = segment.begin; t < segment.end; ++t)
+            {
+                size_t out = (segment.offset + t - segment.begin) * 3;
+                for (int k = 0; k < 3; ++k)
+                {
+                    const Corner& corner = chunk.corners[t * 3 + k];
+                    Vertex& v = mesh.vertices[out + k];
+                    v = Vertex();
+                    if (corner.v >= 0 && size_t(corner.v) < positions.size()) v.Position = positions[corner.v];
+                    if (corner.t >= 0 && size_t(corner.t) < texcoords.size()) v.TexCoords = texcoords[corner.t];
+                    if (corner.n >= 0 && size_t(corner.n) < normals.size()) v.Normal = normals[corner.n];
+                    else missing = true;
+                    mesh.indices[out + k] = unsigned(out + k);
+                }
+            }
+            segmentMissing[s] = missing;
+        });
+
+        // 5. 与 GenSmoothNormals 一样按网格处理：网格中有缺少法线的角时，
+        //    共享同一位置下标的面法线（叉积，按面积加权）求和后归一化
+        vector<char> materialMissing(materialNames.size(), 0);
+        for (size_t s = 0; s < segments.size(); ++s)
+            if (segmentMissing[s]) materialMissing[segments[s].material] = 1;
+        if (find(materialMissing.begin(), materialMissing.end(), 1) != materialMissing.end())
+        {
+            vector<glm::vec3> accumulated(positions.size(), glm::vec3(0.0f));
+            for (const Segment& segment : segments)
+            {
+                if (!materialMissing[segment.material]) continue;
+                const Chunk& chunk = chunks[segment.chunk];
+                for (size_t t = segment.begin; t < segment.end; ++t)
+                {
+                    const Corner* c = &chunk.corners[t * 3];
+                    if (!valid(c, positions.size())) continue;
+                    glm::vec3 n = glm::cross(positions[c[1].v] - positions[c[0].v], positions[c[2].v] - positions[c[0].v]);
+                    for (int k = 0; k < 3; ++k) accumulated[c[k].v] += n;
+                }
+            }
+            parallelFor(segments.size(), workers, [&](size_t s) {
+                const Segment& segment = segments[s];
+                if (!materialMissing[segment.material]) return;
+                const Chunk& chunk = chunks[segment.chunk];
+                ObjMesh& mesh = meshes[meshOf[segment.material]];
+                for (size_t t = segment.begin; t < segment.end; ++t)
+                {
+                    const Corner* c = &chunk.corners[t * 3];
+                    if (!valid(c, positions.size())) continue;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        if (c[k].n >= 0 && size_t(c[k].n) < normals.size()) continue;
+                        glm::vec3 n = accumulated[c[k].v];
+                        float length = glm::length(n);
+                        mesh.vertices[(segment.offset + t - segment.begin) * 3 + k].Normal = length > 0.0f ? n / length : n;
+                    }
+                }
+            });
+        }
+
+        // 6. 有纹理坐标的三角形计算切线和副切线
+        parallelFor(segments.size(), workers, [&](size_t s) {
+            const Segment& segment = segments[s];
+            const Chunk& chunk = chunks[segment.chunk];
+            ObjMesh& mesh = meshes[meshOf[segment.material]];
+            for (size_t t = segment.begin; t < segment.end; ++t)
+            {
+                const Corner* c = &chunk.corners[t * 3];
+                if (c[0].t >= 0 && c[1].t >= 0 && c[2].t >= 0)
+                    tangents(&mesh.vertices[(segment.offset + t - segment.begin) * 3]);
+            }
+        });
+
+        // 7. 材质的纹理
+        unordered_map<string, vector<pair<string, string>>> materialTextures;
+        for (const string& library : libraries) parseMaterials(directory + '/' + library, materialTextures);
+        for (size_t m = 0; m < materialNames.size(); ++m)
+        {
+            if (meshOf[m] < 0) continue;
+            auto found = materialTextures.find(materialNames[m]);
+            if (found != materialTextures.end()) meshes[meshOf[m]].textures = found->second;
+        }
+        return true;
+    }
+
+private:
+    // 三角形的一个角，v/t/n 为全局从 0 开始的下标，t、n 缺失时为 -1。
+    // 负下标在解析时只能换算成块内下标，relative 的第 0/1/2 位表示 v/t/n 在合并时还需加上块的起点
+    struct Corner {
+        int32_t v, t, n;
+        uint32_t relative;
+    };
+
+    struct Chunk {
+        vector<glm::vec3> positions, normals;
+        vector<glm::vec2> texcoords;
+        vector<Corner> corners;                     // 每 3 个一个三角形
+        vector<pair<size_t, string>> materials;     // 从第几个三角形起换成哪个材质
+        vector<string> libraries;
+        bool hasRelative = false;
+    };
+
+    // 块内一段同材质的三角形 [begin, end)，offset 为它在该材质网格中的第一个三角形
+    struct Segment {
+        size_t chunk, begin, end;
+        int material;
+        size_t offset;
+    };
+
+    template <typename Body>
+    static void parallelFor(size_t count, int workers, const Body& body)
+    {
+        atomic<size_t> next(0);
+        vector<thread> pool;
+        int n = int(min(size_t(workers), count));
+        for (int w = 0; w < n; ++w)
+        {
+            pool.emplace_back([&]() {
+                for (size_t i; (i = next.fetch_add(1)) < count;) body(i);
+            });
+        }
+        for (thread& t : pool) t.join();
+    }
+
+    // 切成约 workers * 4 块（每块至少 1MB），块的边界挪到下一个换行之后
+    static vector<pair<const char*, const char*>> split(const char* data, size_t size, int workers)
+    {
+        size_t target = max(size / (size_t(workers) * 4), size_t(1) << 20);
+        vector<pair<const char*, const char*>> ranges;
+        const char* end = data + size;
+        const char* begin = data;
+        while (begin < end)
+        {
+            const char* cut = begin + min(target, size_t(end - begin));
+            if (cut < end)
+            {
+                const char* newline = static_cast<const char*>(memchr(cut, '\n', end - cut));
+                cut = newline ? newline + 1 : end;
+            }
+            ranges.push_back({begin, cut});
+            begin = cut;
+        }
+        return ranges;
+    }
+
+    static bool valid(const Corner* c, size_t count)
+    {
+        for (int k = 0; k < 3; ++k)
+            if (c[k].v < 0 || size_t(c[k].v) >= count) return false;
+        return true;
+    }
+
+    static const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        return p;
+    }
+
+    // 去掉首尾空白的剩余部分
+    static string rest(const char* p, const char* end)
+    {
+        p = skipSpaces(p, end);
+        while (end > p && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) --end;
+        return string(p, end);
+    }
+
+    static const char* parseFloat(const char* p, const char* end, float& value)
+    {
+        p = skipSpaces(p, end);
+        if (p < end && *p == '+') ++p;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        from_chars_result result = from_chars(p, end, value);
+        return result.ec == errc() ? result.ptr : p;
+#else
+        // 标准库不支持浮点 from_chars 时退回 strtof。映射的文件末尾没有 '\0'，先复制到缓冲区
+        char buffer[64];
+        size_t n = 0;
+        while (p + n < end && n + 1 < sizeof(buffer) && p[n] != ' ' && p[n] != '\t' && p[n] != '\r' && p[n] != '\n')
+        {
+            buffer[n] = p[n];
+            ++n;
+        }
+        buffer[n] = '\0';
+        char* stop;
+        value = strtof(buffer, &stop);
+        return p + (stop - buffer);
+#endif
+    }
+
+    // OBJ 的下标从 1 开始，负数表示从当前已读入的末尾倒数，count 为本块已读入的数量
+    static const char* parseIndex(const char* p, const char* end, size_t count, int32_t& index, uint32_t& relative, uint32_t bit)
+    {
+        if (p < end && *p == '+') ++p;
+        int64_t value = 0;
+        from_chars_result result = from_chars(p, end, value);
+        if (result.ec != errc()) return p;
+        if (value > 0) index = int32_t(value - 1);
+        else if (value < 0)
+        {
+            index = int32_t(int64_t(count) + value);
+            relative |= bit;
+        }
+        return result.ptr;
+    }
+
+    static void parse(const char* p, const char* end, Chunk& chunk)
+    {
+        vector<Corner> polygon;
+        while (p < end)
+        {
+            p = skipSpaces(p, end);
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (!eol) eol = end;
+            size_t length = size_t(eol - p);
+            auto keyword = [&](const char* word, size_t n) {
+                return length > n && strncmp(p, word, n) == 0 && (p[n] == ' ' || p[n] == '\t');
+            };
+            if (keyword("v", 1))
+            {
+                glm::vec3 v(0.0f);
+                parseFloat(parseFloat(parseFloat(p + 2, eol, v.x), eol, v.y), eol, v.z);
+                chunk.positions.push_back(v);
+            }
+            else if (keyword("vt", 2))
+            {
+                glm::vec2 t(0.0f);
+                parseFloat(parseFloat(p + 3, eol, t.x), eol, t.y);
+                chunk.texcoords.push_back(t);
+            }
+            else if (keyword("vn", 2))
+            {
+                glm::vec3 n(0.0f);
+                parseFloat(parseFloat(parseFloat(p + 3, eol, n.x), eol, n.y), eol, n.z);
+                chunk.normals.push_back(n);
+            }
+            else if (keyword("f", 1))
+            {
+                // v、v/t、v//n、v/t/n，多边形按扇形三角化，点和线丢弃
+                polygon.clear();
+                const char* q = skipSpaces(p + 2, eol);
+                while (q < eol && *q != '\r')
+                {
+                    Corner corner = {-1, -1, -1, 0};
+                    const char* next = parseIndex(q, eol, chunk.positions.size(), corner.v, corner.relative, 1);
+                    if (next == q) break;
+                    q = next;
+                    if (q < eol && *q == '/')
+                    {
+                        ++q;
+                        if (q < eol && *q != '/') q = parseIndex(q, eol, chunk.texcoords.size(), corner.t, corner.relative, 2);
+                        if (q < eol && *q == '/') q = parseIndex(q + 1, eol, chunk.normals.size(), corner.n, corner.relative, 4);
+                    }
+                    chunk.hasRelative |= corner.relative != 0;
+                    polygon.push_back(corner);
+                    q = skipSpaces(q, eol);
+                }
+                for (size_t i = 1; i + 1 < polygon.size(); ++i)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i]);
+                    chunk.corners.push_back(polygon[i + 1]);
+                }
+            }
+            else if (keyword("usemtl", 6))
+                chunk.materials.push_back({chunk.corners.size() / 3, rest(p + 7, eol)});
+            else if (keyword("mtllib", 6))
+                chunk.libraries.push_back(rest(p + 7, eol));
+            p = eol + 1;
+        }
+    }
+
+    // 由纹理坐标的变化求面的切线和副切线，与法线正交化
+    static void tangents(Vertex* v)
+    {
+        glm::vec3 e1 = v[1].Position - v[0].Position, e2 = v[2].Position - v[0].Position;
+        glm::vec2 d1 = v[1].TexCoords - v[0].TexCoords, d2 = v[2].TexCoords - v[0].TexCoords;
+        float det = d1.x * d2.y - d2.x * d1.y;
+        if (std::abs(det) < 1e-12f) return;
+        float r = 1.0f / det;
+        glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+        glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+        for (int k = 0; k < 3; ++k)
+        {
+            const glm::vec3& n = v[k].Normal;
+            glm::vec3 t = tangent - n * glm::dot(n, tangent);
+            glm::vec3 b = bitangent - n * glm::dot(n, bitangent);
+            v[k].Tangent = glm::dot(t, t) > 0.0f ? glm::normalize(t) : t;
+            v[k].Bitangent = glm::dot(b, b) > 0.0f ? glm::normalize(b) : b;
+        }
+    }
+
+    // MTL 中每个材质的纹理，类型的对应关系与 Assimp 的 OBJ 导入及 Model 的命名一致：
+    // map_Kd -> texture_diffuse，map_Ks -> texture_specular，map_Bump/bump -> texture_normal，map_Ka -> texture_height
+    static void parseMaterials(const string& path, unordered_map<string, vector<pair<string, string>>>& materials)
+    {
+        ifstream in(path);
+        if (!in) return;
+        static const char* const slots[][2] = {{"map_Kd", "texture_diffuse"}, {"map_Ks", "texture_specular"},
+                                               {"map_Bump", "texture_normal"}, {"map_bump", "texture_normal"},
+                                               {"bump", "texture_normal"}, {"map_Ka", "texture_height"}};
+        vector<pair<string, string>>* current = nullptr;
+        string line;
+        while (getline(in, line))
+        {
+            const char* p = skipSpaces(line.data(), line.data() + line.size());
+            const char* end = line.data() + line.size();
+            string keyword;
+            while (p < end && *p != ' ' && *p != '\t') keyword += *p++;
+            if (keyword == "newmtl")
+            {
+                current = &materials[rest(p, end)];
+                continue;
+            }
+            if (!current) continue;
+            for (int s = 0; s < int(sizeof(slots) / sizeof(slots[0])); ++s)
+            {
+                if (keyword != slots[s][0]) continue;
+                string file = texturePath(p, end);
+                if (file.empty()) break;
+                // 保持 Model::processMesh 中 diffuse、specular、normal、height 的顺序
+                pair<string, string> texture(file, slots[s][1]);
+                auto at = current->begin();
+                while (at != current->end() && slotOrder(at->second) <= slotOrder(texture.second)) ++at;
+                current->insert(at, texture);
+                break;
+            }
+        }
+    }
+
+    static int slotOrder(const string& type)
+    {
+        if (type == "texture_diffuse") return 0;
+        if (type == "texture_specular") return 1;
+        if (type == "texture_normal") return 2;
+        return 3;
+    }
+
+    // 跳过 -bm 1.0、-o u v w、-clamp on 之类的选项，剩余部分为文件名（可以带空格）
+    static string texturePath(const char* p, const char* end)
+    {
+        p = skipSpaces(p, end);
+        while (p < end && *p == '-')
+        {
+            while (p < end && *p != ' ' && *p != '\t') ++p;
+            p = skipSpaces(p, end);
+            while (p < end)
+            {
+                float value;
+                const char* next = parseFloat(p, end, value);
+                bool word = (end - p >= 2 && strncmp(p, "on", 2) == 0) || (end - p >= 3 && strncmp(p, "off", 3) == 0);
+                if (next != p && (next == end || *next == ' ' || *next == '\t')) p = skipSpaces(next, end);
+                else if (word) p = skipSpaces(p + (p[1] == 'n' ? 2 : 3), end);
+                else break;
+            }
+        }
+        return rest(p, end);
+    }
+};
+#endif
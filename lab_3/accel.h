@@ -0,0 +1,299 @@
+#ifndef ACCEL_H
+#define ACCEL_H
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+
+// 光线计数：每个线程先累加到 tracedRays，渲染线程结束时汇总到 totalRays
+thread_local long long tracedRays = 0;
+std::atomic<long long> totalRays(0);
+
+// 光线与场景求交的结果
+struct Hit {
+    float t;
+    vec3a normal;
+    const Object* object;
+};
+
+// 轴对齐包围盒，由物体的凸包点求出
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    void expand(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void expand(const AABB& b) {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    // 表面积的一半（空盒为 0），用于 SAH 中的相对面积
+    float halfArea() const {
+        glm::vec3 d = glm::max(max - min, glm::vec3(0.0f));
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    static AABB of(const Object* object) {
+        std::vector<glm::vec3> points;
+        object->convexHull(points);
+        AABB box;
+        for (const auto& p : points) box.expand(p);
+        return box;
+    }
+
+    // 光线与包围盒的 slab 求交，返回光线位于盒内的参数区间
+    bool intersect(const Ray& ray, float& tEnter, float& tExit) const {
+        tEnter = 0.0f;
+        tExit = std::numeric_limits<float>::max();
+        for (int a = 0; a < 3; ++a) {
+            float inv = 1.0f / ray.direction[a];
+            float t0 = (min[a] - ray.origin[a]) * inv;
+            float t1 = (max[a] - ray.origin[a]) * inv;
+            if (t0 > t1) std::swap(t0, t1);
+            tEnter = std::max(tEnter, t0);
+            tExit = std::min(tExit, t1);
+            if (tEnter > tExit) return false;
+        }
+        return true;
+    }
+};
+
+// 场景求交的加速结构，trace() 只通过这个接口访问物体
+class Accel {
+public:
+    virtual ~Accel() {}
+
+    virtual const char* name() const = 0;
+    virtual void build(const std::vector<Object*>& objects) = 0;
+    // 最近交点，只接受 t > 0.001 的交点（与原先逐个物体遍历的判定一致）
+    virtual bool intersect(const Ray& ray, Hit& hit) const = 0;
+    // 阴影查询：(0.001, maxT] 内是否有任意交点
+    virtual bool occluded(const Ray& ray, float maxT) const = 0;
+    // 加速结构本身占用的内存（不含物体）
+    virtual size_t memoryBytes() const = 0;
+};
+
+// 逐个测试 objects[0, count) 取最近交点，相同 t 时保留靠前的物体。
+// LinearAccel 和主光线的分块候选表（tile.h 中的 TileBins）共用
+inline bool intersectObjects(const Object* const* objects, size_t count, const Ray& ray, Hit& hit) {
+    hit.t = std::numeric_limits<float>::max();
+    hit.object = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        float t;
+        vec3a normal;
+        if (objects[i]->intersect(ray, t, normal) && t > 0.001f && t < hit.t) {
+            hit.t = t;
+            hit.object = objects[i];
+            hit.normal = normal;
+        }
+    }
+    return hit.object != nullptr;
+}
+
+// 逐个遍历全部物体
+class LinearAccel : public Accel {
+public:
+    const char* name() const override { return "Linear"; }
+
+    void build(const std::vector<Object*>& objects) override {
+        this->objects = objects;
+    }
+
+    bool intersect(const Ray& ray, Hit& hit) const override {
+        return intersectObjects(objects.data(), objects.size(), ray, hit);
+    }
+
+    bool occluded(const Ray& ray, float maxT) const override {
+        for (const auto* object : objects) {
+            float t;
+            vec3a normal;
+            if (object->intersect(ray, t, normal) && t > 0.001f && t <= maxT) return true;
+        }
+        return false;
+    }
+
+    size_t memoryBytes() const override {
+        return objects.capacity() * sizeof(Object*);
+    }
+
+private:
+    std::vector<Object*> objects;
+};
+
+// 均匀网格 + 3D-DDA 遍历。每个格子记录与其包围盒重叠的物体；
+// 光线按穿过的先后顺序访问格子，当已找到的最近交点落在当前格子之内时即可停止
+class GridAccel : public Accel {
+public:
+    // 每个物体对应的格子数，决定网格分辨率（经验值 2 ~ 5）
+    float cellsPerObject = 2.0f;
+    int maxResolution = 128;
+
+    const char* name() const override { return "Grid"; }
+
+    void build(const std::vector<Object*>& objects) override {
+        this->objects = objects;
+        bounds = AABB();
+        std::vector<AABB> boxes;
+        for (const auto* object : objects) {
+            boxes.push_back(AABB::of(object));
+            bounds.expand(boxes.back());
+        }
+        if (objects.empty()) {
+            res = glm::ivec3(0);
+            cellStart.assign(1, 0);
+            cellObjects.clear();
+            return;
+        }
+
+        // 扁平场景（如只有一面墙）在某一维上厚度为 0，适当外扩避免除零
+        glm::vec3 extent = bounds.max - bounds.min;
+        float pad = 1e-3f * std::max({extent.x, extent.y, extent.z, 1.0f});
+        bounds.min -= glm::vec3(pad);
+        bounds.max += glm::vec3(pad);
+        extent = bounds.max - bounds.min;
+
+        // 按物体密度自动选择分辨率：总格子数约为 cellsPerObject * N，格子尽量为立方体
+        float volume = extent.x * extent.y * extent.z;
+        float cellsPerUnit = std::cbrt(cellsPerObject * float(objects.size()) / volume);
+        for (int a = 0; a < 3; ++a)
+            res[a] = glm::clamp(int(std::ceil(extent[a] * cellsPerUnit)), 1, maxResolution);
+        cellSize = extent / glm::vec3(res);
+
+        // 两遍构建：先计数，再填入，得到紧凑的 CSR 形式
+        int cellCount = res.x * res.y * res.z;
+        cellStart.assign(cellCount + 1, 0);
+        for (int pass = 0; pass < 2; ++pass) {
+            if (pass == 1) {
+                for (int c = 0; c < cellCount; ++c) cellStart[c + 1] += cellStart[c];
+                cellObjects.assign(cellStart[cellCount], 0);
+            }
+            std::vector<unsigned int> fill(cellStart.begin(), cellStart.end() - 1);
+            for (size_t i = 0; i < boxes.size(); ++i) {
+                glm::ivec3 lo = cellOf(boxes[i].min), hi = cellOf(boxes[i].max);
+                for (int z = lo.z; z <= hi.z; ++z)
+                    for (int y = lo.y; y <= hi.y; ++y)
+                        for (int x = lo.x; x <= hi.x; ++x) {
+                            int c = (z * res.y + y) * res.x + x;
+                            if (pass == 0) cellStart[c + 1]++;
+                            else cellObjects[fill[c]++] = (unsigned int)i;
+                        }
+            }
+        }
+    }
+
+    bool intersect(const Ray& ray, Hit& hit) const override {
+        hit.t = std::numeric_limits<float>::max();
+        hit.object = nullptr;
+        traverse(ray, [&](const Object* object) {
+            float t;
+            vec3a normal;
+            if (object->intersect(ray, t, normal) && t > 0.001f && t < hit.t) {
+                hit.t = t;
+                hit.object = object;
+                hit.normal = normal;
+            }
+            return false;
+        }, [&](float cellExit) { return hit.object && hit.t <= cellExit; });
+        return hit.object != nullptr;
+    }
+
+    bool occluded(const Ray& ray, float maxT) const override {
+        bool blocked = false;
+        traverse(ray, [&](const Object* object) {
+            float t;
+            vec3a normal;
+            blocked = object->intersect(ray, t, normal) && t > 0.001f && t <= maxT;
+            return blocked;
+        }, [&](float cellExit) { return cellExit > maxT; });
+        return blocked;
+    }
+
+    size_t memoryBytes() const override {
+        return cellStart.capacity() * sizeof(unsigned int) +
+               cellObjects.capacity() * sizeof(unsigned int) +
+               objects.capacity() * sizeof(Object*);
+    }
+
+    glm::ivec3 resolution() const { return res; }
+
+private:
+    std::vector<Object*> objects;
+    AABB bounds;
+    glm::ivec3 res = glm::ivec3(0);
+    glm::vec3 cellSize = glm::vec3(1.0f);
+    std::vector<unsigned int> cellStart;   // 格子 c 的物体为 cellObjects[cellStart[c], cellStart[c + 1])
+    std::vector<unsigned int> cellObjects;
+
+    glm::ivec3 cellOf(const glm::vec3& p) const {
+        glm::ivec3 c = glm::ivec3((p - bounds.min) / cellSize);
+        return glm::clamp(c, glm::ivec3(0), res - 1);
+    }
+
+    // 3D-DDA：visit(object) 返回 true 时立即结束；
+    // stop(cellExit) 在离开每个格子前以格子出口参数调用，返回 true 时结束
+    template <typename Visit, typename Stop>
+    void traverse(const Ray& ray, Visit visit, Stop stop) const {
+        if (objects.empty()) return;
+        float tEnter, tExit;
+        if (!bounds.intersect(ray, tEnter, tExit)) return;
+
+        glm::ivec3 cell = cellOf(toVec3(ray.origin + tEnter * ray.direction));
+        glm::ivec3 step, end;
+        glm::vec3 tMax, tDelta;
+        for (int a = 0; a < 3; ++a) {
+            float d = ray.direction[a];
+            if (d > 0.0f) {
+                step[a] = 1;
+                end[a] = res[a];
+                tMax[a] = (bounds.min[a] + (cell[a] + 1) * cellSize[a] - ray.origin[a]) / d;
+                tDelta[a] = cellSize[a] / d;
+            } else if (d < 0.0f) {
+                step[a] = -1;
+                end[a] = -1;
+                tMax[a] = (bounds.min[a] + cell[a] * cellSize[a] - ray.origin[a]) / d;
+                tDelta[a] = -cellSize[a] / d;
+            } else {
+                step[a] = 0;
+                end[a] = -2;
+                tMax[a] = std::numeric_limits<float>::max();
+                tDelta[a] = std::numeric_limits<float>::max();
+            }
+        }
+
+        // 同一物体可能跨越多个格子，用 mailbox 记录已测试过的物体
+        thread_local std::vector<unsigned int> mailbox;
+        thread_local unsigned int rayId = 0;
+        if (mailbox.size() < objects.size()) mailbox.assign(objects.size(), 0);
+        if (++rayId == 0) {
+            std::fill(mailbox.begin(), mailbox.end(), 0);
+            rayId = 1;
+        }
+
+        while (true) {
+            int c = (cell.z * res.y + cell.y) * res.x + cell.x;
+            float cellExit = std::min({tMax.x, tMax.y, tMax.z});
+            for (unsigned int k = cellStart[c]; k < cellStart[c + 1]; ++k) {
+                unsigned int i = cellObjects[k];
+                if (mailbox[i] == rayId) continue;
+                mailbox[i] = rayId;
+                if (visit(objects[i])) return;
+            }
+            if (stop(cellExit)) return;
+
+            int a = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+            cell[a] += step[a];
+            if (cell[a] == end[a]) return;
+            tMax[a] += tDelta[a];
+        }
+    }
+};
+#endif
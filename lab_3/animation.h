@@ -0,0 +1,182 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "object.h"
+#include "accel.h"
+#include "tracer.h"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+
+// 相机关键帧：位置线性插值，姿态用四元数球面插值（与 lab_2 的物体动画相同）
+struct CameraKeyframe {
+    float time;
+    glm::vec3 position;
+    glm::quat rotation;     // 作用于初始朝向 (0, 0, -1) 和上方向 (0, 1, 0)
+    float fov;
+};
+
+struct LightKeyframe {
+    float time;
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+// 由位置和姿态得到相机参数：朝向为旋转后的 -z，绕朝向的转角使上方向与旋转后的 +y 一致
+inline Camera cameraFromPose(const glm::vec3& position, const glm::quat& rotation, float fov) {
+    glm::vec3 forward = glm::normalize(rotation * glm::vec3(0.0f, 0.0f, -1.0f));
+    glm::vec3 up = rotation * glm::vec3(0.0f, 1.0f, 0.0f);
+    // 与 CameraFrame 相同的未旋转上方向
+    glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 baseUp = glm::cross(right, forward);
+    float angle = glm::degrees(std::atan2(glm::dot(glm::cross(baseUp, up), forward), glm::dot(baseUp, up)));
+    return {position, forward, angle, fov};
+}
+
+// 关键帧动画路径，time 单调递增；两端之外取端点的值
+struct AnimationPath {
+    std::vector<CameraKeyframe> camera;
+    std::vector<LightKeyframe> light;
+    float duration = 1.0f;
+
+    Camera cameraAt(float time) const {
+        size_t i = segment(camera, time);
+        if (i + 1 >= camera.size()) {
+            const CameraKeyframe& k = camera[i];
+            return cameraFromPose(k.position, k.rotation, k.fov);
+        }
+        const CameraKeyframe& a = camera[i];
+        const CameraKeyframe& b = camera[i + 1];
+        float t = glm::clamp((time - a.time) / std::max(b.time - a.time, 1e-6f), 0.0f, 1.0f);
+        return cameraFromPose(glm::mix(a.position, b.position, t), glm::slerp(a.rotation, b.rotation, t), glm::mix(a.fov, b.fov, t));
+    }
+
+    Light lightAt(float time) const {
+        size_t i = segment(light, time);
+        if (i + 1 >= light.size()) return {light[i].position, light[i].color};
+        const LightKeyframe& a = light[i];
+        const LightKeyframe& b = light[i + 1];
+        float t = glm::clamp((time - a.time) / std::max(b.time - a.time, 1e-6f), 0.0f, 1.0f);
+        return {glm::mix(a.position, b.position, t), glm::mix(a.color, b.color, t)};
+    }
+
+    // frameCount 帧均匀分布在 [0, duration] 上，首尾两帧正好落在两端
+    float frameTime(int frame, int frameCount) const {
+        return frameCount > 1 ? duration * frame / (frameCount - 1) : 0.0f;
+    }
+
+private:
+    // time 所在区间的起始关键帧
+    template <typename Keyframe>
+    static size_t segment(const std::vector<Keyframe>& keys, float time) {
+        size_t i = 0;
+        while (i + 1 < keys.size() && keys[i + 1].time <= time) ++i;
+        return i;
+    }
+};
+
+// 写出二进制 PPM。像素缓冲的第 0 行在画面底部（与 OpenGL 纹理一致），写出时上下翻转
+inline bool writePPM(const std::string& path, const PixelBuffer& pixels, int width, int height) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int y = height - 1; y >= 0; --y)
+        std::fwrite(pixels.data() + size_t(y) * width * 3, 1, size_t(width) * 3, file);
+    return std::fclose(file) == 0;
+}
+
+// 第 frame 帧的输出文件名：prefix_0012.ppm
+inline std::string framePath(const std::string& prefix, int frame) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "_%04d.ppm", frame);
+    return prefix + name;
+}
+
+// 渲染路径上 [first, last) 之间的帧（总帧数为 frameCount）并写出到 prefix_NNNN.ppm。
+// 分辨率较低时单帧的 tile 数不足以让所有线程保持忙碌，这里把多帧的 tile 排成一个队列：
+// 线程按帧号、tile 号的顺序领取，最多 framesInFlight 帧同时在渲染，每帧最后一个 tile 完成的线程负责写出该帧。
+// 每个像素的结果只取决于该帧的相机和光源，与逐帧渲染的输出逐字节相同。
+// 多进程渲染时，各进程用不同的 [first, last) 分担同一条路径。
+// 光源逐帧移动，辐照度缓存和光子图都不能跨帧复用，序列渲染时不使用
+inline int renderSequence(const AnimationPath& path, const Accel& accel, int width, int height, int frameCount,
+                          int first, int last, const std::string& prefix, int framesInFlight = 4) {
+    first = std::max(first, 0);
+    last = std::min(last, frameCount);
+    if (first >= last) return 0;
+    bool irradianceEnabled = irradianceCache.enabled, photonsEnabled = photonMap.enabled;
+    irradianceCache.enabled = false;
+    photonMap.enabled = false;
+    framesInFlight = std::max(1, std::min(framesInFlight, last - first));
+
+    TileGrid grid(width, height);
+    int tilesPerFrame = grid.count();
+    long long totalItems = (long long)(last - first) * tilesPerFrame;
+
+    // 每个在渲染的帧占一个槽位，第 f 帧使用槽位 f % framesInFlight
+    struct Slot {
+        PixelBuffer pixels;
+        std::atomic<int> remaining;
+    };
+    std::unique_ptr<Slot[]> slots(new Slot[framesInFlight]);
+    for (int s = 0; s < framesInFlight; ++s) {
+        slots[s].pixels.resize(size_t(width) * height * 3);
+        slots[s].remaining = tilesPerFrame;
+    }
+    std::vector<CameraFrame> frames;
+    std::vector<Light> lights;
+    for (int f = first; f < last; ++f) {
+        float time = path.frameTime(f, frameCount);
+        frames.emplace_back(path.cameraAt(time), width, height);
+        lights.push_back(path.lightAt(time));
+    }
+
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    std::atomic<int> failed(0);
+    std::vector<char> done(last - first, 0);
+    std::atomic<long long> next(0);
+
+    std::vector<WorkerSlot> workers = planWorkers(renderSettings.placement, renderSettings.threads);
+    std::vector<std::thread> threads;
+    for (const auto& worker : workers) {
+        threads.emplace_back([&, worker]() {
+            pinCurrentThread(worker.cpu);
+            for (long long item = next++; item < totalItems; item = next++) {
+                int f = int(item / tilesPerFrame);
+                int tile = int(item % tilesPerFrame);
+                Slot& slot = slots[f % framesInFlight];
+                // 槽位被 framesInFlight 帧之前的帧占用时等待它写出。
+                // 那一帧的 tile 都已被领取，持有它们的线程不会等待更晚的帧，因此不会死锁
+                if (f >= framesInFlight) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    slotFreed.wait(lock, [&]() { return done[f - framesInFlight]; });
+                }
+                renderTile(slot.pixels, tile, grid, frames[f], accel, lights[f], nullptr, nullptr);
+                if (--slot.remaining == 0) {
+                    if (!writePPM(framePath(prefix, first + f), slot.pixels, width, height)) failed++;
+                    std::lock_guard<std::mutex> lock(mutex);
+                    slot.remaining = tilesPerFrame;
+                    done[f] = 1;
+                    slotFreed.notify_all();
+                }
+            }
+            totalRays += tracedRays;
+            tracedRays = 0;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    irradianceCache.enabled = irradianceEnabled;
+    photonMap.enabled = photonsEnabled;
+    return failed ? -1 : last - first;
+}
+#endif
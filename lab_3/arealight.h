@@ -0,0 +1,120 @@
+#ifndef AREALIGHT_H
+#define AREALIGHT_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "object.h"
+#include "accel.h"
+#include "envmap.h"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+// 面光源的阴影采样：把光源表面划分为 n x n 个分层，每层抖动取一个点，分别检测遮挡并着色后取平均。
+// 自适应时先在 k x k 个粗分层中各取一个细分层采样（共 initialSamples 个），全部可见或全部被挡时直接采用；
+// 结果不一致说明着色点处在半影中，再补齐其余的细分层，最终每个细分层恰好一个样本。
+// 全亮和全暗的区域只花几条阴影光线，样本集中在半影上
+class AreaLightSampler {
+public:
+    int initialSamples = 16;    // 每个着色点先取的样本数（按平方数取整为 k x k 个粗分层）
+    int penumbraSamples = 64;   // 半影中的总样本数（n x n 个细分层，n 取 k 的倍数）
+    bool adaptive = true;       // false 时每个点都直接取 penumbraSamples 个样本
+
+    // 自上次 resetStats() 以来着色的点数、按半影取满样本的点数和阴影光线数
+    std::atomic<long long> points{0};
+    std::atomic<long long> penumbraPoints{0};
+    std::atomic<long long> shadowRays{0};
+
+    void resetStats() {
+        points = 0;
+        penumbraPoints = 0;
+        shadowRays = 0;
+    }
+
+    // point 处（法线 normal）来自面光源的直接光照。shade(lightDir) 返回光源上一点在方向 lightDir 上
+    // 无遮挡时的贡献，与点光源的着色相同
+    template <typename Shade>
+    vec3a illuminate(const Light& light, const vec3a& point, const vec3a& normal, const Accel& accel, const Shade& shade) {
+        glm::vec3 p = toVec3(point);
+        HashRandom rng(p);
+        Ray shadowRay;
+        shadowRay.origin = point + normal * 0.001f; // 偏移以避免浮点精度问题
+        vec3a sum(0.0f);
+        int count = 0, visible = 0;
+        auto sample = [&](int i, int j, int strata) {
+            vec3a toLight = toAligned(samplePoint(light, p, i, j, strata, rng)) - point;
+            float distance = glm::length(toLight);
+            vec3a lightDir = toLight / distance;
+            shadowRay.direction = lightDir;
+            tracedRays++;
+            count++;
+            if (accel.occluded(shadowRay, distance)) return;
+            visible++;
+            sum += shade(lightDir);
+        };
+
+        // 细分层为 n x n，每 (n / k) x (n / k) 个细分层组成一个粗分层
+        int k = std::max(1, int(std::lround(std::sqrt(float(initialSamples)))));
+        int n = std::max(k, int(std::lround(std::sqrt(float(penumbraSamples)))));
+        n = (n + k - 1) / k * k;
+        int block = n / k;
+        if (!adaptive) {
+            for (int j = 0; j < n; ++j)
+                for (int i = 0; i < n; ++i) sample(i, j, n);
+        } else {
+            // 先在每个粗分层中随机选一个细分层采样
+            std::vector<char>& taken = takenStrata();
+            taken.assign(size_t(n) * n, 0);
+            for (int bj = 0; bj < k; ++bj)
+                for (int bi = 0; bi < k; ++bi) {
+                    int i = bi * block + std::min(int(rng.next() * block), block - 1);
+                    int j = bj * block + std::min(int(rng.next() * block), block - 1);
+                    taken[size_t(j) * n + i] = 1;
+                    sample(i, j, n);
+                }
+        }
+        bool penumbra = !adaptive || (visible != 0 && visible != count);
+        if (adaptive && penumbra) {
+            // 补齐其余的细分层，每个细分层恰好一个样本
+            const std::vector<char>& taken = takenStrata();
+            for (int j = 0; j < n; ++j)
+                for (int i = 0; i < n; ++i)
+                    if (!taken[size_t(j) * n + i]) sample(i, j, n);
+        }
+
+        points.fetch_add(1, std::memory_order_relaxed);
+        if (penumbra) penumbraPoints.fetch_add(1, std::memory_order_relaxed);
+        shadowRays.fetch_add(count, std::memory_order_relaxed);
+        return sum / float(count);
+    }
+
+    // 光源上第 (i, j) 个分层（共 strata x strata）内的随机点。
+    // 球光源从 p 看去是一个圆盘，在垂直于 p 方向的轮廓圆盘上按半径平方和角度分层
+    static glm::vec3 samplePoint(const Light& light, const glm::vec3& p, int i, int j, int strata, HashRandom& rng) {
+        float u = (i + rng.next()) / strata, v = (j + rng.next()) / strata;
+        if (light.shape == LIGHT_RECTANGLE)
+            return light.position + (u - 0.5f) * light.edgeU + (v - 0.5f) * light.edgeV;
+        if (light.shape == LIGHT_SPHERE) {
+            glm::vec3 w = p - light.position;
+            float length = glm::length(w);
+            w = length > 1e-6f ? w / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            glm::vec3 t = std::abs(w.x) > 0.5f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 b1 = glm::normalize(glm::cross(w, t)), b2 = glm::cross(w, b1);
+            float r = light.radius * std::sqrt(u), phi = 2.0f * glm::pi<float>() * v;
+            return light.position + r * (std::cos(phi) * b1 + std::sin(phi) * b2);
+        }
+        return light.position;
+    }
+
+private:
+    // 自适应采样时已经取过样本的细分层
+    static std::vector<char>& takenStrata() {
+        thread_local std::vector<char> taken;
+        return taken;
+    }
+};
+AreaLightSampler areaLights;
+#endif
@@ -0,0 +1,1318 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <glm/glm.hpp>
+
+#include "gpu.h"
+#include <GLFW/glfw3.h>
+
+#include "object.h"
+#include "accel.h"
+#include "tracer.h"
+#include "mesh.h"
+#include "animation.h"
+#include "stream.h"
+#include "scaling.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 基准测试用的场景，物体由场景自己持有
+struct BenchScene {
+    std::string name;
+    std::vector<std::unique_ptr<Object>> storage;
+    std::vector<Object*> objects;
+    Camera camera;
+    Light light;
+
+    template <typename T, typename... Args>
+    void add(Args&&... args) {
+        storage.emplace_back(new T(std::forward<Args>(args)...));
+        objects.push_back(storage.back().get());
+    }
+};
+
+inline double elapsedMs(std::chrono::steady_clock::time_point beg) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+}
+
+// 在地面上方的立方体内随机摆放 count 个小球；clusters > 0 时球集中在若干个小团簇里
+inline BenchScene makeSphereField(const std::string& name, int count, int clusters, float reflectivity = 0.2f) {
+    BenchScene scene;
+    scene.name = name;
+    scene.camera = {glm::vec3(0.0f, 2.0f, 12.0f), glm::vec3(0.0f, -0.15f, -1.0f), 0.0f, 60.0f};
+    scene.light = {glm::vec3(6.0f, 12.0f, 8.0f), glm::vec3(1.0f)};
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    std::vector<glm::vec3> centers;
+    for (int c = 0; c < clusters; ++c)
+        centers.push_back(glm::vec3(8.0f * uni(rng), 4.0f + 3.0f * uni(rng), 8.0f * uni(rng)));
+
+    float radius = 0.6f * std::cbrt(512.0f / count); // 球的总体积与数量无关
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 p(uni(rng), uni(rng), uni(rng));
+        glm::vec3 center = clusters > 0 ? centers[i % clusters] + 0.8f * p : glm::vec3(8.0f, 3.0f, 8.0f) * p + glm::vec3(0.0f, 4.0f, 0.0f);
+        glm::vec3 color = 0.5f + 0.5f * glm::vec3(uni(rng), uni(rng), uni(rng));
+        scene.add<Sphere>(center, clusters > 0 ? 0.2f * radius : radius, color, reflectivity);
+    }
+    scene.add<Wall>(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 40.0f, 40.0f, glm::vec3(0.6f), 0.1f);
+    return scene;
+}
+
+// 对每种场景和每种加速结构，测量构建时间、内存和整帧渲染的光线吞吐
+inline void benchAccel(const std::vector<Object*>& labObjects, int width, int height) {
+    std::vector<BenchScene> scenes;
+    scenes.emplace_back();
+    scenes.back().name = "lab";
+    scenes.back().objects = labObjects;
+    scenes.back().camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    scenes.back().light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    scenes.push_back(makeSphereField("uniform-1k", 1000, 0));
+    scenes.push_back(makeSphereField("uniform-10k", 10000, 0));
+    scenes.push_back(makeSphereField("clustered-10k", 10000, 8));
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+
+    std::cout << "accel benchmark, " << width << "x" << height << "\n";
+    std::cout << std::left << std::setw(16) << "scene" << std::setw(10) << "backend"
+              << std::right << std::setw(12) << "build ms" << std::setw(14) << "memory KB"
+              << std::setw(12) << "frame ms" << std::setw(14) << "Mrays/s" << "\n";
+    for (auto& scene : scenes) {
+        LinearAccel linear;
+        GridAccel grid;
+        for (Accel* accel : std::vector<Accel*>{&linear, &grid}) {
+            // 逐个遍历在万级物体时一帧需要数分钟，跳过
+            if (accel == &linear && scene.objects.size() > 2000) continue;
+
+            auto beg = std::chrono::steady_clock::now();
+            accel->build(scene.objects);
+            double buildMs = elapsedMs(beg);
+
+            totalRays = 0;
+            beg = std::chrono::steady_clock::now();
+            renderScene(buffer, width, height, scene.camera, scene.light, *accel, tiles);
+            double frameMs = elapsedMs(beg);
+
+            std::cout << std::left << std::setw(16) << scene.name << std::setw(10) << accel->name()
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << buildMs
+                      << std::setw(14) << accel->memoryBytes() / 1024.0
+                      << std::setw(12) << frameMs
+                      << std::setw(14) << totalRays / frameMs / 1000.0 << "\n";
+        }
+    }
+}
+
+// 末级缓存未命中计数，统计范围包括计数开始后创建的渲染线程。
+// 仅 Linux 可用，没有权限（perf_event_paranoid）或其他平台时返回 -1
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    void start() {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    long long stop() {
+#ifdef __linux__
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        // inherit 的计数在子线程退出后并入父计数器
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+#else
+        return -1;
+#endif
+    }
+
+private:
+    int fd = -1;
+};
+
+// 反射场景下，次级光线分组前后的吞吐和缓存未命中数
+inline void benchBinning(int width, int height) {
+    std::vector<BenchScene> scenes;
+    scenes.push_back(makeSphereField("glossy-10k", 10000, 0, 0.6f));
+    scenes.push_back(makeSphereField("mirror-10k", 10000, 0, 0.9f));
+    for (auto* object : scenes.back().objects) object->material = MATERIAL_MIRROR;
+    scenes.push_back(makeSphereField("mirror-clustered", 10000, 8, 0.9f));
+    for (auto* object : scenes.back().objects) object->material = MATERIAL_MIRROR;
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+    CacheMissCounter counter;
+
+    std::cout << "secondary ray binning benchmark, " << width << "x" << height << "\n";
+    std::cout << std::left << std::setw(18) << "scene" << std::setw(10) << "binning"
+              << std::right << std::setw(12) << "frame ms" << std::setw(12) << "Mrays/s"
+              << std::setw(16) << "cache misses" << std::setw(14) << "misses/ray" << "\n";
+    bool saved = renderSettings.binSecondaryRays;
+    for (auto& scene : scenes) {
+        GridAccel grid;
+        grid.build(scene.objects);
+        for (bool binning : {false, true}) {
+            renderSettings.binSecondaryRays = binning;
+            totalRays = 0;
+            counter.start();
+            auto beg = std::chrono::steady_clock::now();
+            renderScene(buffer, width, height, scene.camera, scene.light, grid, tiles);
+            double frameMs = elapsedMs(beg);
+            long long misses = counter.stop();
+
+            std::cout << std::left << std::setw(18) << scene.name << std::setw(10) << (binning ? "on" : "off")
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << frameMs
+                      << std::setw(12) << totalRays / frameMs / 1000.0;
+            if (misses >= 0)
+                std::cout << std::setw(16) << misses << std::setw(14) << double(misses) / totalRays << "\n";
+            else
+                std::cout << std::setw(16) << "n/a" << std::setw(14) << "n/a" << "\n";
+        }
+    }
+    renderSettings.binSecondaryRays = saved;
+}
+
+// 各种线程放置策略下，线程数从 1 倍增到全部可用线程时的帧时间和加速比
+inline void benchPlacement(int width, int height) {
+    BenchScene scene = makeSphereField("uniform-10k", 10000, 0);
+    GridAccel grid;
+    grid.build(scene.objects);
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+
+    const auto& cpus = cpuTopology();
+    int cores = 0, packages = 0, nodes = 0;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        bool newCore = true;
+        for (size_t j = 0; j < i; ++j)
+            if (cpus[j].core == cpus[i].core && cpus[j].package == cpus[i].package) newCore = false;
+        cores += newCore;
+        packages = std::max(packages, cpus[i].package + 1);
+        nodes = std::max(nodes, cpus[i].node + 1);
+    }
+    std::cout << "thread placement benchmark, " << scene.name << ", " << width << "x" << height << ", "
+              << cpus.size() << " logical cpus, " << cores << " cores, " << packages << " packages, " << nodes << " numa nodes\n";
+    std::cout << std::left << std::setw(10) << "policy" << std::right << std::setw(10) << "threads"
+              << std::setw(12) << "frame ms" << std::setw(12) << "Mrays/s" << std::setw(10) << "speedup" << "\n";
+
+    RenderSettings saved = renderSettings;
+    double baseMs = 0.0;
+    for (int p = 0; p < PLACEMENT_COUNT; ++p) {
+        renderSettings.placement = PlacementPolicy(p);
+        int maxThreads = (int)planWorkers(renderSettings.placement).size();
+        for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+            renderSettings.threads = threads;
+            // 每种配置使用新分配的帧缓冲，让 first-touch 按本次的线程放置生效
+            PixelBuffer buffer(width * height * 3);
+            renderScene(buffer, width, height, scene.camera, scene.light, grid, tiles); // 预热
+            totalRays = 0;
+            auto beg = std::chrono::steady_clock::now();
+            renderScene(buffer, width, height, scene.camera, scene.light, grid, tiles);
+            double frameMs = elapsedMs(beg);
+            if (baseMs == 0.0) baseMs = frameMs;
+
+            std::cout << std::left << std::setw(10) << placementNames[p]
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(10) << threads
+                      << std::setw(12) << frameMs
+                      << std::setw(12) << totalRays / frameMs / 1000.0
+                      << std::setw(10) << baseMs / frameMs << "\n";
+            if (threads == maxThreads) break;
+        }
+    }
+    renderSettings = saved;
+}
+
+// resolution x resolution 的起伏地形，共 2 * resolution^2 个三角形，覆盖 [-size/2, size/2]^2
+inline std::vector<Triangle> makeTerrain(int resolution, float size) {
+    auto height = [&](int i, int j) {
+        float x = float(i) / resolution * 12.0f, z = float(j) / resolution * 12.0f;
+        return 0.6f * std::sin(x) * std::cos(1.3f * z) + 0.25f * std::sin(3.1f * x + 2.0f * z);
+    };
+    auto vertex = [&](int i, int j) {
+        return glm::vec3((float(i) / resolution - 0.5f) * size, height(i, j), (float(j) / resolution - 0.5f) * size);
+    };
+    std::vector<Triangle> triangles;
+    triangles.reserve(size_t(2) * resolution * resolution);
+    for (int j = 0; j < resolution; ++j)
+        for (int i = 0; i < resolution; ++i) {
+            triangles.push_back({vertex(i, j), vertex(i, j + 1), vertex(i + 1, j)});
+            triangles.push_back({vertex(i + 1, j), vertex(i, j + 1), vertex(i + 1, j + 1)});
+        }
+    return triangles;
+}
+
+// 半径约为 radius、表面起伏的球面网格，共 2 * rings * segments 个三角形
+inline std::vector<Triangle> makeBumpySphere(int rings, int segments, float radius, const glm::vec3& center) {
+    auto vertex = [&](int i, int j) {
+        float theta = glm::pi<float>() * i / rings, phi = 2.0f * glm::pi<float>() * j / segments;
+        float r = radius * (1.0f + 0.05f * std::sin(9.0f * theta) * std::sin(7.0f * phi));
+        return center + r * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+    };
+    std::vector<Triangle> triangles;
+    triangles.reserve(size_t(2) * rings * segments);
+    for (int i = 0; i < rings; ++i)
+        for (int j = 0; j < segments; ++j) {
+            triangles.push_back({vertex(i, j), vertex(i + 1, j), vertex(i, j + 1)});
+            triangles.push_back({vertex(i, j + 1), vertex(i + 1, j), vertex(i + 1, j + 1)});
+        }
+    return triangles;
+}
+
+// 二叉 BVH 与 8 叉压缩 BVH 的节点内存和光线吞吐，8 叉节点分别用标量和 AVX2 测试子节点
+inline void benchBVH(int width, int height) {
+    std::vector<BenchScene> scenes(2);
+    scenes[0].name = "terrain-2M";
+    scenes[0].add<TriangleMesh>(makeTerrain(1024, 40.0f), glm::vec3(0.5f, 0.7f, 0.4f), 0.0f);
+    scenes[0].camera = {glm::vec3(-6.0f, 4.0f, 10.0f), glm::vec3(0.3f, -0.35f, -1.0f), 0.0f, 60.0f};
+    scenes[0].light = {glm::vec3(0.0f, 30.0f, 10.0f), glm::vec3(1.0f)};
+    scenes[1].name = "sphere-1M";
+    scenes[1].add<TriangleMesh>(makeBumpySphere(512, 1024, 2.0f, glm::vec3(0.0f, 2.0f, 0.0f)), glm::vec3(0.8f, 0.3f, 0.3f), 0.3f);
+    scenes[1].add<Wall>(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 20.0f, 20.0f, glm::vec3(0.6f), 0.3f);
+    scenes[1].camera = {glm::vec3(0.0f, 3.0f, 7.0f), glm::vec3(0.0f, -0.2f, -1.0f), 0.0f, 60.0f};
+    scenes[1].light = {glm::vec3(6.0f, 12.0f, 8.0f), glm::vec3(1.0f)};
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+
+    std::cout << "bvh node format benchmark, " << width << "x" << height << (cpuHasAVX2() ? "" : " (no AVX2 on this cpu)") << "\n";
+    std::cout << std::left << std::setw(14) << "scene" << std::setw(14) << "nodes"
+              << std::right << std::setw(12) << "node KB" << std::setw(12) << "frame ms" << std::setw(12) << "Mrays/s" << "\n";
+    bool saved = bvhUseAVX2;
+    for (auto& scene : scenes) {
+        TriangleMesh* mesh = static_cast<TriangleMesh*>(scene.objects[0]);
+        GridAccel grid;
+        grid.build(scene.objects);
+        for (int mode = 0; mode < 3; ++mode) {
+            if (mode == 2 && !cpuHasAVX2()) continue;
+            mesh->setWide(mode > 0);
+            bvhUseAVX2 = mode == 2;
+            totalRays = 0;
+            auto beg = std::chrono::steady_clock::now();
+            renderScene(buffer, width, height, scene.camera, scene.light, grid, tiles);
+            double frameMs = elapsedMs(beg);
+            const char* names[] = {"binary", "wide-scalar", "wide-avx2"};
+            std::cout << std::left << std::setw(14) << scene.name << std::setw(14) << names[mode]
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << (mode > 0 ? mesh->wideNodeBytes() : mesh->binaryNodeBytes()) / 1024.0
+                      << std::setw(12) << frameMs
+                      << std::setw(12) << totalRays / frameMs / 1000.0 << "\n";
+        }
+    }
+    bvhUseAVX2 = saved;
+}
+
+// 三种 BVH 构建方式在大网格上的构建耗时、SAH 代价和渲染一帧的耗时（二叉 BVH 与 8 叉 BVH）
+inline void benchBVHBuild(int width, int height) {
+    struct MeshScene {
+        const char* name;
+        std::vector<Triangle> triangles;
+        Camera camera;
+        Light light;
+    };
+    std::vector<MeshScene> scenes(2);
+    scenes[0] = {"terrain-2M", makeTerrain(1024, 40.0f),
+                 {glm::vec3(-6.0f, 4.0f, 10.0f), glm::vec3(0.3f, -0.35f, -1.0f), 0.0f, 60.0f},
+                 {glm::vec3(0.0f, 30.0f, 10.0f), glm::vec3(1.0f)}};
+    scenes[1] = {"sphere-1M", makeBumpySphere(512, 1024, 2.0f, glm::vec3(0.0f, 2.0f, 0.0f)),
+                 {glm::vec3(0.0f, 3.0f, 7.0f), glm::vec3(0.0f, -0.2f, -1.0f), 0.0f, 60.0f},
+                 {glm::vec3(6.0f, 12.0f, 8.0f), glm::vec3(1.0f)}};
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+
+    std::cout << "bvh builder benchmark, " << width << "x" << height << ", " << std::max(1u, std::thread::hardware_concurrency()) << " threads\n";
+    std::cout << std::left << std::setw(14) << "scene" << std::setw(10) << "builder"
+              << std::right << std::setw(12) << "build ms" << std::setw(12) << "SAH cost" << std::setw(12) << "nodes"
+              << std::setw(12) << "binary ms" << std::setw(12) << "wide ms" << "\n";
+    for (auto& scene : scenes) {
+        for (int b = 0; b < BVH_BUILD_COUNT; ++b) {
+            TriangleMesh mesh(scene.triangles, glm::vec3(0.6f), 0.0f, BVHBuilder(b));
+            std::vector<Object*> objects = {&mesh};
+            GridAccel grid;
+            grid.build(objects);
+            double frameMs[2];
+            for (int wide = 0; wide < 2; ++wide) {
+                mesh.setWide(wide != 0);
+                auto beg = std::chrono::steady_clock::now();
+                renderScene(buffer, width, height, scene.camera, scene.light, grid, tiles);
+                frameMs[wide] = elapsedMs(beg);
+            }
+            const BVHBuildStats& stats = mesh.buildStats();
+            std::cout << std::left << std::setw(14) << scene.name << std::setw(10) << bvhBuilderNames[b]
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << stats.ms << std::setw(12) << stats.sahCost << std::setw(12) << mesh.binaryNodeCount()
+                      << std::setw(12) << frameMs[0] << std::setw(12) << frameMs[1] << "\n";
+        }
+    }
+}
+
+// BVH 缓存：第一次打开网格时构建并写入缓存，之后直接读入；几何被修改或缓存文件损坏时应检测到并重建。
+// 每一步都与不用缓存构建的网格比较渲染结果
+inline void benchBVHCache(int width, int height) {
+    std::string path = "bench_terrain.bvhc";
+    std::remove(path.c_str());
+    std::vector<Triangle> triangles = makeTerrain(1024, 40.0f);
+    Camera camera = {glm::vec3(-6.0f, 4.0f, 10.0f), glm::vec3(0.3f, -0.35f, -1.0f), 0.0f, 60.0f};
+    Light light = {glm::vec3(0.0f, 30.0f, 10.0f), glm::vec3(1.0f)};
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    auto render = [&](TriangleMesh& mesh) {
+        std::vector<Object*> objects = {&mesh};
+        GridAccel grid;
+        grid.build(objects);
+        PixelBuffer buffer(width * height * 3);
+        renderScene(buffer, width, height, camera, light, grid, tiles);
+        return buffer;
+    };
+
+    std::cout << "bvh cache benchmark, " << triangles.size() << " triangles, sah builder\n";
+    std::cout << std::left << std::setw(14) << "step" << std::setw(8) << "cache"
+              << std::right << std::setw(12) << "open ms" << std::setw(12) << "bvh ms" << std::setw(12) << "file MB" << std::setw(10) << "image" << "\n";
+    auto step = [&](const char* name) {
+        auto beg = std::chrono::steady_clock::now();
+        TriangleMesh mesh(triangles, glm::vec3(0.5f, 0.7f, 0.4f), 0.0f, BVH_BUILD_SAH, path);
+        double openMs = elapsedMs(beg);
+        TriangleMesh reference(triangles, glm::vec3(0.5f, 0.7f, 0.4f), 0.0f, BVH_BUILD_SAH);
+        bool same = render(mesh) == render(reference);
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        std::cout << std::left << std::setw(14) << name << std::setw(8) << (mesh.loadedFromCache() ? "hit" : "miss")
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << openMs << std::setw(12) << mesh.buildStats().ms
+                  << std::setw(12) << (file ? double(file.tellg()) / (1 << 20) : 0.0)
+                  << std::setw(10) << (same ? "same" : "DIFFERS") << "\n";
+    };
+
+    step("cold");
+    step("warm");
+    // 抬高一个顶点，缓存的键随之变化
+    triangles[triangles.size() / 2].v0.y += 0.5f;
+    step("edited");
+    step("warm");
+    // 截断缓存文件，模拟写到一半的旧文件
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() / 2);
+    }
+    step("truncated");
+    step("warm");
+    std::remove(path.c_str());
+}
+
+// 映射文件中的大网格：相机掠过地形时每帧实际访问、新读入和换出的字节数。
+// 驻留预算远小于文件大小，用来模拟比内存大的网格
+inline void benchOutOfCore(int width, int height) {
+    std::string path = "bench_terrain.clmh";
+    auto beg = std::chrono::steady_clock::now();
+    if (!writeClusterFile(path, makeTerrain(1024, 40.0f))) {
+        std::cerr << "failed to write " << path << "\n";
+        return;
+    }
+    double writeMs = elapsedMs(beg);
+
+    ClusterMesh mesh(glm::vec3(0.5f, 0.7f, 0.4f), 0.0f);
+    if (!mesh.open(path)) {
+        std::cerr << "failed to open " << path << "\n";
+        return;
+    }
+    mesh.residentBudget = size_t(8) << 20;
+    std::vector<Object*> objects = {&mesh};
+    GridAccel grid;
+    grid.build(objects);
+    Light light = {glm::vec3(0.0f, 30.0f, 10.0f), glm::vec3(1.0f)};
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+
+    std::cout << "out-of-core mesh benchmark, " << mesh.triangleCount() << " triangles, " << mesh.clusterCount() << " clusters, "
+              << mesh.fileBytes() / 1024 << " KB file (written in " << int(writeMs) << " ms), "
+              << mesh.residentBudget / 1024 << " KB budget, " << width << "x" << height << "\n";
+    std::cout << std::setw(6) << "frame" << std::setw(12) << "frame ms" << std::setw(14) << "touched KB"
+              << std::setw(12) << "loaded KB" << std::setw(14) << "evicted KB" << std::setw(14) << "resident KB" << "\n";
+    for (int f = 0; f < 8; ++f) {
+        // 低空沿 x 方向飞过地形，视野内的簇逐帧变化
+        Camera camera = {glm::vec3(-14.0f + 4.0f * f, 3.0f, 6.0f), glm::vec3(0.3f, -0.35f, -1.0f), 0.0f, 60.0f};
+        beg = std::chrono::steady_clock::now();
+        renderScene(buffer, width, height, camera, light, grid, tiles);
+        double frameMs = elapsedMs(beg);
+        const ClusterStats& stats = mesh.endFrame();
+        std::cout << std::setw(6) << f << std::fixed << std::setprecision(2) << std::setw(12) << frameMs
+                  << std::setw(14) << stats.touchedBytes / 1024 << std::setw(12) << stats.loadedBytes / 1024
+                  << std::setw(14) << stats.evictedBytes / 1024 << std::setw(14) << stats.residentBytes / 1024 << "\n";
+    }
+    std::remove(path.c_str());
+}
+
+// 实验场景的演示路径：相机从原点平移并转向右侧的球，光源从右侧移到上方
+inline AnimationPath makeDemoPath() {
+    AnimationPath path;
+    path.duration = 1.0f;
+    path.camera = {{0.0f, glm::vec3(0.0f), glm::quat(glm::vec3(0.0f)), 90.0f},
+                   {1.0f, glm::vec3(-1.0f, 0.5f, -1.0f), glm::quat(glm::vec3(glm::radians(-15.0f), glm::radians(-20.0f), 0.0f)), 70.0f}};
+    path.light = {{0.0f, glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)},
+                  {1.0f, glm::vec3(0.0f, 4.0f, -2.0f), glm::vec3(1.0f, 0.9f, 0.8f)}};
+    return path;
+}
+
+inline bool sameFile(const std::string& a, const std::string& b) {
+    std::ifstream fa(a, std::ios::binary), fb(b, std::ios::binary);
+    std::string da((std::istreambuf_iterator<char>(fa)), std::istreambuf_iterator<char>());
+    std::string db((std::istreambuf_iterator<char>(fb)), std::istreambuf_iterator<char>());
+    return fa && fb && !da.empty() && da == db;
+}
+
+// 低分辨率动画序列：逐帧调用 renderScene 与多帧同时渲染的总时间，并逐字节比较输出
+inline void benchAnimation(const std::vector<Object*>& labObjects) {
+    const int width = 160, height = 120, frameCount = 48;
+    AnimationPath path = makeDemoPath();
+    GridAccel grid;
+    grid.build(labObjects);
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+
+    std::cout << "animation benchmark, " << frameCount << " frames, " << width << "x" << height << ", "
+              << tiles.size() << " tiles per frame, " << planWorkers(renderSettings.placement, renderSettings.threads).size() << " threads\n";
+    std::cout << std::left << std::setw(18) << "schedule" << std::right << std::setw(12) << "total ms"
+              << std::setw(12) << "frames/s" << std::setw(12) << "identical" << "\n";
+
+    auto beg = std::chrono::steady_clock::now();
+    for (int f = 0; f < frameCount; ++f) {
+        float time = path.frameTime(f, frameCount);
+        renderScene(buffer, width, height, path.cameraAt(time), path.lightAt(time), grid, tiles);
+        writePPM(framePath("bench_ref", f), buffer, width, height);
+    }
+    double ms = elapsedMs(beg);
+    std::cout << std::left << std::setw(18) << "frame by frame" << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << ms << std::setw(12) << frameCount * 1000.0 / ms << std::setw(12) << "-" << "\n";
+
+    for (int inFlight : {1, 2, 4, 8}) {
+        beg = std::chrono::steady_clock::now();
+        renderSequence(path, grid, width, height, frameCount, 0, frameCount, "bench_seq", inFlight);
+        ms = elapsedMs(beg);
+        bool identical = true;
+        for (int f = 0; f < frameCount; ++f) {
+            identical &= sameFile(framePath("bench_ref", f), framePath("bench_seq", f));
+            std::remove(framePath("bench_seq", f).c_str());
+        }
+        std::cout << std::left << std::setw(18) << (std::to_string(inFlight) + " in flight") << std::right
+                  << std::setw(12) << ms << std::setw(12) << frameCount * 1000.0 / ms << std::setw(12) << (identical ? "yes" : "NO") << "\n";
+    }
+    for (int f = 0; f < frameCount; ++f) std::remove(framePath("bench_ref", f).c_str());
+}
+
+// 热路径向量类型的对比：分别用默认构建和 SIMD 构建（见 simd.h）运行，比较两次输出的帧时间。
+// 每个场景取 5 帧中最快的一帧，减少线程调度的干扰
+inline void benchSimd(const std::vector<Object*>& labObjects, int width, int height) {
+    std::vector<BenchScene> scenes;
+    scenes.emplace_back();
+    scenes.back().name = "lab";
+    scenes.back().objects = labObjects;
+    scenes.back().camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    scenes.back().light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    scenes.push_back(makeSphereField("uniform-1k", 1000, 0));
+    scenes.push_back(makeSphereField("mirror-1k", 1000, 0, 0.8f));
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+
+    std::cout << "simd benchmark, " << width << "x" << height << ", build: " << simdBuildName
+              << ", sizeof(Ray) = " << sizeof(Ray) << ", sizeof(HitRecord) = " << sizeof(HitRecord) << "\n";
+    std::cout << std::left << std::setw(16) << "scene" << std::setw(10) << "backend"
+              << std::right << std::setw(12) << "frame ms" << std::setw(14) << "Mrays/s" << "\n";
+    for (auto& scene : scenes) {
+        LinearAccel linear;
+        GridAccel grid;
+        Accel* accel = scene.objects.size() > 100 ? static_cast<Accel*>(&grid) : &linear;
+        accel->build(scene.objects);
+
+        double best = std::numeric_limits<double>::max();
+        long long rays = 0;
+        for (int run = 0; run < 5; ++run) {
+            totalRays = 0;
+            auto beg = std::chrono::steady_clock::now();
+            renderScene(buffer, width, height, scene.camera, scene.light, *accel, tiles);
+            double frameMs = elapsedMs(beg);
+            if (frameMs < best) {
+                best = frameMs;
+                rays = totalRays;
+            }
+        }
+        std::cout << std::left << std::setw(16) << scene.name << std::setw(10) << accel->name()
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << best << std::setw(14) << rays / best / 1000.0 << "\n";
+    }
+}
+
+// 辐照度缓存：实验场景中只有直接光照、缓存首帧（新建记录）、相机移动后复用记录的帧时间；
+// 再以每个像素都做半球采样（accuracy = 0）的结果为参考，比较低分辨率下的耗时和平均像素误差
+inline void benchIrradiance(const std::vector<Object*>& labObjects, int width, int height) {
+    Camera camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    Camera moved = {glm::vec3(0.3f, 0.2f, 0.0f), glm::vec3(0.1f, 0.0f, -1.0f), 0.0f, 90.0f};
+    Light light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    LinearAccel accel;
+    accel.build(labObjects);
+    bool enabled = irradianceCache.enabled;
+    float accuracy = irradianceCache.accuracy;
+
+    std::cout << "irradiance cache benchmark, " << width << "x" << height << ", accuracy " << irradianceCache.accuracy << "\n";
+    std::cout << std::left << std::setw(22) << "frame" << std::right << std::setw(12) << "frame ms"
+              << std::setw(12) << "records" << std::setw(14) << "computed" << "\n";
+    auto run = [&](const char* name, int w, int h, const Camera& cam, PixelBuffer& buffer) {
+        std::vector<int> tiles;
+        for (int i = 0; i < TileGrid(w, h).count(); ++i) tiles.push_back(i);
+        buffer.resize(size_t(w) * h * 3);
+        long long computed = irradianceCache.computed;
+        auto beg = std::chrono::steady_clock::now();
+        renderScene(buffer, w, h, cam, light, accel, tiles);
+        double ms = elapsedMs(beg);
+        std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << ms << std::setw(12) << irradianceCache.size()
+                  << std::setw(14) << irradianceCache.computed - computed << "\n";
+    };
+
+    PixelBuffer buffer, reference;
+    irradianceCache.enabled = false;
+    run("direct only", width, height, camera, buffer);
+    irradianceCache.enabled = true;
+    irradianceCache.clear(labObjects);
+    run("cache, first frame", width, height, camera, buffer);
+    run("cache, camera moved", width, height, moved, buffer);
+    run("cache, static", width, height, moved, buffer);
+
+    // 参考解：accuracy 为 0 时任何记录都不能插值，每次查询都做半球采样
+    const int w = 160, h = 120;
+    irradianceCache.clear(labObjects);
+    run("cache, 160x120", w, h, camera, buffer);
+    irradianceCache.accuracy = 0.0f;
+    irradianceCache.clear(labObjects);
+    run("per pixel, 160x120", w, h, camera, reference);
+    irradianceCache.accuracy = accuracy;
+    double error = 0.0;
+    for (size_t i = 0; i < buffer.size(); ++i) error += std::abs(int(buffer[i]) - int(reference[i]));
+    std::cout << "mean abs difference to per-pixel sampling: " << error / buffer.size() << " / 255\n";
+
+    irradianceCache.enabled = enabled;
+    irradianceCache.clear(labObjects);
+}
+
+// 环境光：只有程序化天空照明（点光源关闭）的球阵，分别用重要性采样和余弦加权采样渲染，
+// 与高采样数的参考图比较均方根误差，看两者达到相同误差各需要多少样本
+inline void benchEnvironment(int width, int height) {
+    BenchScene scene = makeSphereField("uniform-200", 200, 0);
+    scene.light.color = glm::vec3(0.0f);
+    GridAccel grid;
+    grid.build(scene.objects);
+    EnvironmentMap saved = environment;
+    if (!environment.loaded()) environment.makeSky();
+    environment.enabled = true;
+
+    // 每个像素都做环境光采样，降低分辨率以控制参考图的耗时
+    int w = width / 4, h = height / 4;
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(w, h).count(); ++i) tiles.push_back(i);
+    auto render = [&](bool importance, int samples, PixelBuffer& buffer) {
+        environment.importance = importance;
+        environment.samples = samples;
+        buffer.resize(size_t(w) * h * 3);
+        auto beg = std::chrono::steady_clock::now();
+        renderScene(buffer, w, h, scene.camera, scene.light, grid, tiles);
+        return elapsedMs(beg);
+    };
+    auto rmse = [](const PixelBuffer& a, const PixelBuffer& b) {
+        double sum = 0.0;
+        for (size_t i = 0; i < a.size(); ++i) sum += double(int(a[i]) - int(b[i])) * (int(a[i]) - int(b[i]));
+        return std::sqrt(sum / a.size());
+    };
+
+    PixelBuffer reference, buffer;
+    const int referenceSamples = 1024;
+    double referenceMs = render(true, referenceSamples, reference);
+    std::cout << "environment light benchmark, " << w << "x" << h << ", " << environment.width() << "x" << environment.height()
+              << " map, " << environment.levelCount() << " mip levels, reference " << referenceSamples << " importance samples ("
+              << int(referenceMs) << " ms)\n";
+    std::cout << std::right << std::setw(8) << "samples" << std::setw(14) << "cosine RMSE" << std::setw(12) << "cosine ms"
+              << std::setw(16) << "importance RMSE" << std::setw(15) << "importance ms" << "\n";
+    for (int samples : {1, 4, 16, 64, 256}) {
+        double cosineMs = render(false, samples, buffer);
+        double cosineError = rmse(buffer, reference);
+        double importanceMs = render(true, samples, buffer);
+        double importanceError = rmse(buffer, reference);
+        std::cout << std::setw(8) << samples << std::fixed << std::setprecision(2)
+                  << std::setw(14) << cosineError << std::setw(12) << cosineMs
+                  << std::setw(16) << importanceError << std::setw(15) << importanceMs << "\n";
+    }
+    environment = saved;
+}
+
+// 面光源：同一个球阵分别用点光源、矩形和球形面光源照明。面光源比较每点固定采样和自适应采样
+// （先取少量样本，半影处补采）的帧时间、每点阴影光线数，以及与 1024 个固定样本的参考图的均方根误差
+inline void benchAreaLight(int width, int height) {
+    BenchScene scene = makeSphereField("uniform-200", 200, 0);
+    GridAccel grid;
+    grid.build(scene.objects);
+    // 参考图每点 1024 条阴影光线，降低分辨率以控制耗时
+    width /= 2;
+    height /= 2;
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    int initial = areaLights.initialSamples, penumbra = areaLights.penumbraSamples;
+    bool adaptive = areaLights.adaptive;
+
+    auto render = [&](const Light& light, bool adaptiveSampling, int samples, PixelBuffer& buffer) {
+        areaLights.adaptive = adaptiveSampling;
+        areaLights.penumbraSamples = samples;
+        areaLights.resetStats();
+        buffer.resize(size_t(width) * height * 3);
+        auto beg = std::chrono::steady_clock::now();
+        renderScene(buffer, width, height, scene.camera, light, grid, tiles);
+        return elapsedMs(beg);
+    };
+    auto rmse = [](const PixelBuffer& a, const PixelBuffer& b) {
+        double sum = 0.0;
+        for (size_t i = 0; i < a.size(); ++i) sum += double(int(a[i]) - int(b[i])) * (int(a[i]) - int(b[i]));
+        return std::sqrt(sum / a.size());
+    };
+
+    std::cout << "area light benchmark, " << width << "x" << height << ", " << scene.name << ", adaptive starts with "
+              << areaLights.initialSamples << " samples\n";
+    std::cout << std::left << std::setw(12) << "light" << std::setw(18) << "sampling"
+              << std::right << std::setw(12) << "frame ms" << std::setw(14) << "rays/point" << std::setw(12) << "penumbra"
+              << std::setw(10) << "RMSE" << "\n";
+    PixelBuffer buffer, reference;
+    Light point = scene.light;
+    double pointMs = render(point, true, penumbra, buffer);
+    std::cout << std::left << std::setw(12) << "point" << std::setw(18) << "1 shadow ray" << std::right << std::fixed
+              << std::setprecision(2) << std::setw(12) << pointMs << "\n";
+
+    Light rectangle = scene.light;
+    rectangle.shape = LIGHT_RECTANGLE;
+    rectangle.edgeU = glm::vec3(3.0f, 0.0f, 0.0f);
+    rectangle.edgeV = glm::vec3(0.0f, 0.0f, 3.0f);
+    Light sphere = scene.light;
+    sphere.shape = LIGHT_SPHERE;
+    sphere.radius = 1.5f;
+    for (auto& [name, light] : {std::pair<const char*, Light>{"rectangle", rectangle}, {"sphere", sphere}}) {
+        render(light, false, 1024, reference);
+        for (int samples : {64, 256}) {
+            for (bool adaptiveSampling : {false, true}) {
+                double ms = render(light, adaptiveSampling, samples, buffer);
+                std::string sampling = (adaptiveSampling ? "adaptive " : "fixed ") + std::to_string(samples);
+                std::cout << std::left << std::setw(12) << name << std::setw(18) << sampling << std::right
+                          << std::setw(12) << ms << std::setw(14) << double(areaLights.shadowRays) / std::max(1LL, areaLights.points.load())
+                          << std::setw(11) << 100.0 * areaLights.penumbraPoints / std::max(1LL, areaLights.points.load()) << "%"
+                          << std::setw(10) << rmse(buffer, reference) << "\n";
+            }
+        }
+    }
+    areaLights.initialSamples = initial;
+    areaLights.penumbraSamples = penumbra;
+    areaLights.adaptive = adaptive;
+    areaLights.resetStats();
+}
+
+// 焦散光子图：实验场景换成镜面球，分别用单线程和全部渲染线程追踪光子、构建 kd-tree，
+// 再比较不开启和开启焦散时的帧时间，以及 k 近邻查询的次数和耗时
+inline void benchPhoton(int width, int height) {
+    BenchScene scene;
+    scene.name = "mirror lab";
+    scene.add<Sphere>(glm::vec3(-1.0f, -1.0f, -4.0f), 1.0f, glm::vec3(1.0f, 0.0f, 0.0f), 0.9f);
+    scene.add<Sphere>(glm::vec3(1.0f, -1.0f, -4.0f), 1.0f, glm::vec3(0.0f, 0.0f, 1.0f), 0.9f);
+    scene.add<Wall>(glm::vec3(0.0f, -2.0f, -3.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 20.0f, 20.0f, glm::vec3(0.5f, 0.3f, 0.1f), 0.0f);
+    scene.add<Wall>(glm::vec3(-2.0f, 0.0f, -3.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 20.0f, 20.0f, glm::vec3(1.0f), 0.0f);
+    scene.add<Wall>(glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), 20.0f, 20.0f, glm::vec3(1.0f), 0.0f);
+    for (int i = 0; i < 2; ++i) scene.objects[i]->material = MATERIAL_MIRROR;
+    scene.camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    scene.light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    GridAccel grid;
+    grid.build(scene.objects);
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer buffer(width * height * 3);
+    bool enabled = photonMap.enabled;
+
+    std::vector<WorkerSlot> workers = planWorkers(renderSettings.placement, renderSettings.threads);
+    std::cout << "photon map benchmark, " << scene.name << ", " << width << "x" << height << "\n";
+    std::cout << std::left << std::setw(12) << "threads" << std::right << std::setw(12) << "emitted" << std::setw(12) << "stored"
+              << std::setw(12) << "trace ms" << std::setw(12) << "build ms" << "\n";
+    for (size_t threads : {size_t(1), workers.size()}) {
+        std::vector<WorkerSlot> used(workers.begin(), workers.begin() + threads);
+        photonMap.build(scene.objects, grid, scene.light, used);
+        const PhotonStats& stats = photonMap.stats();
+        std::cout << std::left << std::setw(12) << threads << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << stats.emitted << std::setw(12) << stats.stored
+                  << std::setw(12) << stats.traceMs << std::setw(12) << stats.buildMs << "\n";
+        if (workers.size() == 1) break;
+    }
+
+    std::cout << std::left << std::setw(12) << "caustics" << std::right << std::setw(12) << "frame ms"
+              << std::setw(12) << "gathers" << std::setw(12) << "gather ms" << std::setw(12) << "us/gather" << "\n";
+    for (bool caustics : {false, true}) {
+        photonMap.enabled = caustics;
+        photonMap.beginFrame();
+        auto beg = std::chrono::steady_clock::now();
+        renderScene(buffer, width, height, scene.camera, scene.light, grid, tiles);
+        double frameMs = elapsedMs(beg);
+        const PhotonStats& stats = photonMap.endFrame();
+        std::cout << std::left << std::setw(12) << (caustics ? "on" : "off") << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << frameMs << std::setw(12) << stats.gathers << std::setw(12) << stats.gatherMs
+                  << std::setw(12) << (stats.gathers ? stats.gatherMs * 1000.0 / stats.gathers : 0.0) << "\n";
+    }
+    photonMap.enabled = enabled;
+}
+
+// 主光线分块候选表：物体数从少到多的场景，分别用逐个遍历和网格，比较开启前后的帧时间，
+// 并检查两次渲染的图像逐字节相同
+inline void benchTileBins(const std::vector<Object*>& labObjects, int width, int height) {
+    std::vector<BenchScene> scenes;
+    scenes.emplace_back();
+    scenes.back().name = "lab";
+    scenes.back().objects = labObjects;
+    scenes.back().camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    scenes.back().light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    scenes.push_back(makeSphereField("uniform-16", 16, 0));
+    scenes.push_back(makeSphereField("uniform-64", 64, 0));
+    scenes.push_back(makeSphereField("uniform-256", 256, 0));
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer reference(width * height * 3), buffer(width * height * 3);
+    TileBins bins;
+
+    std::cout << "primary ray tile binning benchmark, " << width << "x" << height << ", " << tiles.size() << " tiles\n";
+    std::cout << std::left << std::setw(14) << "scene" << std::setw(10) << "backend"
+              << std::right << std::setw(12) << "bin ms" << std::setw(14) << "objs/tile" << std::setw(12) << "empty"
+              << std::setw(12) << "off ms" << std::setw(12) << "on ms" << std::setw(12) << "identical" << "\n";
+    for (auto& scene : scenes) {
+        LinearAccel linear;
+        GridAccel grid;
+        for (Accel* accel : std::vector<Accel*>{&linear, &grid}) {
+            accel->build(scene.objects);
+            auto beg = std::chrono::steady_clock::now();
+            renderScene(reference, width, height, scene.camera, scene.light, *accel, tiles);
+            double offMs = elapsedMs(beg);
+
+            beg = std::chrono::steady_clock::now();
+            bins.build(scene.objects, CameraFrame(scene.camera, width, height), TileGrid(width, height));
+            double binMs = elapsedMs(beg);
+            renderScene(buffer, width, height, scene.camera, scene.light, *accel, tiles, nullptr, nullptr, &bins);
+            double onMs = elapsedMs(beg);
+
+            std::cout << std::left << std::setw(14) << scene.name << std::setw(10) << accel->name()
+                      << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << binMs
+                      << std::setw(14) << double(bins.objects.size()) / tiles.size()
+                      << std::setw(12) << bins.emptyTiles()
+                      << std::setw(12) << offMs << std::setw(12) << onMs
+                      << std::setw(12) << (buffer == reference ? "yes" : "no") << "\n";
+        }
+    }
+}
+
+// 混合渲染：主光线的第一个交点由光栅化可见性阶段得到，与逐像素追踪主光线比较帧时间。
+// 两种方式的交点应当逐位相同，同时统计两幅图像中不同的像素数和最大差值作为检查
+inline void benchRaster(const std::vector<Object*>& labObjects, int width, int height) {
+    std::vector<BenchScene> scenes;
+    scenes.emplace_back();
+    scenes.back().name = "lab";
+    scenes.back().objects = labObjects;
+    scenes.back().camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    scenes.back().light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    scenes.push_back(makeSphereField("uniform-1k", 1000, 0));
+    scenes.push_back(makeSphereField("uniform-10k", 10000, 0));
+    scenes.push_back(makeSphereField("clustered-10k", 10000, 8));
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer reference(width * height * 3), buffer(width * height * 3);
+    TileBins bins;
+    bool saved = renderSettings.rasterPrimary;
+
+    std::cout << "hybrid rasterized primary visibility benchmark, " << width << "x" << height << "\n";
+    std::cout << std::left << std::setw(16) << "scene" << std::right << std::setw(14) << "traced ms"
+              << std::setw(12) << "bin ms" << std::setw(14) << "raster ms" << std::setw(10) << "speedup"
+              << std::setw(14) << "diff pixels" << std::setw(10) << "max diff" << "\n";
+    for (auto& scene : scenes) {
+        GridAccel grid;
+        grid.build(scene.objects);
+
+        renderSettings.rasterPrimary = false;
+        auto beg = std::chrono::steady_clock::now();
+        renderScene(reference, width, height, scene.camera, scene.light, grid, tiles);
+        double tracedMs = elapsedMs(beg);
+
+        renderSettings.rasterPrimary = true;
+        beg = std::chrono::steady_clock::now();
+        bins.build(scene.objects, CameraFrame(scene.camera, width, height), TileGrid(width, height));
+        double binMs = elapsedMs(beg);
+        renderScene(buffer, width, height, scene.camera, scene.light, grid, tiles, nullptr, nullptr, &bins);
+        double rasterMs = elapsedMs(beg);
+
+        int diffPixels = 0, maxDiff = 0;
+        for (size_t p = 0; p < buffer.size(); p += 3) {
+            int d = 0;
+            for (int c = 0; c < 3; ++c) d = std::max(d, std::abs(int(buffer[p + c]) - int(reference[p + c])));
+            diffPixels += d > 0;
+            maxDiff = std::max(maxDiff, d);
+        }
+        std::cout << std::left << std::setw(16) << scene.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(14) << tracedMs << std::setw(12) << binMs << std::setw(14) << rasterMs
+                  << std::setw(10) << tracedMs / rasterMs << std::setw(14) << diffPixels << std::setw(10) << maxDiff << "\n";
+    }
+    renderSettings.rasterPrimary = saved;
+}
+
+// 远程查看的回环测试：渲染机线程和查看端在同一进程中通过 127.0.0.1 的 TCP 连接通信。
+// 查看端依次移动球、平移相机、修改光源，每一步发送修改并等待画面，统计发送的 tile 数、
+// 编码后的字节数占原始像素的比例、编码耗时和往返时间，并检查查看端的画面与渲染机逐字节相同
+inline void benchStream(int width, int height) {
+    BenchScene scene;
+    scene.name = "lab";
+    scene.add<Sphere>(glm::vec3(-1.0f, -1.0f, -4.0f), 1.0f, glm::vec3(1.0f, 0.0f, 0.0f), 0.2f);
+    scene.add<Sphere>(glm::vec3(1.0f, -1.0f, -4.0f), 1.0f, glm::vec3(0.0f, 0.0f, 1.0f), 0.2f);
+    scene.add<Wall>(glm::vec3(0.0f, -2.0f, -3.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 20.0f, 20.0f, glm::vec3(0.5f, 0.3f, 0.1f), 0.1f);
+    scene.add<Wall>(glm::vec3(-2.0f, 0.0f, -3.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 20.0f, 20.0f, glm::vec3(1.0f), 0.01f);
+    scene.add<Wall>(glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), 20.0f, 20.0f, glm::vec3(1.0f), 0.01f);
+    Sphere* moving = static_cast<Sphere*>(scene.objects[0]);
+
+    int port = 0;
+    SocketHandle listener = netInit() ? listenOn(port) : INVALID_SOCKET_HANDLE;
+    if (listener == INVALID_SOCKET_HANDLE) {
+        std::cout << "stream benchmark: cannot listen on a loopback port\n";
+        return;
+    }
+
+    // 渲染机：每收到一条 MESSAGE_VIEW 渲染一帧并回送有变化的 tile
+    PixelBuffer served(width * height * 3);
+    double encodeMs = 0.0;
+    std::thread server([&]() {
+        StreamConnection connection(acceptClient(listener));
+        GridAccel grid;
+        DirtyTracker tracker;
+        TileDeltaEncoder encoder;
+        std::vector<unsigned char> payload, frame;
+        uint32_t type, frameId = 0;
+        while (connection.receive(type, payload)) {
+            if (type == MESSAGE_SPHERE) {
+                SphereEdit edit;
+                std::memcpy(&edit, payload.data(), sizeof(edit));
+                moving->center = toAligned(edit.center);
+                tracker.touch(moving);
+                continue;
+            }
+            ViewState view;
+            std::memcpy(&view, payload.data(), sizeof(view));
+            std::vector<int> tiles = tracker.collect(scene.objects, view.camera, view.light, view.width, view.height);
+            grid.build(scene.objects);
+            renderScene(served, view.width, view.height, view.camera, view.light, grid, tiles);
+            auto beg = std::chrono::steady_clock::now();
+            encoder.encode(served, view.width, view.height, frameId++, frame);
+            encodeMs = elapsedMs(beg);
+            if (!connection.send(MESSAGE_FRAME, frame.data(), frame.size())) break;
+        }
+    });
+
+    StreamConnection client(connectTo("127.0.0.1", port));
+    PixelBuffer viewed(width * height * 3, 0);
+    ViewState view = {scene.camera, {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)}, width, height};
+    view.camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+
+    std::cout << "remote streaming benchmark (loopback), " << width << "x" << height << ", "
+              << TileGrid(width, height).count() << " tiles, raw frame " << width * height * 3 / 1024 << " KB\n";
+    std::cout << std::left << std::setw(14) << "step" << std::right << std::setw(8) << "frames" << std::setw(10) << "tiles"
+              << std::setw(12) << "KB/frame" << std::setw(10) << "% raw" << std::setw(12) << "encode ms"
+              << std::setw(14) << "round trip ms" << std::setw(10) << "match" << "\n";
+    const char* steps[] = {"first frame", "move sphere", "pan camera", "change light", "no change"};
+    const int frames[] = {1, 8, 8, 1, 1};
+    std::vector<unsigned char> payload;
+    for (int step = 0; step < 5; ++step) {
+        size_t bytes = 0;
+        int tiles = 0;
+        double encodeTotal = 0.0, roundTrip = 0.0;
+        bool match = true;
+        for (int f = 0; f < frames[step]; ++f) {
+            auto beg = std::chrono::steady_clock::now();
+            if (step == 1) {
+                SphereEdit edit = {0, toVec3(moving->center) + glm::vec3(0.05f, 0.0f, 0.0f), moving->radius, moving->color, moving->reflectivity, int32_t(moving->material)};
+                client.send(MESSAGE_SPHERE, &edit, sizeof(edit));
+            }
+            if (step == 2) view.camera.position.x += 0.02f;
+            if (step == 3) view.light.position.y += 1.0f;
+            client.send(MESSAGE_VIEW, &view, sizeof(view));
+            uint32_t type;
+            if (!client.receive(type, payload) || type != MESSAGE_FRAME || !applyFrame(payload, viewed, width, height)) {
+                match = false;
+                break;
+            }
+            roundTrip += elapsedMs(beg);
+            encodeTotal += encodeMs;
+            bytes += payload.size() + sizeof(MessageHeader);
+            FrameHeader header;
+            std::memcpy(&header, payload.data(), sizeof(header));
+            tiles += header.tileCount;
+            match &= viewed == served;
+        }
+        double n = frames[step];
+        std::cout << std::left << std::setw(14) << steps[step] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << frames[step] << std::setw(10) << tiles / n
+                  << std::setw(12) << bytes / n / 1024.0 << std::setw(10) << 100.0 * bytes / n / (width * height * 3)
+                  << std::setw(12) << encodeTotal / n << std::setw(14) << roundTrip / n
+                  << std::setw(10) << (match ? "yes" : "no") << "\n";
+    }
+    client.close();
+    server.join();
+    closeSocket(listener);
+}
+
+// 时间预算下的 tile 优先级：以光源移动前的完整画面为起点，预算为整帧渲染时间的 1/4，
+// 每种排序方式逐帧渲染直到没有遗留的 tile。统计第一帧内已经更新的像素在光标周围、画面中心、
+// 亮度方差最大的 1/4 个 tile 以及整幅画面中的比例，并检查最终画面与一次渲染完整帧的结果相同
+inline void benchSchedule(int width, int height) {
+    BenchScene scene = makeSphereField("uniform-1k", 1000, 0);
+    GridAccel grid;
+    grid.build(scene.objects);
+    TileGrid tileGrid(width, height);
+    std::vector<int> all;
+    for (int i = 0; i < tileGrid.count(); ++i) all.push_back(i);
+
+    PixelBuffer before(width * height * 3), reference(width * height * 3), buffer;
+    Light moved = scene.light;
+    moved.position.x -= 4.0f;
+    renderScene(before, width, height, scene.camera, scene.light, grid, all);
+    auto beg = std::chrono::steady_clock::now();
+    renderScene(reference, width, height, scene.camera, moved, grid, all);
+    double fullMs = elapsedMs(beg);
+
+    // 关注区域：光标周围、画面中心附近各一个半径为高度 1/5 的圆，以及方差最大的 1/4 个 tile
+    glm::vec2 cursor(0.3f * width, 0.6f * height), center(0.5f * width, 0.5f * height);
+    float radius = 0.2f * height;
+    std::vector<int> byVariance = all;
+    std::vector<float> variance(all.size());
+    for (int t : all) variance[t] = tileVariance(before, tileGrid, t);
+    std::sort(byVariance.begin(), byVariance.end(), [&](int a, int b) { return variance[a] > variance[b]; });
+    std::vector<char> highVariance(all.size(), 0);
+    for (size_t i = 0; i < byVariance.size() / 4; ++i) highVariance[byVariance[i]] = 1;
+
+    float savedBudget = renderSettings.frameBudgetMs;
+    renderSettings.frameBudgetMs = float(fullMs / 4);
+    std::cout << "tile priority under a frame budget, " << width << "x" << height << ", " << scene.name
+              << ", full frame " << std::fixed << std::setprecision(1) << fullMs << " ms, budget " << renderSettings.frameBudgetMs << " ms\n";
+    std::cout << std::left << std::setw(12) << "priority" << std::right << std::setw(10) << "cursor %" << std::setw(10) << "center %"
+              << std::setw(12) << "variance %" << std::setw(11) << "overall %" << std::setw(8) << "frames" << std::setw(8) << "match" << "\n";
+    for (int p = 0; p < PRIORITY_COUNT; ++p) {
+        TileScheduler scheduler;
+        scheduler.priority = TilePriority(p);
+        scheduler.focus = cursor;
+        scheduler.finish(all, std::vector<int>(), before, tileGrid);
+        buffer = before;
+
+        std::vector<int> tiles = all, unfinished;
+        double inCursor = 0, cursorTotal = 0, inCenter = 0, centerTotal = 0, inVariance = 0, inAll = 0;
+        int frames = 0;
+        do {
+            std::vector<int> order = scheduler.order(tiles, tileGrid);
+            renderScene(buffer, width, height, scene.camera, moved, grid, order, nullptr, nullptr, nullptr, &unfinished);
+            scheduler.finish(order, unfinished, buffer, tileGrid);
+            tiles.clear();
+            if (frames++ > 0) continue;
+
+            std::vector<char> rendered(all.size(), 1);
+            for (int t : unfinished) rendered[t] = 0;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    int t = (y / TILE_SIZE) * tileGrid.tilesX + x / TILE_SIZE;
+                    glm::vec2 q(x + 0.5f, y + 0.5f);
+                    bool nearCursor = glm::length(q - cursor) < radius, nearCenter = glm::length(q - center) < radius;
+                    cursorTotal += nearCursor;
+                    centerTotal += nearCenter;
+                    inCursor += nearCursor && rendered[t];
+                    inCenter += nearCenter && rendered[t];
+                    inAll += rendered[t];
+                }
+            }
+            for (size_t t = 0; t < all.size(); ++t) inVariance += highVariance[t] && rendered[t];
+        } while (!scheduler.pending().empty());
+
+        std::cout << std::left << std::setw(12) << priorityNames[p] << std::right << std::setprecision(1)
+                  << std::setw(10) << 100.0 * inCursor / cursorTotal << std::setw(10) << 100.0 * inCenter / centerTotal
+                  << std::setw(12) << 100.0 * inVariance / (byVariance.size() / 4) << std::setw(11) << 100.0 * inAll / (double(width) * height)
+                  << std::setw(8) << frames << std::setw(8) << (buffer == reference ? "yes" : "no") << "\n";
+    }
+    std::cout << std::defaultfloat;
+    renderSettings.frameBudgetMs = savedBudget;
+}
+
+// 帧时限驱动的采样密度：先渲染一帧全分辨率得到每像素耗时，再模拟连续拖动相机的若干帧，
+// 每帧由 ResolutionScaler 选择级别、稀疏追踪后上采样，统计交互帧的平均耗时、选出的级别和与全分辨率结果的 PSNR；
+// 最后一帧停止交互，全分辨率重绘降低过密度的 tile，检查结果与直接渲染完全相同
+inline void benchDeadline(const std::vector<Object*>& labObjects, int width, int height) {
+    std::vector<BenchScene> scenes;
+    scenes.emplace_back();
+    scenes.back().name = "lab";
+    scenes.back().objects = labObjects;
+    scenes.back().camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    scenes.back().light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    scenes.push_back(makeSphereField("uniform-1k", 1000, 0));
+    scenes.push_back(makeSphereField("uniform-10k", 10000, 0));
+
+    TileGrid grid(width, height);
+    std::vector<int> all;
+    for (int i = 0; i < grid.count(); ++i) all.push_back(i);
+    const float DEADLINE = 33.0f;
+    const int INTERACTIVE_FRAMES = 8;
+
+    std::cout << "frame deadline resolution scaling, " << width << "x" << height << ", deadline " << DEADLINE << " ms\n";
+    std::cout << std::left << std::setw(16) << "scene" << std::right << std::setw(10) << "full ms" << std::setw(16) << "interactive ms"
+              << std::setw(14) << "sampling" << std::setw(10) << "PSNR dB" << std::setw(12) << "refine ms" << std::setw(8) << "match" << "\n";
+    for (auto& scene : scenes) {
+        GridAccel accel;
+        accel.build(scene.objects);
+        ResolutionScaler scaler;
+        scaler.deadlineMs = DEADLINE;
+        PixelBuffer pixels(width * height * 3), reference(width * height * 3);
+        std::vector<char> mask;
+
+        auto beg = std::chrono::steady_clock::now();
+        renderScene(pixels, width, height, scene.camera, scene.light, accel, all);
+        double fullMs = elapsedMs(beg);
+        scaler.record(fullMs, tilePixels(grid, all));
+
+        Camera camera = scene.camera;
+        double interactiveMs = 0.0;
+        int level = 0;
+        for (int f = 0; f < INTERACTIVE_FRAMES; ++f) {
+            camera.position.x += 0.05f;
+            level = scaler.choose(tilePixels(grid, all));
+            beg = std::chrono::steady_clock::now();
+            if (level > 0) scaler.buildMask(mask, grid, all, level);
+            auto traceBeg = std::chrono::steady_clock::now();
+            renderScene(pixels, width, height, camera, scene.light, accel, all, nullptr, level > 0 ? &mask : nullptr);
+            scaler.record(elapsedMs(traceBeg), tracedPixels(grid, all, std::vector<int>(), level > 0 ? &mask : nullptr));
+            if (level > 0) scaler.upsample(pixels, grid, all, level);
+            scaler.rendered(grid, all, std::vector<int>(), level);
+            interactiveMs += elapsedMs(beg);
+        }
+        interactiveMs /= INTERACTIVE_FRAMES;
+
+        renderScene(reference, width, height, camera, scene.light, accel, all);
+        double squared = 0.0;
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            double d = double(pixels[i]) - reference[i];
+            squared += d * d;
+        }
+        double mse = squared / pixels.size();
+        double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+
+        // 停止交互：全分辨率重绘降低过密度的 tile
+        std::vector<int> refine;
+        scaler.appendCoarse(refine, grid);
+        beg = std::chrono::steady_clock::now();
+        renderScene(pixels, width, height, camera, scene.light, accel, refine);
+        double refineMs = elapsedMs(beg);
+        scaler.rendered(grid, refine, std::vector<int>(), 0);
+
+        std::cout << std::left << std::setw(16) << scene.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << fullMs << std::setw(16) << interactiveMs << std::setw(14) << ResolutionScaler::levelName(level)
+                  << std::setw(10) << psnr << std::setw(12) << refineMs << std::setw(8) << (pixels == reference ? "yes" : "no") << "\n";
+    }
+    std::cout << std::defaultfloat;
+}
+
+// 比较 CPU 路径和计算着色器后端：同一帧分别在 CPU 上追踪到像素缓冲、在 GPU 上追踪到 RGBA8 纹理，
+// 读回纹理后统计不同的像素数和最大差值（浮点运算顺序不同，个别像素可能相差 1）。
+// 调用前需要有支持 OpenGL 4.3 的当前上下文
+inline void compareGpuBackend(const std::vector<Object*>& labObjects, int width, int height) {
+    GpuTracer tracer;
+    if (!tracer.init()) {
+        std::cout << "gpu benchmark: compute shaders are not available\n";
+        return;
+    }
+    std::cout << "compute shader backend benchmark, " << width << "x" << height << ", " << glGetString(GL_RENDERER) << "\n";
+
+    std::vector<BenchScene> scenes;
+    scenes.emplace_back();
+    scenes.back().name = "lab";
+    scenes.back().objects = labObjects;
+    scenes.back().camera = {glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.0f, 90.0f};
+    scenes.back().light = {glm::vec3(5.0f, 1.0f, 0.0f), glm::vec3(1.0f)};
+    scenes.push_back(makeSphereField("uniform-64", 64, 0));
+    scenes.push_back(makeSphereField("uniform-256", 256, 0));
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    std::vector<int> tiles;
+    for (int i = 0; i < TileGrid(width, height).count(); ++i) tiles.push_back(i);
+    PixelBuffer reference(width * height * 3), buffer(width * height * 3);
+    const int REPEAT = 5;
+
+    std::cout << std::left << std::setw(16) << "scene" << std::right << std::setw(12) << "cpu ms" << std::setw(12) << "upload ms"
+              << std::setw(12) << "gpu ms" << std::setw(10) << "speedup" << std::setw(14) << "diff pixels" << std::setw(10) << "max diff" << "\n";
+    for (auto& scene : scenes) {
+        if (!GpuTracer::supports(scene.objects)) {
+            std::cout << std::left << std::setw(16) << scene.name << "unsupported objects\n";
+            continue;
+        }
+        GridAccel grid;
+        grid.build(scene.objects);
+        auto beg = std::chrono::steady_clock::now();
+        renderScene(reference, width, height, scene.camera, scene.light, grid, tiles);
+        double cpuMs = elapsedMs(beg);
+
+        beg = std::chrono::steady_clock::now();
+        tracer.upload(scene.objects);
+        glFinish();
+        double uploadMs = elapsedMs(beg);
+        // 第一次调度包含着色器的延迟编译，不计时
+        tracer.render(texture, width, height, scene.camera, scene.light);
+        glFinish();
+        beg = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPEAT; ++r) tracer.render(texture, width, height, scene.camera, scene.light);
+        glFinish();
+        double gpuMs = elapsedMs(beg) / REPEAT;
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer.data());
+        int diffPixels = 0, maxDiff = 0;
+        for (size_t p = 0; p < buffer.size(); p += 3) {
+            int d = 0;
+            for (int c = 0; c < 3; ++c) d = std::max(d, std::abs(int(buffer[p + c]) - int(reference[p + c])));
+            diffPixels += d > 0;
+            maxDiff = std::max(maxDiff, d);
+        }
+        std::cout << std::left << std::setw(16) << scene.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << cpuMs << std::setw(12) << uploadMs << std::setw(12) << gpuMs
+                  << std::setw(10) << cpuMs / gpuMs << std::setw(14) << diffPixels << std::setw(10) << maxDiff << "\n";
+    }
+    glDeleteTextures(1, &texture);
+}
+
+// 用隐藏的 GLFW 窗口创建 OpenGL 4.3 上下文后运行 compareGpuBackend
+inline void benchGpu(const std::vector<Object*>& labObjects, int width, int height) {
+    if (!glfwInit()) {
+        std::cout << "gpu benchmark: failed to initialize GLFW\n";
+        return;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "gpu benchmark", nullptr, nullptr);
+    if (!window) {
+        std::cout << "gpu benchmark: no OpenGL 4.3 context\n";
+        glfwTerminate();
+        return;
+    }
+    glfwMakeContextCurrent(window);
+    if (gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        compareGpuBackend(labObjects, width, height);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
+
+// --bench 可选的基准：分派、all 的运行顺序和命令行的用法说明都取自这张表
+struct BenchEntry {
+    const char* name;
+    void (*run)(const std::vector<Object*>& labObjects, int width, int height);
+};
+
+const BenchEntry benchEntries[] = {
+    {"accel", [](const std::vector<Object*>& labObjects, int width, int height) { benchAccel(labObjects, width, height); }},
+    {"binning", [](const std::vector<Object*>&, int width, int height) { benchBinning(width, height); }},
+    {"placement", [](const std::vector<Object*>&, int width, int height) { benchPlacement(width, height); }},
+    {"outofcore", [](const std::vector<Object*>&, int width, int height) { benchOutOfCore(width, height); }},
+    {"bvh", [](const std::vector<Object*>&, int width, int height) { benchBVH(width, height); }},
+    {"animation", [](const std::vector<Object*>& labObjects, int, int) { benchAnimation(labObjects); }},
+    {"simd", [](const std::vector<Object*>& labObjects, int width, int height) { benchSimd(labObjects, width, height); }},
+    {"irradiance", [](const std::vector<Object*>& labObjects, int width, int height) { benchIrradiance(labObjects, width, height); }},
+    {"photon", [](const std::vector<Object*>&, int width, int height) { benchPhoton(width, height); }},
+    {"tilebins", [](const std::vector<Object*>& labObjects, int width, int height) { benchTileBins(labObjects, width, height); }},
+    {"raster", [](const std::vector<Object*>& labObjects, int width, int height) { benchRaster(labObjects, width, height); }},
+    {"stream", [](const std::vector<Object*>&, int width, int height) { benchStream(width, height); }},
+    {"gpu", [](const std::vector<Object*>& labObjects, int width, int height) { benchGpu(labObjects, width, height); }},
+    {"schedule", [](const std::vector<Object*>&, int width, int height) { benchSchedule(width, height); }},
+    {"deadline", [](const std::vector<Object*>& labObjects, int width, int height) { benchDeadline(labObjects, width, height); }},
+    {"bvhbuild", [](const std::vector<Object*>&, int width, int height) { benchBVHBuild(width, height); }},
+    {"bvhcache", [](const std::vector<Object*>&, int width, int height) { benchBVHCache(width, height); }},
+    {"envmap", [](const std::vector<Object*>&, int width, int height) { benchEnvironment(width, height); }},
+    {"arealight", [](const std::vector<Object*>&, int width, int height) { benchAreaLight(width, height); }},
+};
+
+// 用法说明中的基准名："accel|binning|...|all"
+inline std::string benchNames() {
+    std::string names;
+    for (const BenchEntry& entry : benchEntries) names += std::string(entry.name) + "|";
+    return names + "all";
+}
+
+// 命令行 --bench <name> 的入口，在创建窗口之前运行
+inline int runBenchmark(const std::string& name, const std::vector<Object*>& labObjects, int width, int height) {
+    bool found = false;
+    for (const BenchEntry& entry : benchEntries) {
+        if (name != entry.name && name != "all") continue;
+        entry.run(labObjects, width, height);
+        found = true;
+    }
+    if (!found) {
+        std::cerr << "unknown benchmark: " << name << " (expected " << benchNames() << ")\n";
+        return -1;
+    }
+    return 0;
+}
+#endif
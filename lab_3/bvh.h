@@ -0,0 +1,697 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+#include "accel.h"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <chrono>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BVH_HAS_AVX2_PATH 1
+#endif
+
+// 三角形
+struct Triangle {
+    glm::vec3 v0, v1, v2;
+};
+
+// 求交用的三角形，预先存好两条边，求交时不再做减法
+struct PackedTriangle {
+    glm::vec3 v0, e1, e2;
+};
+
+inline PackedTriangle packTriangle(const Triangle& tri) {
+    return {tri.v0, tri.v1 - tri.v0, tri.v2 - tri.v0};
+}
+
+// Möller–Trumbore 求交，交点在 (0.001, closest) 内时更新 closest 和朝向光线来向的法线
+inline bool intersectTriangle(const PackedTriangle& tri, const Ray& ray, float& closest, glm::vec3& normal) {
+    glm::vec3 origin = toVec3(ray.origin), direction = toVec3(ray.direction);
+    glm::vec3 p = glm::cross(direction, tri.e2);
+    float det = glm::dot(tri.e1, p);
+    if (std::fabs(det) < 1e-12f) return false;
+    float invDet = 1.0f / det;
+    glm::vec3 s = origin - tri.v0;
+    float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+    glm::vec3 q = glm::cross(s, tri.e1);
+    float v = glm::dot(direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    float t = glm::dot(tri.e2, q) * invDet;
+    // 与 Accel 的约定一致，忽略过近的交点（阴影和反射光线的自交）
+    if (t <= 0.001f || t >= closest) return false;
+    closest = t;
+    normal = glm::normalize(glm::cross(tri.e1, tri.e2));
+    if (glm::dot(normal, direction) > 0.0f) normal = -normal;
+    return true;
+}
+
+// 二叉 BVH 节点（32 字节）：count > 0 为叶子，包含图元 order[first, first + count)；
+// 否则两个子节点为 first 和 first + 1
+struct BVHNode {
+    glm::vec3 min;
+    uint32_t first;
+    glm::vec3 max;
+    uint32_t count;
+};
+
+// 二叉 BVH 的构建方式
+enum BVHBuilder {
+    BVH_BUILD_MEDIAN,   // 质心包围盒最长轴的中位数二分
+    BVH_BUILD_SAH,      // 分桶 SAH，上层的子树并行构建；构建较慢，追踪最快
+    BVH_BUILD_LBVH,     // 按质心的 Morton 码排序后按最高不同位二分；构建最快，适合每帧重建的动态几何
+    BVH_BUILD_COUNT
+};
+const char* const bvhBuilderNames[BVH_BUILD_COUNT] = {"median", "sah", "lbvh"};
+
+// SAH 代价模型中遍历一个内部节点与测试一个图元的相对代价
+const float SAH_TRAVERSAL_COST = 1.0f;
+const float SAH_INTERSECTION_COST = 1.0f;
+
+// 一次构建的耗时和 SAH 代价估计，调用方据此在构建时间和追踪速度之间取舍
+struct BVHBuildStats {
+    double ms = 0.0;
+    float sahCost = 0.0f;   // 每条穿过根节点包围盒的光线期望的遍历与求交代价
+};
+
+// 二叉 BVH：按 BVHBuilder 递归二分，直到图元数不超过 maxLeafSize。
+// 两个子节点相邻，且下标大于父节点；叶子按深度优先、从左到右的顺序占据 order 中连续的区间
+struct BinaryBVH {
+    std::vector<BVHNode> nodes;
+    std::vector<uint32_t> order;    // 叶子区间引用的图元下标
+    BVHBuildStats stats;            // 最近一次构建的统计
+
+    void build(const std::vector<AABB>& boxes, int maxLeafSize, BVHBuilder builder = BVH_BUILD_MEDIAN) {
+        auto beg = std::chrono::steady_clock::now();
+        nodes.clear();
+        order.resize(boxes.size());
+        std::iota(order.begin(), order.end(), 0u);
+        if (!boxes.empty()) {
+            maxLeafSize = std::max(maxLeafSize, 1);
+            if (builder == BVH_BUILD_SAH) buildSAH(boxes, maxLeafSize);
+            else if (builder == BVH_BUILD_LBVH) buildLBVH(boxes, maxLeafSize);
+            else buildMedian(boxes, maxLeafSize);
+        }
+        stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+        stats.sahCost = sahCost();
+    }
+
+    // SAH 代价：各节点的表面积与根节点之比，乘以遍历（内部节点）或求交（叶子中的图元）的代价后求和
+    float sahCost() const {
+        if (nodes.empty()) return 0.0f;
+        double rootArea = std::max(box(0).halfArea(), 1e-30f);
+        double cost = 0.0;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            double area = box(i).halfArea() / rootArea;
+            cost += nodes[i].count > 0 ? area * nodes[i].count * SAH_INTERSECTION_COST : area * SAH_TRAVERSAL_COST;
+        }
+        return float(cost);
+    }
+
+    size_t memoryBytes() const {
+        return nodes.size() * sizeof(BVHNode);
+    }
+
+    // leaf(first, count) 测试叶子中的图元并返回新的最近距离
+    template <typename Leaf>
+    void traverse(const Ray& ray, float closest, Leaf leaf) const {
+        traverse(nodes.data(), nodes.size(), ray, closest, leaf);
+    }
+
+    // 同上，节点数组不必属于 BinaryBVH（例如直接映射的缓存文件）
+    template <typename Leaf>
+    static void traverse(const BVHNode* nodes, size_t nodeCount, const Ray& ray, float closest, Leaf leaf) {
+        if (nodeCount == 0) return;
+        glm::vec3 origin = toVec3(ray.origin);
+        glm::vec3 invDir = 1.0f / toVec3(ray.direction);
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const BVHNode& node = nodes[stack[--top]];
+            float tEnter;
+            if (!slab(node, origin, invDir, closest, tEnter)) continue;
+            if (node.count > 0) {
+                closest = leaf(node.first, node.count);
+                continue;
+            }
+            // 近的子节点后入栈，先被访问
+            float tLeft, tRight;
+            bool hitLeft = slab(nodes[node.first], origin, invDir, closest, tLeft);
+            bool hitRight = slab(nodes[node.first + 1], origin, invDir, closest, tRight);
+            if (hitLeft && hitRight) {
+                bool leftFirst = tLeft < tRight;
+                stack[top++] = leftFirst ? node.first + 1 : node.first;
+                stack[top++] = leftFirst ? node.first : node.first + 1;
+            } else if (hitLeft) {
+                stack[top++] = node.first;
+            } else if (hitRight) {
+                stack[top++] = node.first + 1;
+            }
+        }
+    }
+
+    static bool slab(const BVHNode& node, const glm::vec3& origin, const glm::vec3& invDir, float maxT, float& tEnter) {
+        glm::vec3 t0 = (node.min - origin) * invDir;
+        glm::vec3 t1 = (node.max - origin) * invDir;
+        glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+        tEnter = std::max({tNear.x, tNear.y, tNear.z, 0.0f});
+        float tExit = std::min({tFar.x, tFar.y, tFar.z, maxT});
+        return tEnter <= tExit;
+    }
+
+private:
+    AABB box(size_t i) const {
+        AABB b;
+        b.min = nodes[i].min;
+        b.max = nodes[i].max;
+        return b;
+    }
+
+    static std::vector<glm::vec3> centroidsOf(const std::vector<AABB>& boxes) {
+        std::vector<glm::vec3> centroids(boxes.size());
+        for (size_t i = 0; i < boxes.size(); ++i) centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+        return centroids;
+    }
+
+    void buildMedian(const std::vector<AABB>& boxes, int maxLeafSize) {
+        std::vector<glm::vec3> centroids = centroidsOf(boxes);
+        struct Task { uint32_t node, begin, end; };
+        nodes.resize(1);
+        std::vector<Task> stack = {{0, 0, (uint32_t)boxes.size()}};
+        while (!stack.empty()) {
+            Task task = stack.back();
+            stack.pop_back();
+            AABB box, centroidBox;
+            for (uint32_t i = task.begin; i < task.end; ++i) {
+                box.expand(boxes[order[i]]);
+                centroidBox.expand(centroids[order[i]]);
+            }
+            nodes[task.node].min = box.min;
+            nodes[task.node].max = box.max;
+            if (task.end - task.begin <= (uint32_t)maxLeafSize) {
+                nodes[task.node].first = task.begin;
+                nodes[task.node].count = task.end - task.begin;
+                continue;
+            }
+            uint32_t mid = medianSplit(order, centroids, centroidBox, task.begin, task.end);
+
+            uint32_t child = (uint32_t)nodes.size();
+            nodes[task.node].first = child;
+            nodes[task.node].count = 0;
+            nodes.resize(nodes.size() + 2);
+            // 先压右子树，保证叶子按深度优先的顺序出栈
+            stack.push_back({child + 1, mid, task.end});
+            stack.push_back({child, task.begin, mid});
+        }
+    }
+
+    // 按质心包围盒最长轴的中位数划分 order[begin, end)，返回划分位置
+    static uint32_t medianSplit(std::vector<uint32_t>& order, const std::vector<glm::vec3>& centroids, const AABB& centroidBox,
+                                uint32_t begin, uint32_t end) {
+        glm::vec3 extent = centroidBox.max - centroidBox.min;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        uint32_t mid = (begin + end) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        return mid;
+    }
+
+    // 分桶 SAH 的构建状态。order 的不同区间互不重叠，多个线程可以同时划分各自的区间
+    struct SAHBuilder {
+        static const int BINS = 32;
+        static const int MAX_DEPTH = 36;    // 超过这一深度改用中位数二分，保证遍历栈（64 项）不会溢出
+        static const uint32_t MIN_TASK = 8192; // 图元数少于此值的子树不再分给新线程
+
+        const std::vector<AABB>& boxes;
+        const std::vector<glm::vec3>& centroids;
+        std::vector<uint32_t>& order;
+        int maxLeafSize;
+        int parallelDepth;
+
+        // 计算 order[begin, end) 的包围盒；需要划分时返回划分位置，否则返回 end（叶子）
+        uint32_t split(uint32_t begin, uint32_t end, int depth, AABB& box) {
+            AABB centroidBox;
+            for (uint32_t i = begin; i < end; ++i) {
+                box.expand(boxes[order[i]]);
+                centroidBox.expand(centroids[order[i]]);
+            }
+            if (end - begin <= (uint32_t)maxLeafSize) return end;
+            if (depth >= MAX_DEPTH) return medianSplit(order, centroids, centroidBox, begin, end);
+
+            // 每个轴上把质心分到 BINS 个等宽的桶中，扫描桶的边界取代价最小的划分
+            glm::vec3 extent = centroidBox.max - centroidBox.min;
+            float bestCost = std::numeric_limits<float>::max();
+            int bestAxis = -1, bestBin = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                if (extent[axis] <= 0.0f) continue;
+                AABB binBoxes[BINS];
+                uint32_t binCounts[BINS] = {0};
+                float scale = BINS / extent[axis];
+                for (uint32_t i = begin; i < end; ++i) {
+                    int b = binOf(centroids[order[i]][axis], centroidBox.min[axis], scale);
+                    binCounts[b]++;
+                    binBoxes[b].expand(boxes[order[i]]);
+                }
+                // 从右向左累计，rightCost[b] 为桶 [b, BINS) 的面积乘图元数
+                float rightCost[BINS];
+                AABB right;
+                uint32_t rightCount = 0;
+                for (int b = BINS - 1; b > 0; --b) {
+                    right.expand(binBoxes[b]);
+                    rightCount += binCounts[b];
+                    rightCost[b] = right.halfArea() * rightCount;
+                }
+                AABB left;
+                uint32_t leftCount = 0;
+                for (int b = 1; b < BINS; ++b) {
+                    left.expand(binBoxes[b - 1]);
+                    leftCount += binCounts[b - 1];
+                    if (leftCount == 0 || leftCount == end - begin) continue;
+                    float cost = left.halfArea() * leftCount + rightCost[b];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = b;
+                    }
+                }
+            }
+            // 所有质心重合时没有可用的桶边界
+            if (bestAxis < 0) return (begin + end) / 2;
+
+            float scale = BINS / extent[bestAxis];
+            float origin = centroidBox.min[bestAxis];
+            auto middle = std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t i) {
+                return binOf(centroids[i][bestAxis], origin, scale) < bestBin;
+            });
+            return uint32_t(middle - order.begin());
+        }
+
+        static int binOf(float c, float origin, float scale) {
+            return std::min(int((c - origin) * scale), BINS - 1);
+        }
+
+        // 串行构建 order[begin, end) 的子树，节点追加到 out，out[root] 为已分配的子树根
+        void buildSerial(std::vector<BVHNode>& out, uint32_t root, uint32_t begin, uint32_t end, int depth) {
+            struct Task { uint32_t node, begin, end; int depth; };
+            std::vector<Task> stack = {{root, begin, end, depth}};
+            while (!stack.empty()) {
+                Task task = stack.back();
+                stack.pop_back();
+                AABB box;
+                uint32_t mid = split(task.begin, task.end, task.depth, box);
+                out[task.node].min = box.min;
+                out[task.node].max = box.max;
+                if (mid == task.end) {
+                    out[task.node].first = task.begin;
+                    out[task.node].count = task.end - task.begin;
+                    continue;
+                }
+                uint32_t child = (uint32_t)out.size();
+                out[task.node].first = child;
+                out[task.node].count = 0;
+                out.resize(out.size() + 2);
+                stack.push_back({child + 1, mid, task.end, task.depth + 1});
+                stack.push_back({child, task.begin, mid, task.depth + 1});
+            }
+        }
+
+        // 构建 order[begin, end) 的子树并返回其节点（根为 0）。上层节点把左子树交给新线程、自己构建右子树，
+        // 两棵子树各自建好后按 [根, 左根, 右根, 左子树其余, 右子树其余] 拼接，保持兄弟相邻、子节点下标大于父节点
+        std::vector<BVHNode> buildTask(uint32_t begin, uint32_t end, int depth) {
+            std::vector<BVHNode> out(1);
+            if (depth >= parallelDepth || end - begin < MIN_TASK) {
+                buildSerial(out, 0, begin, end, depth);
+                return out;
+            }
+            AABB box;
+            uint32_t mid = split(begin, end, depth, box);
+            out[0].min = box.min;
+            out[0].max = box.max;
+            if (mid == end) {
+                out[0].first = begin;
+                out[0].count = end - begin;
+                return out;
+            }
+
+            std::vector<BVHNode> left;
+            std::thread worker([&]() { left = buildTask(begin, mid, depth + 1); });
+            std::vector<BVHNode> right = buildTask(mid, end, depth + 1);
+            worker.join();
+
+            uint32_t leftSize = (uint32_t)left.size();
+            auto mapLeft = [&](uint32_t i) { return i == 0 ? 1u : i + 2; };
+            auto mapRight = [&](uint32_t i) { return i == 0 ? 2u : leftSize + 1 + i; };
+            out.resize(1 + left.size() + right.size());
+            out[0].first = 1;
+            out[0].count = 0;
+            for (uint32_t i = 0; i < left.size(); ++i) {
+                BVHNode node = left[i];
+                if (node.count == 0) node.first = mapLeft(node.first);
+                out[mapLeft(i)] = node;
+            }
+            for (uint32_t i = 0; i < right.size(); ++i) {
+                BVHNode node = right[i];
+                if (node.count == 0) node.first = mapRight(node.first);
+                out[mapRight(i)] = node;
+            }
+            return out;
+        }
+    };
+
+    void buildSAH(const std::vector<AABB>& boxes, int maxLeafSize) {
+        std::vector<glm::vec3> centroids = centroidsOf(boxes);
+        // 上面 log2(线程数) + 1 层并行，子树数约为线程数的两倍，便于负载均衡
+        int threads = std::max(1u, std::thread::hardware_concurrency());
+        int parallelDepth = 1;
+        while ((1 << parallelDepth) < 2 * threads) ++parallelDepth;
+        SAHBuilder builder = {boxes, centroids, order, maxLeafSize, threads > 1 ? parallelDepth : 0};
+        nodes = builder.buildTask(0, (uint32_t)boxes.size(), 0);
+    }
+
+    // 把 [0, 1] 内的坐标量化为 10 位，三个轴的位交错成 30 位 Morton 码
+    static uint32_t expandBits(uint32_t v) {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    static uint32_t morton(const glm::vec3& p) {
+        glm::vec3 q = glm::clamp(p * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+        return expandBits(uint32_t(q.x)) * 4 + expandBits(uint32_t(q.y)) * 2 + expandBits(uint32_t(q.z));
+    }
+
+    // LBVH：质心的 Morton 码并行计算后基数排序，区间按首尾 Morton 码的最高不同位二分
+    // （码相同的区间按中点二分），最后自底向上合并包围盒
+    void buildLBVH(const std::vector<AABB>& boxes, int maxLeafSize) {
+        size_t n = boxes.size();
+        std::vector<glm::vec3> centroids = centroidsOf(boxes);
+        AABB centroidBox;
+        for (const auto& c : centroids) centroidBox.expand(c);
+        glm::vec3 invExtent = 1.0f / glm::max(centroidBox.max - centroidBox.min, glm::vec3(1e-30f));
+
+        std::vector<uint32_t> codes(n);
+        int threads = int(std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+                    codes[i] = morton((centroids[i] - centroidBox.min) * invExtent);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        // 三趟 10 位的 LSD 基数排序
+        std::vector<uint32_t> sorted(n), sortedCodes(n);
+        std::vector<uint32_t> keys(n);
+        for (size_t i = 0; i < n; ++i) keys[i] = codes[order[i]];
+        for (int shift = 0; shift < 30; shift += 10) {
+            uint32_t start[1025] = {0};
+            for (size_t i = 0; i < n; ++i) start[((keys[i] >> shift) & 1023u) + 1]++;
+            for (int b = 0; b < 1024; ++b) start[b + 1] += start[b];
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t b = (keys[i] >> shift) & 1023u;
+                sorted[start[b]] = order[i];
+                sortedCodes[start[b]++] = keys[i];
+            }
+            order.swap(sorted);
+            keys.swap(sortedCodes);
+        }
+
+        struct Task { uint32_t node, begin, end; };
+        nodes.resize(1);
+        std::vector<Task> stack = {{0, 0, (uint32_t)n}};
+        while (!stack.empty()) {
+            Task task = stack.back();
+            stack.pop_back();
+            if (task.end - task.begin <= (uint32_t)maxLeafSize) {
+                nodes[task.node].first = task.begin;
+                nodes[task.node].count = task.end - task.begin;
+                continue;
+            }
+            uint32_t first = keys[task.begin], last = keys[task.end - 1];
+            uint32_t mid;
+            if (first == last) {
+                mid = (task.begin + task.end) / 2;
+            } else {
+                // 区间内的码有序，最高不同位为 0 的在前，二分查找第一个为 1 的位置
+                uint32_t bit = 1u << (31 - __builtin_clz(first ^ last));
+                mid = uint32_t(std::partition_point(keys.begin() + task.begin, keys.begin() + task.end,
+                                                    [&](uint32_t code) { return !(code & bit); }) - keys.begin());
+            }
+            uint32_t child = (uint32_t)nodes.size();
+            nodes[task.node].first = child;
+            nodes[task.node].count = 0;
+            nodes.resize(nodes.size() + 2);
+            stack.push_back({child + 1, mid, task.end});
+            stack.push_back({child, task.begin, mid});
+        }
+
+        // 子节点的下标总是大于父节点，倒序遍历即自底向上
+        for (size_t i = nodes.size(); i-- > 0;) {
+            AABB box;
+            if (nodes[i].count > 0) {
+                for (uint32_t k = nodes[i].first; k < nodes[i].first + nodes[i].count; ++k) box.expand(boxes[order[k]]);
+            } else {
+                box.expand(this->box(nodes[i].first));
+                box.expand(this->box(nodes[i].first + 1));
+            }
+            nodes[i].min = box.min;
+            nodes[i].max = box.max;
+        }
+    }
+};
+
+// 8 叉压缩 BVH 节点（80 字节）：子节点包围盒相对本节点包围盒量化为 8 位，
+// 第 i 个子节点的包围盒为 origin + q * 2^exponent（q 取 qlo/qhi，向外取整，保证保守）。
+// 内部子节点连续存放在 childBase 起；叶子子节点的图元连续存放在 primitiveBase 起，
+// meta 的低 5 位为相对 primitiveBase 的偏移，高 3 位为图元数；空槽的 qlo > qhi，任何光线都不相交
+struct BVH8Node {
+    glm::vec3 origin;
+    int8_t exponent[3];
+    uint8_t innerMask;      // 第 i 位为 1 表示第 i 个子节点是内部节点
+    uint32_t childBase;
+    uint32_t primitiveBase;
+    uint8_t meta[8];        // 内部子节点：在 childBase 之后的序号；叶子子节点：偏移和图元数
+    uint8_t qlo[3][8];
+    uint8_t qhi[3][8];
+};
+
+// 运行时检测，CPU 支持 AVX2 + FMA 时一次测试 8 个子节点
+inline bool cpuHasAVX2() {
+#ifdef BVH_HAS_AVX2_PATH
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+bool bvhUseAVX2 = cpuHasAVX2();
+
+// 由二叉 BVH 合并得到的 8 叉压缩 BVH。
+// 叶子至多 7 个图元，一个节点的叶子图元总数至多 31 个（meta 的位宽限制），因此要求二叉树叶子不超过 3 个图元
+struct BVH8 {
+    std::vector<BVH8Node> nodes;
+    std::vector<uint32_t> primitives;   // 叶子引用的图元，已按节点重新排列
+
+    // binary 的叶子图元数不超过 3；primitives 取值为 binary.order 中的图元下标
+    void build(const BinaryBVH& binary) {
+        nodes.clear();
+        primitives.clear();
+        if (binary.nodes.empty()) return;
+
+        // 自底向上分层：高度（到最深叶子的层数）为 3 的倍数的二叉节点成为 8 叉节点，
+        // 其间的两层内部节点被吸收，最底层的 8 叉节点因此恰好有 8 个叶子子节点。
+        // 自顶向下按表面积贪心展开会把层数的余数留在最底层，节点平均只有约 4 个子节点
+        const auto& src = binary.nodes;
+        std::vector<int> heights(src.size(), 0);
+        for (size_t i = src.size(); i-- > 0;)   // 子节点的下标总是大于父节点
+            if (src[i].count == 0) heights[i] = std::max(heights[src[i].first], heights[src[i].first + 1]) + 1;
+
+        // 根节点是叶子时，包一层只有一个叶子子节点的内部节点
+        std::vector<uint32_t> pending = {0};   // 待输出的二叉节点，与 nodes 一一对应
+        nodes.resize(1);
+        for (size_t n = 0; n < pending.size(); ++n) {
+            uint32_t b = pending[n];
+            std::vector<uint32_t> children;
+            if (src[b].count > 0) {
+                children.push_back(b);
+            } else {
+                children = {src[b].first, src[b].first + 1};
+                for (size_t i = 0; i < children.size() && children.size() < 8;) {
+                    uint32_t c = children[i];
+                    if (src[c].count == 0 && heights[c] % 3 != 0) {
+                        children[i] = src[c].first;
+                        children.push_back(src[c].first + 1);
+                    } else {
+                        ++i;
+                    }
+                }
+            }
+
+            BVH8Node node = {};
+            node.origin = src[b].min;
+            glm::vec3 extent = src[b].max - src[b].min;
+            glm::vec3 scale;
+            for (int a = 0; a < 3; ++a) {
+                int e = extent[a] > 0.0f ? int(std::ceil(std::log2(extent[a] / 255.0f))) : -127;
+                e = glm::clamp(e, -127, 127);
+                // 浮点误差可能使 ceil(extent / 2^e) 达到 256，此时指数加一
+                if (std::ceil(double(extent[a]) / std::ldexp(1.0, e)) > 255.0) e++;
+                node.exponent[a] = int8_t(e);
+                scale[a] = std::ldexp(1.0f, e);
+            }
+            node.childBase = (uint32_t)(pending.size());
+            node.primitiveBase = (uint32_t)primitives.size();
+            for (int a = 0; a < 3; ++a)
+                for (int i = 0; i < 8; ++i) {
+                    node.qlo[a][i] = 1;
+                    node.qhi[a][i] = 0;
+                }
+            int inner = 0, offset = 0;
+            for (size_t i = 0; i < children.size(); ++i) {
+                const BVHNode& child = src[children[i]];
+                for (int a = 0; a < 3; ++a) {
+                    // 两个 float 之差在 double 中是精确的，取整后的包围盒一定包含子节点
+                    node.qlo[a][i] = uint8_t(glm::clamp(std::floor((double(child.min[a]) - node.origin[a]) / scale[a]), 0.0, 255.0));
+                    node.qhi[a][i] = uint8_t(glm::clamp(std::ceil((double(child.max[a]) - node.origin[a]) / scale[a]), 0.0, 255.0));
+                }
+                if (child.count == 0) {
+                    node.innerMask |= uint8_t(1 << i);
+                    node.meta[i] = uint8_t(inner++);
+                    pending.push_back(children[i]);
+                } else {
+                    node.meta[i] = uint8_t(child.count << 5 | offset);
+                    for (uint32_t k = 0; k < child.count; ++k) primitives.push_back(binary.order[child.first + k]);
+                    offset += child.count;
+                }
+            }
+            nodes[n] = node;
+            nodes.resize(pending.size());
+        }
+    }
+
+    size_t memoryBytes() const {
+        return nodes.size() * sizeof(BVH8Node);
+    }
+
+    // 与 BinaryBVH::traverse 相同：leaf(first, count) 测试 primitives[first, first + count) 并返回新的最近距离
+    template <typename Leaf>
+    void traverse(const Ray& ray, float closest, Leaf leaf) const {
+        traverse(nodes.data(), nodes.size(), ray, closest, leaf);
+    }
+
+    template <typename Leaf>
+    static void traverse(const BVH8Node* nodes, size_t nodeCount, const Ray& ray, float closest, Leaf leaf) {
+        if (nodeCount == 0) return;
+        RayData r(ray);
+        // 栈元素：最高位为 1 表示叶子（低位为图元区间），否则为节点下标；tNear 用于出栈时剔除
+        struct Entry { uint32_t item; float tNear; };
+        Entry stack[8 * 32];
+        int top = 0;
+        stack[top++] = {0, 0.0f};
+        while (top > 0) {
+            Entry entry = stack[--top];
+            if (entry.tNear > closest) continue;
+            if (entry.item & 0x80000000u) {
+                closest = leaf((entry.item & 0x7fffffffu) >> 3, entry.item & 7u);
+                continue;
+            }
+            const BVH8Node& node = nodes[entry.item];
+            float tNear[8];
+            uint32_t hitMask;
+#ifdef BVH_HAS_AVX2_PATH
+            if (bvhUseAVX2) hitMask = childrenAVX2(node, r, closest, tNear);
+            else
+#endif
+                hitMask = childrenScalar(node, r, closest, tNear);
+
+            // 按 tNear 从远到近入栈，近的先出栈
+            int order[8], count = 0;
+            for (int i = 0; i < 8; ++i) {
+                if (!(hitMask & (1u << i))) continue;
+                int k = count++;
+                while (k > 0 && tNear[order[k - 1]] < tNear[i]) {
+                    order[k] = order[k - 1];
+                    k--;
+                }
+                order[k] = i;
+            }
+            for (int k = 0; k < count; ++k) {
+                int i = order[k];
+                uint32_t item;
+                if (node.innerMask & (1u << i)) {
+                    item = node.childBase + node.meta[i];
+                } else {
+                    uint32_t first = node.primitiveBase + (node.meta[i] & 31u);
+                    item = 0x80000000u | first << 3 | (node.meta[i] >> 5);
+                }
+                stack[top++] = {item, tNear[i]};
+            }
+        }
+    }
+
+private:
+    // 每条光线预先算好的量，近平面按方向符号选 qlo 或 qhi
+    struct RayData {
+        glm::vec3 origin, invDir;
+        bool negative[3];
+        explicit RayData(const Ray& ray) : origin(toVec3(ray.origin)), invDir(1.0f / toVec3(ray.direction)) {
+            for (int a = 0; a < 3; ++a) negative[a] = invDir[a] < 0.0f;
+        }
+    };
+
+    static uint32_t childrenScalar(const BVH8Node& node, const RayData& r, float closest, float* tNear) {
+        float scale[3], offset[3];
+        for (int a = 0; a < 3; ++a) {
+            scale[a] = std::ldexp(1.0f, node.exponent[a]) * r.invDir[a];
+            offset[a] = (node.origin[a] - r.origin[a]) * r.invDir[a];
+        }
+        uint32_t mask = 0;
+        for (int i = 0; i < 8; ++i) {
+            float tEnter = 0.0f, tExit = closest;
+            for (int a = 0; a < 3; ++a) {
+                const uint8_t* qNear = r.negative[a] ? node.qhi[a] : node.qlo[a];
+                const uint8_t* qFar = r.negative[a] ? node.qlo[a] : node.qhi[a];
+                tEnter = std::max(tEnter, qNear[i] * scale[a] + offset[a]);
+                tExit = std::min(tExit, qFar[i] * scale[a] + offset[a]);
+            }
+            tNear[i] = tEnter;
+            if (tEnter <= tExit) mask |= 1u << i;
+        }
+        return mask;
+    }
+
+#ifdef BVH_HAS_AVX2_PATH
+    __attribute__((target("avx2,fma")))
+    static uint32_t childrenAVX2(const BVH8Node& node, const RayData& r, float closest, float* tNear) {
+        __m256 tEnter = _mm256_setzero_ps();
+        __m256 tExit = _mm256_set1_ps(closest);
+        for (int a = 0; a < 3; ++a) {
+            const uint8_t* qNear = r.negative[a] ? node.qhi[a] : node.qlo[a];
+            const uint8_t* qFar = r.negative[a] ? node.qlo[a] : node.qhi[a];
+            __m256 nearQ = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(qNear))));
+            __m256 farQ = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(qFar))));
+            __m256 scale = _mm256_set1_ps(std::ldexp(1.0f, node.exponent[a]) * r.invDir[a]);
+            __m256 offset = _mm256_set1_ps((node.origin[a] - r.origin[a]) * r.invDir[a]);
+            tEnter = _mm256_max_ps(tEnter, _mm256_fmadd_ps(nearQ, scale, offset));
+            tExit = _mm256_min_ps(tExit, _mm256_fmadd_ps(farQ, scale, offset));
+        }
+        _mm256_storeu_ps(tNear, tEnter);
+        return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ));
+    }
+#endif
+};
+#endif
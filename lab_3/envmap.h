@@ -0,0 +1,249 @@
+#ifndef ENVMAP_H
+#define ENVMAP_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <stb_image.h>
+
+#include "object.h"
+#include "accel.h"
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+// 由交点位置散列出的随机数（PCG）。同一点每次得到相同的样本序列，画面不随线程调度变化
+struct HashRandom {
+    uint32_t state;
+
+    explicit HashRandom(const glm::vec3& p) {
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        state = bits[0] * 0x9e3779b1u ^ bits[1] * 0x85ebca77u ^ bits[2] * 0xc2b2ae3du;
+        next();
+    }
+
+    // [0, 1) 内的均匀分布
+    float next() {
+        state = state * 747796405u + 2891336453u;
+        uint32_t w = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        w = (w >> 22u) ^ w;
+        return (w >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+// 经纬度（equirectangular）布局的 HDR 环境贴图，同时作为背景和光源：
+// 未命中物体的光线取贴图的辐亮度，漫反射交点按亮度重要性采样环境光。
+// 第 0 行为正上方（+y），u = 0.5 对应 -z 方向。
+// 每个像素的采样概率正比于亮度乘以该行的 sinθ（像素对应的立体角），存成别名表，O(1) 采样；
+// 光泽反射光线未命中时读取逐级 2x2 平均得到的 mip 层，得到模糊的反射而不必多次采样
+class EnvironmentMap {
+public:
+    bool enabled = false;
+    float intensity = 1.0f;     // 辐亮度的缩放
+    int samples = 16;           // 每个漫反射交点的环境光采样数
+    bool importance = true;     // false 时改为余弦加权的半球采样，用于对比收敛速度
+    float glossyLevel = 3.0f;   // 光泽反射光线未命中时读取的 mip 层（可为小数，在相邻两层间插值）
+
+    // 用 stb_image 读入 .hdr 等浮点图像
+    bool load(const std::string& path) {
+        int w, h, channels;
+        float* data = stbi_loadf(path.c_str(), &w, &h, &channels, 3);
+        if (!data) {
+            std::cerr << "failed to load environment map " << path << ": " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+        std::vector<glm::vec3> texels(size_t(w) * h);
+        std::memcpy(texels.data(), data, texels.size() * sizeof(glm::vec3));
+        stbi_image_free(data);
+        setImage(w, h, std::move(texels));
+        return true;
+    }
+
+    // 没有贴图文件时使用的程序化天空：天顶到地平线的渐变、暗色地面和一个小而亮的太阳
+    void makeSky(int width = 512, int height = 256, const glm::vec3& sunDirection = glm::vec3(0.4f, 0.6f, -0.7f),
+                 const glm::vec3& sunRadiance = glm::vec3(900.0f, 820.0f, 700.0f), float sunDegrees = 1.5f) {
+        glm::vec3 sun = glm::normalize(sunDirection);
+        float cosSun = std::cos(glm::radians(sunDegrees));
+        std::vector<glm::vec3> texels(size_t(width) * height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                glm::vec3 d = direction((x + 0.5f) / width, (y + 0.5f) / height);
+                glm::vec3 c;
+                if (d.y >= 0.0f) c = glm::mix(glm::vec3(0.9f, 0.85f, 0.8f), glm::vec3(0.25f, 0.45f, 0.9f), std::sqrt(d.y));
+                else c = glm::vec3(0.12f, 0.1f, 0.08f);
+                if (glm::dot(d, sun) >= cosSun) c = sunRadiance;
+                texels[size_t(y) * width + x] = c;
+            }
+        }
+        setImage(width, height, std::move(texels));
+    }
+
+    bool loaded() const { return !levels.empty(); }
+    int width() const { return loaded() ? levels[0].width : 0; }
+    int height() const { return loaded() ? levels[0].height : 0; }
+    int levelCount() const { return int(levels.size()); }
+
+    // 设置贴图并建立 mip 链和别名表
+    void setImage(int width, int height, std::vector<glm::vec3> texels) {
+        levels.clear();
+        levels.push_back({width, height, std::move(texels)});
+        while (levels.back().width > 1 && levels.back().height > 1) {
+            const Level& src = levels.back();
+            Level dst = {src.width / 2, src.height / 2, {}};
+            dst.texels.resize(size_t(dst.width) * dst.height);
+            for (int y = 0; y < dst.height; ++y)
+                for (int x = 0; x < dst.width; ++x)
+                    dst.texels[size_t(y) * dst.width + x] = 0.25f * (src.at(2 * x, 2 * y) + src.at(2 * x + 1, 2 * y) +
+                                                                   src.at(2 * x, 2 * y + 1) + src.at(2 * x + 1, 2 * y + 1));
+            levels.push_back(std::move(dst));
+        }
+        buildAliasTable();
+    }
+
+    // 方向 d 上的辐亮度，level 为 mip 层
+    glm::vec3 radiance(const glm::vec3& d, float level = 0.0f) const {
+        if (levels.empty()) return glm::vec3(0.0f);
+        float u, v;
+        coordinates(d, u, v);
+        level = glm::clamp(level, 0.0f, float(levels.size() - 1));
+        int l0 = int(level);
+        int l1 = std::min(l0 + 1, int(levels.size()) - 1);
+        glm::vec3 c = levels[l0].bilinear(u, v);
+        if (l1 != l0) c = glm::mix(c, levels[l1].bilinear(u, v), level - l0);
+        return intensity * c;
+    }
+
+    // 点 p（法线 n）处来自环境的辐照度 E = ∫ L cosθ dω 的估计，阴影光线检测遮挡
+    glm::vec3 irradiance(const glm::vec3& p, const glm::vec3& n, const Accel& accel) const {
+        if (levels.empty() || samples <= 0) return glm::vec3(0.0f);
+        HashRandom rng(p);
+        Ray shadowRay;
+        shadowRay.origin = toAligned(p + n * 0.001f);
+        glm::vec3 sum(0.0f);
+        for (int s = 0; s < samples; ++s) {
+            glm::vec3 d;
+            float pdf;
+            if (importance) d = sample(rng, pdf);
+            else d = sampleCosine(n, rng, pdf);
+            float cosine = glm::dot(n, d);
+            if (cosine <= 0.0f || pdf <= 0.0f) continue;
+            shadowRay.direction = toAligned(d);
+            tracedRays++;
+            if (accel.occluded(shadowRay, std::numeric_limits<float>::max())) continue;
+            sum += radiance(d) * (cosine / pdf);
+        }
+        return sum / float(samples);
+    }
+
+    // 按别名表选出像素，在像素内均匀抖动，返回方向及其立体角上的概率密度
+    glm::vec3 sample(HashRandom& rng, float& pdf) const {
+        const Level& base = levels[0];
+        size_t count = aliasProbability.size();
+        size_t i = std::min(size_t(rng.next() * count), count - 1);
+        if (rng.next() >= aliasProbability[i]) i = alias[i];
+        int x = int(i % base.width), y = int(i / base.width);
+        float u = (x + rng.next()) / base.width, v = (y + rng.next()) / base.height;
+        float sinTheta = std::sin(v * glm::pi<float>());
+        // 像素在 (u, v) 上均匀，dω = 2π² sinθ du dv
+        pdf = sinTheta > 1e-6f ? pixelProbability[i] * count / (2.0f * glm::pi<float>() * glm::pi<float>() * sinTheta) : 0.0f;
+        return direction(u, v);
+    }
+
+private:
+    struct Level {
+        int width, height;
+        std::vector<glm::vec3> texels;
+
+        // 水平方向环绕，竖直方向截断
+        const glm::vec3& at(int x, int y) const {
+            x = ((x % width) + width) % width;
+            y = glm::clamp(y, 0, height - 1);
+            return texels[size_t(y) * width + x];
+        }
+
+        glm::vec3 bilinear(float u, float v) const {
+            float fx = u * width - 0.5f, fy = v * height - 0.5f;
+            int x = int(std::floor(fx)), y = int(std::floor(fy));
+            float tx = fx - x, ty = fy - y;
+            return glm::mix(glm::mix(at(x, y), at(x + 1, y), tx), glm::mix(at(x, y + 1), at(x + 1, y + 1), tx), ty);
+        }
+    };
+
+    std::vector<Level> levels;
+    std::vector<float> aliasProbability;    // 别名表：留在本格的概率
+    std::vector<uint32_t> alias;            // 别名表：不留时转到的像素
+    std::vector<float> pixelProbability;    // 每个像素被选中的概率
+
+    static glm::vec3 direction(float u, float v) {
+        float theta = v * glm::pi<float>();
+        float phi = (u - 0.5f) * 2.0f * glm::pi<float>();
+        return glm::vec3(std::sin(theta) * std::sin(phi), std::cos(theta), -std::sin(theta) * std::cos(phi));
+    }
+
+    static void coordinates(const glm::vec3& d, float& u, float& v) {
+        u = 0.5f + std::atan2(d.x, -d.z) * (0.5f * glm::one_over_pi<float>());
+        v = std::acos(glm::clamp(d.y, -1.0f, 1.0f)) * glm::one_over_pi<float>();
+    }
+
+    // 余弦加权的半球采样，pdf = cosθ / π
+    static glm::vec3 sampleCosine(const glm::vec3& n, HashRandom& rng, float& pdf) {
+        float r = std::sqrt(rng.next()), phi = 2.0f * glm::pi<float>() * rng.next();
+        glm::vec3 t = std::abs(n.x) > 0.5f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 b1 = glm::normalize(glm::cross(n, t)), b2 = glm::cross(n, b1);
+        float z = std::sqrt(std::max(0.0f, 1.0f - r * r));
+        pdf = z * glm::one_over_pi<float>();
+        return r * std::cos(phi) * b1 + r * std::sin(phi) * b2 + z * n;
+    }
+
+    // Vose 的别名表：权重为亮度乘以 sinθ，另加上平均值的一小部分，保证有辐亮度的像素都能被采到
+    void buildAliasTable() {
+        const Level& base = levels[0];
+        size_t count = base.texels.size();
+        std::vector<double> weight(count);
+        double total = 0.0;
+        for (int y = 0; y < base.height; ++y) {
+            float sinTheta = std::sin((y + 0.5f) * glm::pi<float>() / base.height);
+            for (int x = 0; x < base.width; ++x) {
+                const glm::vec3& c = base.texels[size_t(y) * base.width + x];
+                weight[size_t(y) * base.width + x] = std::max(0.2126 * c.r + 0.7152 * c.g + 0.0722 * c.b, 0.0) * sinTheta;
+                total += weight[size_t(y) * base.width + x];
+            }
+        }
+        double floor = total > 0.0 ? 1e-3 * total / count : 1.0;
+        total = 0.0;
+        for (double& w : weight) total += (w += floor);
+
+        pixelProbability.resize(count);
+        aliasProbability.resize(count);
+        alias.resize(count);
+        std::vector<double> scaled(count);
+        std::vector<uint32_t> small, large;
+        for (size_t i = 0; i < count; ++i) {
+            pixelProbability[i] = float(weight[i] / total);
+            scaled[i] = weight[i] / total * count;
+            (scaled[i] < 1.0 ? small : large).push_back(uint32_t(i));
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            aliasProbability[s] = float(scaled[s]);
+            alias[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // 剩下的格子因舍入误差没有配对，概率视为 1
+        for (uint32_t i : small) { aliasProbability[i] = 1.0f; alias[i] = i; }
+        for (uint32_t i : large) { aliasProbability[i] = 1.0f; alias[i] = i; }
+    }
+};
+EnvironmentMap environment;
+#endif
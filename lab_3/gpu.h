@@ -0,0 +1,114 @@
+#ifndef GPU_H
+#define GPU_H
+
+// 计算着色器后端：trace.comp 在 GPU 上对每个像素追踪与 CPU 路径相同的直接光照和镜面反射，
+// 场景以 SSBO 的形式上传，结果用 imageStore 直接写入显示纹理，不经过像素缓冲。
+// 需要 OpenGL 4.3（计算着色器和 SSBO）；只支持球和墙面，辐照度缓存和光子图仍只在 CPU 路径上
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "object.h"
+
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+// 与 trace.comp 中的 GpuObject 布局一致（std430，每个成员 16 字节）
+struct GpuObject {
+    glm::vec4 position;     // 球心 / 墙的中心点，w 为球的半径 / 墙的宽度
+    glm::vec4 normal;       // 墙的法线，w 为墙的高度
+    glm::vec4 right;
+    glm::vec4 up;
+    glm::vec4 color;        // w 为反射率
+    glm::ivec4 kind;        // x 为物体类型（0 球，1 墙），y 为材质
+};
+static_assert(sizeof(GpuObject) == 96, "GpuObject must match the std430 layout in trace.comp");
+
+class GpuTracer {
+public:
+    // 在当前 OpenGL 上下文中编译计算着色器，上下文不支持 4.3 或编译失败时返回 false
+    bool init(const char* computePath = "trace.comp") {
+        if (shader) return true;
+        if (!GLAD_GL_VERSION_4_3) {
+            std::cerr << "compute backend needs OpenGL 4.3" << std::endl;
+            return false;
+        }
+        std::unique_ptr<Shader> program(new Shader(nullptr, nullptr, nullptr, computePath));
+        GLint linked = 0;
+        glGetProgramiv(program->ID, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(program->ID);
+            return false;
+        }
+        shader = std::move(program);
+        glGenBuffers(1, &buffer);
+        return true;
+    }
+
+    bool ready() const { return shader != nullptr; }
+
+    // 场景中只有球和墙面时才能在 GPU 上追踪
+    static bool supports(const std::vector<Object*>& objects) {
+        for (const Object* object : objects)
+            if (!dynamic_cast<const Sphere*>(object) && !dynamic_cast<const Wall*>(object)) return false;
+        return true;
+    }
+
+    // 把物体写入 SSBO，物体被修改后重新上传
+    void upload(const std::vector<Object*>& objects) {
+        std::vector<GpuObject> data;
+        data.reserve(objects.size());
+        for (const Object* object : objects) {
+            GpuObject g = {};
+            if (const Sphere* sphere = dynamic_cast<const Sphere*>(object)) {
+                g.position = glm::vec4(toVec3(sphere->center), sphere->radius);
+                g.kind.x = 0;
+            } else if (const Wall* wall = dynamic_cast<const Wall*>(object)) {
+                g.position = glm::vec4(toVec3(wall->point), wall->width);
+                g.normal = glm::vec4(toVec3(wall->normal), wall->height);
+                g.right = glm::vec4(toVec3(wall->right), 0.0f);
+                g.up = glm::vec4(toVec3(wall->up), 0.0f);
+                g.kind.x = 1;
+            } else continue;
+            g.color = glm::vec4(object->color, object->reflectivity);
+            g.kind.y = object->material;
+            data.push_back(g);
+        }
+        objectCount = int(data.size());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        // 空缓冲不能绑定，至少分配一个物体的大小
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(data.size(), 1) * sizeof(GpuObject), data.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // 整帧追踪并写入 texture（内部格式须为 GL_RGBA8）。只提交命令，不等待 GPU 完成；
+    // 之后对该纹理的采样和读回由屏障保证看到结果
+    void render(unsigned int texture, int width, int height, const Camera& camera, const Light& light) {
+        CameraFrame frame(camera, width, height);
+        shader->use();
+        shader->setIVec2("resolution", width, height);
+        shader->setInt("objectCount", objectCount);
+        shader->setVec3("cameraPosition", frame.position);
+        shader->setVec3("cameraForward", frame.forward);
+        shader->setVec3("cameraRight", frame.right);
+        shader->setVec3("cameraUp", frame.up);
+        shader->setFloat("aspectRatio", frame.aspectRatio);
+        shader->setFloat("scale", frame.scale);
+        shader->setVec3("lightPosition", light.position);
+        shader->setVec3("lightColor", light.color);
+
+        glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffer);
+        glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    }
+
+private:
+    std::unique_ptr<Shader> shader;
+    unsigned int buffer = 0;
+    int objectCount = 0;
+};
+#endif
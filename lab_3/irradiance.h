@@ -0,0 +1,266 @@
+#ifndef IRRADIANCE_H
+#define IRRADIANCE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "object.h"
+#include "accel.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// 一条辐照度记录（Ward 1988），梯度按 Ward & Heckbert 1992 由半球采样的分层结构求出。
+// 三个颜色通道各有一个旋转梯度和一个平移梯度
+struct IrradianceRecord {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 irradiance;               // 间接漫反射辐照度 E
+    glm::vec3 rotationGradient[3];
+    glm::vec3 translationGradient[3];
+    float radius;                       // 到周围表面的调和平均距离，已按上下限和平移梯度截断
+};
+
+// 辐照度缓存：间接漫反射随位置变化平缓，只在少数点上做半球采样，其余点由附近的记录插值。
+// 记录存放在八叉树中（与 PBRT 的做法相同）：记录按其有效范围的包围盒放入尺寸相当的节点，
+// 查询时沿包含查询点的路径向下，检查路径上各节点中的记录。
+// 渲染线程共享同一个缓存，查询持读锁，新记录持写锁插入；记录与视点无关，相机移动时继续有效，
+// 物体或光源变化时需要调用 clear()。多线程下新记录的位置取决于 tile 的完成顺序，画面不保证逐字节可复现
+class IrradianceCache {
+public:
+    bool enabled = false;
+    float accuracy = 0.25f;     // 插值误差上限 a：越小记录越密
+    float minRadius = 0.05f;    // 记录有效半径 R 的下限（世界坐标）
+    float maxRadius = 2.0f;     // 记录有效半径 R 的上限（世界坐标）
+    int thetaSamples = 8;       // 半球采样的仰角分层数 M，方位角分为 N ≈ πM 层
+
+    // 清空全部记录，八叉树的根节点取场景的包围盒
+    void clear(const std::vector<Object*>& objects) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        AABB box;
+        for (const auto* object : objects) box.expand(AABB::of(object));
+        if (objects.empty()) box = {glm::vec3(-1.0f), glm::vec3(1.0f)};
+        glm::vec3 margin = 0.01f * (box.max - box.min) + 1e-3f;
+        rootMin = box.min - margin;
+        rootMax = box.max + margin;
+        root.reset(new Node());
+        records.clear();
+        lookups = 0;
+        computed = 0;
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return records.size();
+    }
+
+    // 点 p（法线 n）处的间接漫反射辐照度。附近的记录覆盖 p 时插值，否则在 p 处采样并新建一条记录
+    glm::vec3 irradiance(const glm::vec3& p, const glm::vec3& n, const Accel& accel, const Light& light) {
+        lookups++;
+        glm::vec3 result;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            if (root && interpolate(p, n, result)) return result;
+        }
+        IrradianceRecord record = sample(p, n, accel, light);
+        computed++;
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (!root) root.reset(new Node());
+        records.push_back(record);
+        float extent = accuracy * record.radius;
+        insert(root.get(), rootMin, rootMax, uint32_t(records.size() - 1), record.position - extent, record.position + extent, 0);
+        return record.irradiance;
+    }
+
+    // 自上次 clear() 以来的查询次数和新建记录数
+    std::atomic<long long> lookups{0};
+    std::atomic<long long> computed{0};
+
+private:
+    struct Node {
+        std::vector<uint32_t> records;
+        std::unique_ptr<Node> children[8];
+    };
+
+    static const int MAX_DEPTH = 16;
+
+    mutable std::shared_mutex mutex;
+    std::vector<IrradianceRecord> records;
+    std::unique_ptr<Node> root;
+    glm::vec3 rootMin = glm::vec3(-1.0f), rootMax = glm::vec3(1.0f);
+
+    static int childOf(const glm::vec3& p, const glm::vec3& mid) {
+        return (p.x > mid.x) | (p.y > mid.y) << 1 | (p.z > mid.z) << 2;
+    }
+
+    static void childBounds(int child, glm::vec3& lo, glm::vec3& hi) {
+        glm::vec3 mid = 0.5f * (lo + hi);
+        for (int a = 0; a < 3; ++a) {
+            if (child >> a & 1) lo[a] = mid[a];
+            else hi[a] = mid[a];
+        }
+    }
+
+    // 记录放入与其有效范围重叠、且尺寸不小于有效范围的最深一层节点；超出根节点的记录留在根节点
+    void insert(Node* node, const glm::vec3& lo, const glm::vec3& hi, uint32_t index,
+                const glm::vec3& boxMin, const glm::vec3& boxMax, int depth) {
+        bool inside = depth > 0 || (glm::all(glm::greaterThanEqual(boxMin, lo)) && glm::all(glm::lessThanEqual(boxMax, hi)));
+        if (!inside || depth == MAX_DEPTH || glm::length(hi - lo) < glm::length(boxMax - boxMin)) {
+            node->records.push_back(index);
+            return;
+        }
+        for (int child = 0; child < 8; ++child) {
+            glm::vec3 childLo = lo, childHi = hi;
+            childBounds(child, childLo, childHi);
+            if (glm::any(glm::greaterThan(boxMin, childHi)) || glm::any(glm::lessThan(boxMax, childLo))) continue;
+            if (!node->children[child]) node->children[child].reset(new Node());
+            insert(node->children[child].get(), childLo, childHi, index, boxMin, boxMax, depth + 1);
+        }
+    }
+
+    // 按 Ward 的权重 w = 1/ε - 1/a 对覆盖 p 的记录加权平均，ε 同时考虑距离和法线夹角；
+    // 每条记录先用旋转梯度和平移梯度外推到 p
+    bool interpolate(const glm::vec3& p, const glm::vec3& n, glm::vec3& result) const {
+        glm::vec3 sum(0.0f);
+        float weightSum = 0.0f;
+        const Node* node = root.get();
+        glm::vec3 lo = rootMin, hi = rootMax;
+        while (node) {
+            for (uint32_t i : node->records) {
+                const IrradianceRecord& r = records[i];
+                glm::vec3 d = p - r.position;
+                // p 位于记录所在切平面的前方时，记录看不到 p 附近的遮挡物，不能使用
+                if (glm::dot(d, r.normal + n) < -0.02f * r.radius) continue;
+                float error = glm::length(d) / r.radius + std::sqrt(std::max(0.0f, 1.0f - glm::dot(n, r.normal)));
+                if (error >= accuracy) continue;
+                float w = 1.0f / std::max(error, 1e-6f) - 1.0f / accuracy;
+                glm::vec3 axis = glm::cross(r.normal, n);
+                glm::vec3 e = r.irradiance;
+                for (int c = 0; c < 3; ++c)
+                    e[c] += glm::dot(axis, r.rotationGradient[c]) + glm::dot(d, r.translationGradient[c]);
+                sum += w * glm::max(e, glm::vec3(0.0f));
+                weightSum += w;
+            }
+            if (glm::any(glm::lessThan(p, lo)) || glm::any(glm::greaterThan(p, hi))) break;
+            int child = childOf(p, 0.5f * (lo + hi));
+            childBounds(child, lo, hi);
+            node = node->children[child].get();
+        }
+        if (weightSum <= 0.0f) return false;
+        result = sum / weightSum;
+        return true;
+    }
+
+    // 表面点朝 -dir 方向离开的辐射度：只算光源的直接漫反射（一次间接反弹）
+    static glm::vec3 radiance(const glm::vec3& point, const glm::vec3& normal, const Object* object,
+                              const Accel& accel, const Light& light) {
+        glm::vec3 toLight = light.position - point;
+        float distance = glm::length(toLight);
+        glm::vec3 lightDir = toLight / distance;
+        float diff = glm::dot(normal, lightDir);
+        if (diff <= 0.0f) return glm::vec3(0.0f);
+        Ray shadowRay;
+        shadowRay.origin = toAligned(point + normal * 0.001f);
+        shadowRay.direction = toAligned(lightDir);
+        tracedRays++;
+        if (accel.occluded(shadowRay, distance)) return glm::vec3(0.0f);
+        return diff * object->color * light.color;
+    }
+
+    // 在 p 处做 M x N 分层的余弦加权半球采样，求出辐照度、调和平均距离和两种梯度
+    IrradianceRecord sample(const glm::vec3& p, const glm::vec3& n, const Accel& accel, const Light& light) const {
+        const float pi = glm::pi<float>();
+        int M = std::max(thetaSamples, 2);
+        int N = std::max(3, int(std::round(pi * M)));
+
+        // 切平面内的正交基
+        glm::vec3 t = std::fabs(n.x) > 0.5f ? glm::vec3(n.y, -n.x, 0.0f) : glm::vec3(0.0f, n.z, -n.y);
+        t = glm::normalize(t);
+        glm::vec3 b = glm::cross(n, t);
+
+        thread_local std::mt19937 rng(7919);
+        std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+        thread_local std::vector<glm::vec3> L;
+        thread_local std::vector<float> R;
+        L.assign(M * N, glm::vec3(0.0f));
+        R.assign(M * N, std::numeric_limits<float>::max());
+
+        IrradianceRecord record;
+        record.position = p;
+        record.normal = n;
+        record.irradiance = glm::vec3(0.0f);
+        for (int c = 0; c < 3; ++c) record.rotationGradient[c] = record.translationGradient[c] = glm::vec3(0.0f);
+
+        Ray ray;
+        ray.origin = toAligned(p + n * 0.001f);
+        float inverseDistance = 0.0f;
+        for (int k = 0; k < N; ++k) {
+            for (int j = 0; j < M; ++j) {
+                // sin²θ 在 [j/M, (j+1)/M) 内均匀分布，即按 cosθ 加权
+                float sin2 = (j + uni(rng)) / M;
+                float sinTheta = std::sqrt(sin2), cosTheta = std::sqrt(1.0f - sin2);
+                float phi = 2.0f * pi * (k + uni(rng)) / N;
+                glm::vec3 dir = std::cos(phi) * sinTheta * t + std::sin(phi) * sinTheta * b + cosTheta * n;
+                ray.direction = toAligned(dir);
+                tracedRays++;
+                Hit hit;
+                if (!accel.intersect(ray, hit)) continue;
+                glm::vec3 point = toVec3(ray.origin + hit.t * ray.direction);
+                glm::vec3& l = L[j * N + k];
+                l = radiance(point, toVec3(hit.normal), hit.object, accel, light);
+                R[j * N + k] = hit.t;
+                inverseDistance += 1.0f / hit.t;
+                record.irradiance += l;
+
+                // 旋转梯度：沿方位角 φ + π/2 方向，权重为 -tanθ
+                glm::vec3 v = -std::sin(phi) * t + std::cos(phi) * b;
+                float tanTheta = sinTheta / std::max(cosTheta, 1e-3f);
+                for (int c = 0; c < 3; ++c) record.rotationGradient[c] -= tanTheta * l[c] * v;
+            }
+        }
+        float scale = pi / (M * N);
+        record.irradiance *= scale;
+        for (int c = 0; c < 3; ++c) record.rotationGradient[c] *= scale;
+
+        // 平移梯度：相邻分层之间的边界随 p 移动而改变所覆盖的立体角
+        for (int k = 0; k < N; ++k) {
+            float phiCenter = 2.0f * pi * (k + 0.5f) / N;
+            float phiEdge = 2.0f * pi * k / N;
+            glm::vec3 u = std::cos(phiCenter) * t + std::sin(phiCenter) * b;
+            glm::vec3 v = -std::sin(phiEdge) * t + std::cos(phiEdge) * b;
+            int prev = (k + N - 1) % N;
+            glm::vec3 thetaSum(0.0f), phiSum(0.0f);
+            for (int j = 1; j < M; ++j) {
+                float sinMinus = std::sqrt(float(j) / M), cos2Minus = 1.0f - float(j) / M;
+                float r = std::min(R[j * N + k], R[(j - 1) * N + k]);
+                thetaSum += sinMinus * cos2Minus / r * (L[j * N + k] - L[(j - 1) * N + k]);
+            }
+            for (int j = 0; j < M; ++j) {
+                float sinMinus = std::sqrt(float(j) / M), sinPlus = std::sqrt(float(j + 1) / M);
+                float r = std::min(R[j * N + k], R[j * N + prev]);
+                phiSum += (sinPlus - sinMinus) / r * (L[j * N + k] - L[j * N + prev]);
+            }
+            for (int c = 0; c < 3; ++c)
+                record.translationGradient[c] += (2.0f * pi / N) * thetaSum[c] * u + phiSum[c] * v;
+        }
+
+        // 有效半径取调和平均距离，再按平移梯度限制：外推到边界时变化不超过辐照度本身
+        float radius = inverseDistance > 0.0f ? M * N / inverseDistance : maxRadius;
+        for (int c = 0; c < 3; ++c) {
+            float g = glm::length(record.translationGradient[c]);
+            if (g > 0.0f && record.irradiance[c] > 0.0f) radius = std::min(radius, record.irradiance[c] / g);
+        }
+        record.radius = glm::clamp(radius, minRadius, maxRadius);
+        return record;
+    }
+};
+
+IrradianceCache irradianceCache;
+#endif
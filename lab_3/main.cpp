@@ -8,15 +8,25 @@
 
 #include "shader.h"
 #include "object.h"
+#include "tile.h"
+#include "accel.h"
+#include "tracer.h"
+#include "reprojection.h"
+#include "mesh.h"
+#include "bench.h"
+#include "stream.h"
+#include "gpu.h"
+#include "scaling.h"
 
 #include <iostream>
 #include <vector>
-#include <mutex>
-#include <thread>
-#include <functional>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
 
 int SCR_WIDTH = 1200, SCR_HEIGHT = 800;
-std::vector<unsigned char> pixelBuffer;
+PixelBuffer pixelBuffer;
 unsigned int VAO, VBO, texture;
 
 Sphere redSphere({-1.0f, -1.0f, -4.0f}, 1.0f, {1.0f, 0.0f, 0.0f}, 0.2f);
@@ -27,131 +37,49 @@ Wall leftWall({-2.0f, 0.0f, -3.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, 20.0
 Wall backWall({0.0f, 0.0f, -5.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, 20.0f, 20.0f, {1.0f, 1.0f, 1.0f}, 0.01f);
 
 std::vector<Object*> objects = {&redSphere, &blueSphere, &floors, &leftWall, &backWall};
-
-glm::vec3 trace(const Ray& ray, const std::vector<Object*>& objects, const Light& light, int depth) {
-    if (depth > 3) return glm::vec3(0.0f); // 终止条件
-
-    float t_min = std::numeric_limits<float>::max();
-    const Object* hitObject = nullptr;
-    glm::vec3 hitNormal;
-
-    // 遍历所有物体，找到最近的交点
-    for (const auto* object : objects) {
-        float t;
-        glm::vec3 normal;
-        if (object->intersect(ray, t, normal) && t > 0.001f && t < t_min) {
-            t_min = t;
-            hitObject = object;
-            hitNormal = normal;
-        }
-    }
-
-    if (!hitObject) return glm::vec3(0.0f, 0.0f, 0.0f); // 背景颜色
-
-    glm::vec3 hitPoint = ray.origin + t_min * ray.direction;
-    glm::vec3 lightDir = glm::normalize(light.position - hitPoint);
-
-    // 检测阴影：检查光源到交点之间是否有阻挡
-    bool inShadow = false;
-    Ray shadowRay;
-    shadowRay.origin = hitPoint + hitNormal * 0.001f; // 偏移以避免浮点精度问题
-    shadowRay.direction = lightDir;
-
-    for (const auto* object : objects) {
-        float t;
-        glm::vec3 normal;
-        if (object->intersect(shadowRay, t, normal) && t > 0.001f && t <= glm::length(light.position - hitPoint)) {
-            inShadow = true;
-            break;
-        }
-    }
-
-    // 如果在阴影中，将漫反射和镜面反射光照设置为0
-    glm::vec3 diffuse(0.0f);
-    glm::vec3 specular(0.0f);
-    if (!inShadow) {
-        // 计算漫反射
-        float diff = glm::max(glm::dot(hitNormal, lightDir), 0.0f);
-        diffuse = diff * hitObject->color * light.color;
-
-        // 计算镜面反射
-        glm::vec3 viewDir = glm::normalize(-ray.direction);
-        glm::vec3 reflectDir = glm::reflect(-lightDir, hitNormal);
-        float spec = glm::pow(glm::max(glm::dot(viewDir, reflectDir), 0.0f), 32);
-        specular = spec * light.color;
-    }
-
-    // 递归反射
-    glm::vec3 reflectionColor(0.0f);
-    if (hitObject->reflectivity > 0.0f) {
-        Ray reflectedRay;
-        reflectedRay.origin = hitPoint + hitNormal * 0.001f; // 避免浮点精度问题
-        reflectedRay.direction = glm::reflect(ray.direction, hitNormal);
-        reflectionColor = trace(reflectedRay, objects, light, depth + 1);
-    }
-
-    return diffuse + specular + reflectionColor * hitObject->reflectivity;
-}
-
-// 渲染单行的函数
-void renderRow(int startY, int endY, int width, int height, const Camera& camera, const Light& light) {
-    float aspectRatio = float(width) / float(height);
-    float scale = glm::tan(glm::radians(camera.fov * 0.5f));
-
-    // 计算前方向、右方向、上方向
-    glm::vec3 forward = glm::normalize(camera.direction);
-    glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
-    glm::vec3 up = glm::normalize(glm::cross(right, forward));
-
-    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(camera.angle), forward);
-    right = glm::vec3(rotation * glm::vec4(right, 1.0f));
-    up = glm::vec3(rotation * glm::vec4(up, 1.0f));
-
-    // 渲染每一行
-    for (int y = startY; y < endY; ++y) {
-        for (int x = 0; x < width; ++x) {
-            float px = (2 * (x + 0.5f) / float(width) - 1) * aspectRatio * scale;
-            float py = (2 * (y + 0.5f) / float(height) - 1) * scale;
-
-            glm::vec3 dir = glm::normalize(forward + px * right + py * up);
-            Ray ray = {camera.position, dir};
-
-            glm::vec3 color = trace(ray, objects, light, 0);
-
-            // 计算像素索引并保护对 pixelBuffer 的写操作
-            int index = (y * width + x) * 3;
-            {
-                // std::lock_guard<std::mutex> lock(bufferMutex);
-                pixelBuffer[index] = static_cast<unsigned char>(glm::clamp(color.r, 0.0f, 1.0f) * 255);
-                pixelBuffer[index + 1] = static_cast<unsigned char>(glm::clamp(color.g, 0.0f, 1.0f) * 255);
-                pixelBuffer[index + 2] = static_cast<unsigned char>(glm::clamp(color.b, 0.0f, 1.0f) * 255);
-            }
-        }
-    }
-}
-
-// 多线程渲染函数
-void renderScene(std::vector<unsigned char>& pixelBuffer, int width, int height, const Camera& camera, const Light& light) {
-    int numThreads = std::thread::hardware_concurrency();
-    int rowsPerThread = height / numThreads;
-
-    std::vector<std::thread> threads;
-    // std::mutex bufferMutex;
-
-    for (int i = 0; i < numThreads; ++i) {
-        int startY = i * rowsPerThread;
-        int endY = (i == numThreads - 1) ? height : startY + rowsPerThread;
-
-        threads.emplace_back(renderRow, startY, endY, width, height, std::ref(camera), std::ref(light));
-    }
-
-    // 等待所有线程完成
-    for (auto& thread : threads) {
-        thread.join();
-    }
-}
-
-void initTexture(unsigned int &texture, std::vector<unsigned char> &pixelBuffer, int SCR_WIDTH, int SCR_HEIGHT) {
+std::vector<Sphere*> spheres = {&redSphere, &blueSphere};
+DirtyTracker dirtyTracker;
+
+// 求交加速结构，可在控制面板或命令行（--accel linear|grid）中切换
+LinearAccel linearAccel;
+GridAccel gridAccel;
+std::vector<Accel*> accels = {&linearAccel, &gridAccel};
+int accelIndex = 0;
+bool accelDirty = true; // 物体被修改或切换加速结构后需要重新构建
+
+// 时域重投影：相机移动时复用上一帧的结果，停止移动后整帧重新追踪一次
+GBuffer gbuffer;
+ReprojectionCache reprojection;
+std::vector<char> traceMask;
+bool settlePending = false;
+
+// 焦散光子图在场景、光源或参数变化后的下一帧渲染前重新构建
+bool photonsDirty = true;
+
+// 主光线的分块候选表，每次渲染前按当前相机重建
+TileBins tileBins;
+
+// 命令行 --mesh <file> 载入的映射网格（由 writeClusterFile 生成），几何数据按需从文件读入
+std::unique_ptr<ClusterMesh> clusterMesh;
+std::unique_ptr<TriangleMesh> triangleMesh;
+BVHBuilder meshBuilder = BVH_BUILD_MEDIAN; // --obj 和 --convert 建立 BVH 的方式
+
+// 关键帧动画，可在控制面板中编辑首尾关键帧，或用 --animate 在命令行渲染
+AnimationPath animationPath = makeDemoPath();
+int animationFrames = 60;
+int framesInFlight = 4;
+
+// 渲染后端，可在控制面板或命令行（--backend cpu|gpu）中切换。
+// GPU 后端由计算着色器直接写入显示纹理，只支持球和墙面，不使用辐照度缓存、光子图和重投影
+enum Backend { BACKEND_CPU, BACKEND_GPU };
+int backendIndex = BACKEND_CPU;
+GpuTracer gpuTracer;
+bool gpuSceneDirty = true; // 切换到 GPU 后端后需要重新上传场景
+
+// 远程查看（--serve / --connect）的默认端口
+const int STREAM_PORT = 7878;
+
+void initTexture(unsigned int &texture, PixelBuffer &pixelBuffer, int SCR_WIDTH, int SCR_HEIGHT) {
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -204,6 +132,52 @@ void initImGui(GLFWwindow* window) {
     ImGui_ImplOpenGL3_Init("#version 330");
 }
 
+// 光源和相机参数，本地面板和远程查看端的面板共用
+void viewControls(Light& light, Camera& camera) {
+    ImGui::SliderFloat3("Light Position", &light.position[0], -10.0f, 10.0f);
+    ImGui::ColorEdit3("Light Color", &light.color[0]);
+    const char* lightShapes[] = {"Point", "Rectangle", "Sphere"};
+    ImGui::Combo("Light Shape", (int*)&light.shape, lightShapes, IM_ARRAYSIZE(lightShapes));
+    if (light.shape == LIGHT_RECTANGLE) {
+        ImGui::SliderFloat3("Light Edge U", &light.edgeU[0], -4.0f, 4.0f);
+        ImGui::SliderFloat3("Light Edge V", &light.edgeV[0], -4.0f, 4.0f);
+    } else if (light.shape == LIGHT_SPHERE) {
+        ImGui::SliderFloat("Light Radius", &light.radius, 0.01f, 3.0f);
+    }
+
+    ImGui::SliderFloat3("Camera Position", &camera.position[0], -10.0f, 10.0f);
+    ImGui::SliderFloat3("Camera Direction", &camera.direction[0], -1.0f, 1.0f); // 方向调整
+    ImGui::SliderFloat("Camera Angle", &camera.angle, -180.0f, 180.0f);         // 角度调整
+    ImGui::SliderFloat("FOV", &camera.fov, 10.0f, 120.0f);
+}
+
+// 第 i 个球的参数，返回是否被修改
+bool sphereControls(size_t i) {
+    Sphere* sphere = spheres[i];
+    ImGui::PushID(int(i));
+    bool changed = false;
+    changed |= ImGui::SliderFloat3("Sphere Position", &sphere->center[0], -5.0f, 5.0f);
+    changed |= ImGui::SliderFloat("Sphere Radius", &sphere->radius, 0.1f, 3.0f);
+    changed |= ImGui::ColorEdit3("Sphere Color", &sphere->color[0]);
+    changed |= ImGui::SliderFloat("Reflectivity", &sphere->reflectivity, 0.0f, 1.0f);
+    const char* materialNames[] = {"Lambert", "Phong", "Mirror", "Glossy"};
+    changed |= ImGui::Combo("Material", (int*)&sphere->material, materialNames, IM_ARRAYSIZE(materialNames));
+    ImGui::PopID();
+    return changed;
+}
+
+// 切换渲染后端；GPU 不可用（上下文低于 4.3、场景中有其他类型的物体或开启了环境光）时退回 CPU。
+// 两个后端写入显示纹理的方式不同，切换后整帧重绘
+void selectBackend() {
+    if (backendIndex == BACKEND_GPU && (environment.enabled || !GpuTracer::supports(objects) || !gpuTracer.init())) {
+        std::cerr << "GPU backend unavailable, using CPU" << std::endl;
+        backendIndex = BACKEND_CPU;
+    }
+    gpuSceneDirty = true;
+    dirtyTracker.invalidateAll();
+    reprojection.invalidate();
+}
+
 bool makeImGui(Light& light, Camera& camera) {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -211,13 +185,134 @@ bool makeImGui(Light& light, Camera& camera) {
 
     ImGui::Begin("Control Panel");
 
-    ImGui::SliderFloat3("Light Position", &light.position[0], -10.0f, 10.0f);
-    ImGui::ColorEdit3("Light Color", &light.color[0]);
+    viewControls(light, camera);
+
+    const char* backendNames[] = {"CPU", "GPU (Compute Shader)"};
+    if (ImGui::Combo("Backend", &backendIndex, backendNames, IM_ARRAYSIZE(backendNames)))
+        selectBackend();
+
+    const char* accelNames[] = {"Linear", "Grid"};
+    if (ImGui::Combo("Acceleration", &accelIndex, accelNames, IM_ARRAYSIZE(accelNames)))
+        accelDirty = true;
+    ImGui::Checkbox("Bin Secondary Rays", &renderSettings.binSecondaryRays);
+    ImGui::Checkbox("Bin Primary Rays Per Tile", &renderSettings.binPrimaryRays);
+    ImGui::Checkbox("Rasterize Primary Visibility", &renderSettings.rasterPrimary);
+    int placement = renderSettings.placement;
+    if (ImGui::Combo("Thread Placement", &placement, placementNames, PLACEMENT_COUNT))
+        renderSettings.placement = PlacementPolicy(placement);
+    ImGui::SliderInt("Threads (0 = auto)", &renderSettings.threads, 0, (int)cpuTopology().size());
+    ImGui::SliderFloat("Frame Budget (ms, 0 = off)", &renderSettings.frameBudgetMs, 0.0f, 200.0f);
+    int priority = tileScheduler.priority;
+    if (ImGui::Combo("Tile Priority", &priority, priorityNames, PRIORITY_COUNT))
+        tileScheduler.priority = TilePriority(priority);
+    if (renderSettings.frameBudgetMs > 0.0f)
+        ImGui::Text("Pending tiles: %zu", tileScheduler.pending().size());
+    ImGui::SliderFloat("Frame Deadline (ms, 0 = off)", &resolutionScaler.deadlineMs, 0.0f, 100.0f);
+    if (resolutionScaler.deadlineMs > 0.0f)
+        ImGui::Text("Interactive sampling: %s", ResolutionScaler::levelName(resolutionScaler.level));
+    // 面光源的阴影采样，参数变化后整帧重绘
+    bool shadowChanged = false;
+    shadowChanged |= ImGui::SliderInt("Initial Shadow Samples", &areaLights.initialSamples, 1, 16);
+    shadowChanged |= ImGui::SliderInt("Penumbra Shadow Samples", &areaLights.penumbraSamples, 1, 256);
+    shadowChanged |= ImGui::Checkbox("Adaptive Penumbra Sampling", &areaLights.adaptive);
+    if (shadowChanged) dirtyTracker.invalidateAll();
+    if (areaLights.points > 0)
+        ImGui::Text("Penumbra points: %.1f%%, shadow rays per point: %.1f", 100.0 * areaLights.penumbraPoints / areaLights.points,
+                    double(areaLights.shadowRays) / areaLights.points);
+
+    ImGui::Checkbox("Temporal Reprojection", &reprojection.enabled);
+    ImGui::SliderFloat("Refresh Fraction", &reprojection.refreshFraction, 0.0f, 1.0f);
+
+    // 辐照度缓存，参数变化后清空缓存并整帧重绘
+    bool irradianceChanged = false;
+    irradianceChanged |= ImGui::Checkbox("Irradiance Cache", &irradianceCache.enabled);
+    irradianceChanged |= ImGui::SliderFloat("Cache Accuracy", &irradianceCache.accuracy, 0.05f, 1.0f);
+    irradianceChanged |= ImGui::SliderInt("Hemisphere Strata", &irradianceCache.thetaSamples, 2, 32);
+    if (irradianceChanged) {
+        irradianceCache.clear(objects);
+        dirtyTracker.invalidateAll();
+    }
+    if (irradianceCache.enabled)
+        ImGui::Text("Irradiance records: %zu, lookups: %lld", irradianceCache.size(), (long long)irradianceCache.lookups);
+
+    // 环境光，没有读入贴图时使用程序化天空；参数变化后整帧重绘
+    bool environmentChanged = false;
+    environmentChanged |= ImGui::Checkbox("Environment Light", &environment.enabled);
+    environmentChanged |= ImGui::SliderFloat("Environment Intensity", &environment.intensity, 0.0f, 4.0f);
+    environmentChanged |= ImGui::SliderInt("Environment Samples", &environment.samples, 1, 256);
+    environmentChanged |= ImGui::Checkbox("Importance Sampling", &environment.importance);
+    environmentChanged |= ImGui::SliderFloat("Glossy Mip Level", &environment.glossyLevel, 0.0f, 8.0f);
+    if (environmentChanged) {
+        if (environment.enabled && !environment.loaded()) environment.makeSky();
+        if (backendIndex == BACKEND_GPU) selectBackend();
+        dirtyTracker.invalidateAll();
+    }
 
-    ImGui::SliderFloat3("Camera Position", &camera.position[0], -10.0f, 10.0f);
-    ImGui::SliderFloat3("Camera Direction", &camera.direction[0], -1.0f, 1.0f); // 方向调整
-    ImGui::SliderFloat("Camera Angle", &camera.angle, -180.0f, 180.0f);         // 角度调整
-    ImGui::SliderFloat("FOV", &camera.fov, 10.0f, 120.0f);
+    // 焦散光子图，参数变化后重新发射光子并整帧重绘
+    bool photonChanged = false;
+    photonChanged |= ImGui::Checkbox("Caustics (Photon Map)", &photonMap.enabled);
+    photonChanged |= ImGui::SliderInt("Photons", &photonMap.photonCount, 10000, 2000000);
+    photonChanged |= ImGui::SliderInt("Gather Count", &photonMap.gatherCount, 8, 512);
+    photonChanged |= ImGui::SliderFloat("Gather Radius", &photonMap.maxRadius, 0.01f, 1.0f);
+    photonChanged |= ImGui::SliderFloat("Photon Intensity", &photonMap.intensity, 1.0f, 500.0f);
+    if (photonChanged) {
+        photonsDirty = true;
+        dirtyTracker.invalidateAll();
+    }
+    if (photonMap.enabled) {
+        const PhotonStats& stats = photonMap.stats();
+        ImGui::Text("Photons: %zu stored / %zu emitted, build %.1f ms, gather %.1f ms",
+                    stats.stored, stats.emitted, stats.traceMs + stats.buildMs, stats.gatherMs);
+    }
+
+    if (clusterMesh || triangleMesh)
+        if (cpuHasAVX2()) ImGui::Checkbox("AVX2 BVH Traversal", &bvhUseAVX2);
+    if (triangleMesh) {
+        const BVHBuildStats& stats = triangleMesh->buildStats();
+        ImGui::Text("Mesh BVH (%s): %s %.1f ms, SAH cost %.2f, %zu nodes", bvhBuilderNames[meshBuilder],
+                    triangleMesh->loadedFromCache() ? "mapped" : "built", stats.ms, stats.sahCost, triangleMesh->binaryNodeCount());
+    }
+    if (clusterMesh) {
+        const ClusterStats& stats = clusterMesh->lastFrame();
+        int budgetMB = int(clusterMesh->residentBudget >> 20);
+        if (ImGui::SliderInt("Mesh Budget (MB)", &budgetMB, 1, 4096))
+            clusterMesh->residentBudget = size_t(budgetMB) << 20;
+        ImGui::Text("Mesh touched %zu KB, loaded %zu KB, resident %zu KB",
+                    stats.touchedBytes / 1024, stats.loadedBytes / 1024, stats.residentBytes / 1024);
+    }
+
+    // 物体参数，修改后只重绘受影响的 tile
+    for (size_t i = 0; i < spheres.size(); ++i) {
+        if (sphereControls(i)) {
+            dirtyTracker.touch(spheres[i]);
+            accelDirty = true;
+        }
+    }
+
+    // 动画序列：编辑首尾关键帧（姿态以欧拉角表示，之后转化为四元数）
+    CameraKeyframe& startKey = animationPath.camera.front();
+    CameraKeyframe& endKey = animationPath.camera.back();
+    static glm::vec3 startEuler = glm::eulerAngles(startKey.rotation);
+    static glm::vec3 endEuler = glm::eulerAngles(endKey.rotation);
+    ImGui::InputFloat3("Start Position", &startKey.position.x, "%.3f");
+    ImGui::InputFloat3("End Position", &endKey.position.x, "%.3f");
+    ImGui::InputFloat3("Begin Euler", &startEuler.x, "%.3f");
+    ImGui::InputFloat3("End Euler", &endEuler.x, "%.3f");
+    startKey.rotation = glm::quat(startEuler);
+    endKey.rotation = glm::quat(endEuler);
+    ImGui::InputFloat3("Start Light", &animationPath.light.front().position.x, "%.3f");
+    ImGui::InputFloat3("End Light", &animationPath.light.back().position.x, "%.3f");
+    ImGui::SliderInt("Frames", &animationFrames, 2, 600);
+    ImGui::SliderInt("Frames In Flight", &framesInFlight, 1, 16);
+    if (ImGui::Button("Render Sequence")) {
+        if (accelDirty) {
+            accels[accelIndex]->build(objects);
+            accelDirty = false;
+        }
+        float beg = glfwGetTime();
+        int written = renderSequence(animationPath, *accels[accelIndex], SCR_WIDTH, SCR_HEIGHT, animationFrames, 0, animationFrames, "frame", framesInFlight);
+        std::cout << "Sequence: " << written << " frames, " << glfwGetTime() - beg << " s\n";
+    }
 
     // bool startRender = false;
     // if (ImGui::Button("Start")) {
@@ -228,17 +323,402 @@ bool makeImGui(Light& light, Camera& camera) {
     return true; // startRender;
 }
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    width += 4 - width % 4;
+// 修改画面尺寸，之后整帧重绘
+void resizeFrame(int width, int height) {
     SCR_HEIGHT = height;
     SCR_WIDTH = width;
-    pixelBuffer.resize(width * height * 3);
+    // 清零而不是默认初始化：按时间预算或感兴趣区域推迟的 tile 在渲染之前也会显示（或推送给查看端）
+    pixelBuffer.assign(size_t(width) * height * 3, 0);
+    gbuffer.resize(width, height);
+    resolutionScaler.clear();
+    dirtyTracker.invalidateAll();
+    reprojection.invalidate();
+}
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    width += 4 - width % 4;
+    resizeFrame(width, height);
     glViewport(0, 0, width, height);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixelBuffer.data());
+    // 内部格式为 RGBA8，计算着色器可以把它绑定为 image2D 直接写入
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixelBuffer.data());
     std::cout << "width: " << width << ", height: " << height << std::endl;
 }
 
-int main() {
+// 渲染 tiles（DirtyTracker::collect 的结果）以及本帧的修改带来的其他重绘，返回画面是否更新。
+// 本地窗口和远程渲染机（--serve）共用
+bool renderChanges(std::vector<int>& tiles, const Camera& camera, const Light& light) {
+    // 间接光照、焦散和环境光的遮挡受所有物体和光源影响：场景变化时清空辐照度缓存、重建光子图，
+    // 开启其中之一时物体的修改也要整帧重绘（环境光的半球遮挡光线会把天空阴影投到任何物体上）
+    if (dirtyTracker.lastChange == CHANGE_OBJECTS || dirtyTracker.lastChange == CHANGE_ALL) {
+        irradianceCache.clear(objects);
+        photonsDirty = true;
+        if ((irradianceCache.enabled || photonMap.enabled || environment.enabled) && dirtyTracker.lastChange == CHANGE_OBJECTS) {
+            tiles.clear();
+            for (int i = 0; i < TileGrid(SCR_WIDTH, SCR_HEIGHT).count(); ++i) tiles.push_back(i);
+        }
+    }
+
+    // 设置了帧时限时，交互中按估计耗时降低采样密度（不再重投影），停止交互后以全分辨率重绘这些 tile
+    TileGrid grid(SCR_WIDTH, SCR_HEIGHT);
+    int level = 0;
+    if (resolutionScaler.deadlineMs > 0.0f && dirtyTracker.lastChange != CHANGE_NONE) {
+        tileScheduler.appendPending(tiles, grid);
+        level = resolutionScaler.choose(tilePixels(grid, tiles));
+    } else if (dirtyTracker.lastChange == CHANGE_NONE) {
+        resolutionScaler.appendCoarse(tiles, grid);
+    }
+
+    // 只有相机移动时先重投影上一帧，只追踪无法复用的像素
+    const std::vector<char>* mask = nullptr;
+    bool reprojected = false;
+    if (level > 0) {
+        resolutionScaler.buildMask(traceMask, grid, tiles, level);
+        mask = &traceMask;
+        settlePending = false;
+    } else if (dirtyTracker.lastChange == CHANGE_CAMERA &&
+        reprojection.reproject(camera, SCR_WIDTH, SCR_HEIGHT, pixelBuffer, gbuffer, traceMask) >= 0) {
+        tiles = tilesInMask(traceMask, SCR_WIDTH, SCR_HEIGHT);
+        mask = &traceMask;
+        reprojected = true;
+        settlePending = true;
+    } else if (dirtyTracker.lastChange == CHANGE_NONE && settlePending) {
+        // 相机停下后整帧重新追踪，消除复用带来的高光和反射误差
+        for (int i = 0; i < TileGrid(SCR_WIDTH, SCR_HEIGHT).count(); ++i) tiles.push_back(i);
+        settlePending = false;
+    } else if (dirtyTracker.lastChange != CHANGE_NONE) {
+        settlePending = false;
+    }
+
+    // 有时间预算时合并上一帧没有渲染完的 tile 并按优先级排序。
+    // 遗留的 tile 整个重新追踪，重投影时在 mask 中补上它们的像素；降低采样密度的帧不受预算限制
+    bool budgeted = renderSettings.frameBudgetMs > 0.0f && level == 0;
+    if (budgeted) {
+        if (mask) {
+            for (int t : tileScheduler.pending()) {
+                int x0, y0, x1, y1;
+                grid.bounds(t, x0, y0, x1, y1);
+                for (int y = y0; y < y1; ++y)
+                    std::fill(traceMask.begin() + y * SCR_WIDTH + x0, traceMask.begin() + y * SCR_WIDTH + x1, 1);
+            }
+        }
+        tiles = tileScheduler.order(tiles, grid);
+    } else {
+        tileScheduler.clear();
+    }
+
+    if (tiles.empty() && !reprojected) return false;
+
+    // 渲染
+    auto beg = std::chrono::steady_clock::now();
+    if (accelDirty) {
+        accels[accelIndex]->build(objects);
+        accelDirty = false;
+    }
+    bool photonsBuilt = false;
+    if (photonMap.enabled && photonsDirty) {
+        photonMap.build(objects, *accels[accelIndex], light, planWorkers(renderSettings.placement, renderSettings.threads));
+        photonsDirty = false;
+        photonsBuilt = true;
+    }
+    photonMap.beginFrame();
+    const TileBins* bins = buildTileBins(tileBins, objects, camera, SCR_WIDTH, SCR_HEIGHT);
+    std::vector<int> unfinished;
+    areaLights.resetStats();
+    auto traceBeg = std::chrono::steady_clock::now();
+    renderScene(pixelBuffer, SCR_WIDTH, SCR_HEIGHT, camera, light, *accels[accelIndex], tiles, &gbuffer, mask, bins,
+                budgeted ? &unfinished : nullptr);
+    double traceMs = elapsedMs(traceBeg);
+    if (budgeted) tileScheduler.finish(tiles, unfinished, pixelBuffer, grid);
+    resolutionScaler.record(traceMs, tracedPixels(grid, tiles, unfinished, mask));
+    resolutionScaler.rendered(grid, tiles, unfinished, level);
+    if (level > 0) {
+        // 稀疏采样的结果不能作为重投影的来源
+        resolutionScaler.upsample(pixelBuffer, grid, tiles, level);
+        reprojection.invalidate();
+    } else {
+        reprojection.store(pixelBuffer, gbuffer, camera);
+    }
+    if (photonMap.enabled) {
+        const PhotonStats& stats = photonMap.endFrame();
+        std::cout << "Photons: " << stats.stored << " stored / " << stats.emitted << " emitted";
+        if (photonsBuilt) std::cout << ", trace: " << stats.traceMs << " ms, build: " << stats.buildMs << " ms";
+        std::cout << ", gathers: " << stats.gathers << ", gather: " << stats.gatherMs << " ms\n";
+    }
+    if (clusterMesh) {
+        const ClusterStats& stats = clusterMesh->endFrame();
+        std::cout << "Mesh touched: " << stats.touchedBytes / 1024 << " KB, loaded: " << stats.loadedBytes / 1024
+                  << " KB, evicted: " << stats.evictedBytes / 1024 << " KB\n";
+    }
+    std::cout << "Render time: " << elapsedMs(beg) / 1000.0 << ", tiles: " << tiles.size() - unfinished.size()
+              << "/" << grid.count() << (reprojected ? " (reprojected)" : "");
+    if (level > 0) std::cout << ", sampling: " << ResolutionScaler::levelName(level);
+    if (!unfinished.empty()) std::cout << ", pending: " << unfinished.size();
+    std::cout << "\n";
+    return true;
+}
+
+// GPU 后端的一帧：物体变化后重新上传，有任何需要重绘的 tile 时整帧在 GPU 上追踪，结果直接写入显示纹理
+void renderGpu(const std::vector<int>& tiles, const Camera& camera, const Light& light) {
+    if (gpuSceneDirty || dirtyTracker.lastChange == CHANGE_OBJECTS || dirtyTracker.lastChange == CHANGE_ALL) {
+        gpuTracer.upload(objects);
+        gpuSceneDirty = false;
+    }
+    if (tiles.empty()) return;
+
+    auto beg = std::chrono::steady_clock::now();
+    gpuTracer.render(texture, SCR_WIDTH, SCR_HEIGHT, camera, light);
+    glFinish(); // 等待 GPU 完成，只为输出准确的耗时
+    std::cout << "Render time (GPU): " << elapsedMs(beg) / 1000.0 << "\n";
+}
+
+// 把 OBJ 网格转换为 --mesh 使用的簇文件后退出。转换在内存中进行，渲染时只映射生成的文件
+int convertMesh(const std::string& input, const std::string& output) {
+    auto beg = std::chrono::steady_clock::now();
+    std::vector<Triangle> triangles;
+    if (!readObjTriangles(input, triangles) || triangles.empty()) {
+        std::cerr << "failed to read triangles from " << input << std::endl;
+        return -1;
+    }
+    double readMs = elapsedMs(beg);
+    beg = std::chrono::steady_clock::now();
+    if (!writeClusterFile(output, triangles, meshBuilder)) {
+        std::cerr << "failed to write " << output << std::endl;
+        return -1;
+    }
+    std::cout << "Converted " << triangles.size() << " triangles (" << bvhBuilderNames[meshBuilder] << " bvh): read " << readMs << " ms, clusters "
+              << elapsedMs(beg) << " ms -> " << output << std::endl;
+    return 0;
+}
+
+// 远程渲染机：不创建窗口，等待查看端连接，按查看端发来的视图渲染并推送有变化的 tile。
+// 同一时间只服务一个查看端，断开后等待下一个
+int serveRemote(int port) {
+    if (!netInit()) return -1;
+    SocketHandle listener = listenOn(port);
+    if (listener == INVALID_SOCKET_HANDLE) {
+        std::cerr << "failed to listen on port " << port << std::endl;
+        return -1;
+    }
+    std::cout << "Serving frames on port " << port << std::endl;
+
+    std::vector<unsigned char> payload;
+    while (true) {
+        StreamConnection connection(acceptClient(listener));
+        if (!connection.open()) continue;
+        std::cout << "Viewer connected" << std::endl;
+
+        TileDeltaEncoder encoder;
+        uint32_t frame = 0;
+        bool haveView = false;
+        Light light;
+        Camera camera;
+        while (connection.open()) {
+            // 处理查看端的输入；没有输入时最多等待 100 ms，相机停下后的整帧重绘在超时后进行
+            uint32_t type;
+            for (int wait = 100; connection.poll(wait) && connection.receive(type, payload); wait = 0) {
+                if (type == MESSAGE_VIEW && payload.size() == sizeof(ViewState)) {
+                    ViewState view;
+                    std::memcpy(&view, payload.data(), sizeof(view));
+                    if (!validStreamSize(view.width, view.height)) continue;
+                    camera = view.camera;
+                    light = view.light;
+                    if (!haveView || view.width != SCR_WIDTH || view.height != SCR_HEIGHT) {
+                        // 没有窗口时画面缓冲区只在这里分配；查看端缩放过窗口时画面内容已不可信，
+                        // 下一帧作为关键帧整帧发送
+                        resizeFrame(view.width, view.height);
+                        encoder.reset();
+                    }
+                    if (!haveView) dirtyTracker.invalidateAll();
+                    haveView = true;
+                } else if (type == MESSAGE_SPHERE && payload.size() == sizeof(SphereEdit)) {
+                    SphereEdit edit;
+                    std::memcpy(&edit, payload.data(), sizeof(edit));
+                    if (edit.index < 0 || edit.index >= int(spheres.size())) continue;
+                    Sphere* sphere = spheres[edit.index];
+                    sphere->center = toAligned(edit.center);
+                    sphere->radius = edit.radius;
+                    sphere->color = edit.color;
+                    sphere->reflectivity = edit.reflectivity;
+                    sphere->material = MaterialType(edit.material);
+                    dirtyTracker.touch(sphere);
+                    accelDirty = true;
+                }
+            }
+            if (!connection.open() || !haveView) continue;
+
+            std::vector<int> tiles = dirtyTracker.collect(objects, camera, light, SCR_WIDTH, SCR_HEIGHT);
+            if (!renderChanges(tiles, camera, light)) continue;
+            int sent = encoder.encode(pixelBuffer, SCR_WIDTH, SCR_HEIGHT, frame++, payload);
+            if (!connection.send(MESSAGE_FRAME, payload.data(), payload.size())) break;
+            std::cout << "Sent " << sent << "/" << TileGrid(SCR_WIDTH, SCR_HEIGHT).count() << " tiles, "
+                      << payload.size() / 1024 << " KB (" << std::fixed << std::setprecision(1)
+                      << 100.0 * encoder.encodedBytes / encoder.rawBytes << "% of raw so far)" << std::defaultfloat << "\n";
+        }
+        std::cout << "Viewer disconnected" << std::endl;
+    }
+}
+
+// 远程查看端的控制面板：只有视图和球体参数，其余渲染选项由渲染机的命令行决定
+void makeRemoteImGui(Light& light, Camera& camera, std::vector<size_t>& editedSpheres) {
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+    ImGui::Begin("Remote View");
+    viewControls(light, camera);
+    for (size_t i = 0; i < spheres.size(); ++i)
+        if (sphereControls(i)) editedSpheres.push_back(i);
+    ImGui::End();
+}
+
+// 远程查看端的一帧：把面板上的修改发给渲染机，再应用已经收到的画面，返回画面是否更新
+bool updateRemote(StreamConnection& connection, Light& light, Camera& camera, ViewState& lastView) {
+    std::vector<size_t> editedSpheres;
+    makeRemoteImGui(light, camera, editedSpheres);
+    if (!connection.open()) return false;
+
+    ViewState view = {camera, light, SCR_WIDTH, SCR_HEIGHT};
+    if (std::memcmp(&view, &lastView, sizeof(view)) != 0) {
+        connection.send(MESSAGE_VIEW, &view, sizeof(view));
+        lastView = view;
+    }
+    for (size_t i : editedSpheres) {
+        const Sphere* sphere = spheres[i];
+        SphereEdit edit = {int32_t(i), toVec3(sphere->center), sphere->radius, sphere->color, sphere->reflectivity, int32_t(sphere->material)};
+        connection.send(MESSAGE_SPHERE, &edit, sizeof(edit));
+    }
+
+    bool updated = false;
+    uint32_t type;
+    std::vector<unsigned char> payload;
+    while (connection.poll(0) && connection.receive(type, payload))
+        if (type == MESSAGE_FRAME) updated |= applyFrame(payload, pixelBuffer, SCR_WIDTH, SCR_HEIGHT);
+    if (!connection.open()) std::cerr << "Render server disconnected" << std::endl;
+    return updated;
+}
+
+int main(int argc, char** argv) {
+    // 命令行参数
+    std::string benchName;
+    std::string animationPrefix;
+    int firstFrame = 0, lastFrame = -1;
+    int servePort = -1;
+    std::string connectHost;
+    int connectPort = STREAM_PORT;
+    std::string convertInput, convertOutput, objPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bench" && i + 1 < argc) {
+            benchName = argv[++i];
+        } else if (arg == "--accel" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (size_t k = 0; k < accels.size(); ++k) {
+                std::string accelName = accels[k]->name();
+                std::transform(accelName.begin(), accelName.end(), accelName.begin(), ::tolower);
+                if (name == accelName) accelIndex = int(k);
+            }
+        } else if (arg == "--mesh" && i + 1 < argc) {
+            clusterMesh.reset(new ClusterMesh(glm::vec3(0.7f), 0.0f));
+            if (!clusterMesh->open(argv[++i])) {
+                std::cerr << "failed to open mesh: " << argv[i] << std::endl;
+                return -1;
+            }
+            objects.push_back(clusterMesh.get());
+        } else if (arg == "--obj" && i + 1 < argc) {
+            objPath = argv[++i];
+        } else if (arg == "--builder" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (int k = 0; k < BVH_BUILD_COUNT; ++k)
+                if (name == bvhBuilderNames[k]) meshBuilder = BVHBuilder(k);
+        } else if (arg == "--convert" && i + 2 < argc) {
+            convertInput = argv[++i];
+            convertOutput = argv[++i];
+        } else if (arg == "--env" && i + 1 < argc) {
+            if (!environment.load(argv[++i])) return -1;
+            environment.enabled = true;
+        } else if (arg == "--animate" && i + 2 < argc) {
+            animationFrames = std::max(1, std::atoi(argv[++i]));
+            animationPrefix = argv[++i];
+        } else if (arg == "--frame-range" && i + 2 < argc) {
+            firstFrame = std::atoi(argv[++i]);
+            lastFrame = std::atoi(argv[++i]);
+        } else if (arg == "--frames-in-flight" && i + 1 < argc) {
+            framesInFlight = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--placement" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (int k = 0; k < PLACEMENT_COUNT; ++k)
+                if (name == placementNames[k]) renderSettings.placement = PlacementPolicy(k);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            renderSettings.threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--budget" && i + 1 < argc) {
+            renderSettings.frameBudgetMs = std::max(0.0f, float(std::atof(argv[++i])));
+        } else if (arg == "--deadline" && i + 1 < argc) {
+            resolutionScaler.deadlineMs = std::max(0.0f, float(std::atof(argv[++i])));
+        } else if (arg == "--priority" && i + 1 < argc) {
+            std::string name = argv[++i];
+            for (int k = 0; k < PRIORITY_COUNT; ++k)
+                if (name == priorityNames[k]) tileScheduler.priority = TilePriority(k);
+        } else if (arg == "--backend" && i + 1 < argc) {
+            backendIndex = std::string(argv[++i]) == "gpu" ? BACKEND_GPU : BACKEND_CPU;
+        } else if (arg == "--serve") {
+            servePort = i + 1 < argc && argv[i + 1][0] != '-' ? std::atoi(argv[++i]) : STREAM_PORT;
+        } else if (arg == "--connect" && i + 1 < argc) {
+            connectHost = argv[++i];
+            size_t colon = connectHost.rfind(':');
+            if (colon != std::string::npos) {
+                connectPort = std::atoi(connectHost.c_str() + colon + 1);
+                connectHost.resize(colon);
+            }
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--backend cpu|gpu] [--accel linear|grid] [--placement none|physical|smt|numa] [--threads n]"
+                      << " [--budget ms] [--priority scanline|cursor|center|variance] [--deadline ms]"
+                      << " [--mesh file] [--obj file.obj] [--convert in.obj out.clusters] [--builder median|sah|lbvh] [--env file.hdr] [--serve [port] | --connect host[:port]]"
+                      << " [--animate frames prefix [--frame-range first last] [--frames-in-flight n]]"
+                      << " [--bench " << benchNames() << "]" << std::endl;
+            return -1;
+        }
+    }
+    if (!convertInput.empty())
+        return convertMesh(convertInput, convertOutput);
+    // 常驻内存的网格，建好的 BVH 缓存在 <file>.bvh，再次打开同一网格时直接映射
+    if (!objPath.empty()) {
+        std::vector<Triangle> triangles;
+        if (!readObjTriangles(objPath, triangles) || triangles.empty()) {
+            std::cerr << "failed to read mesh: " << objPath << std::endl;
+            return -1;
+        }
+        triangleMesh.reset(new TriangleMesh(triangles, glm::vec3(0.7f), 0.0f, meshBuilder, objPath + ".bvh"));
+        const BVHBuildStats& stats = triangleMesh->buildStats();
+        std::cout << "Mesh: " << triangles.size() << " triangles, " << bvhBuilderNames[meshBuilder] << " bvh "
+                  << (triangleMesh->loadedFromCache() ? "mapped from cache" : "built") << " in " << stats.ms
+                  << " ms, SAH cost " << stats.sahCost << std::endl;
+        objects.push_back(triangleMesh.get());
+    }
+    if (!benchName.empty())
+        return runBenchmark(benchName, objects, 640, 480);
+    // 不打开窗口，渲染动画序列后退出；多个进程可以用 --frame-range 分担同一条路径
+    if (!animationPrefix.empty()) {
+        accels[accelIndex]->build(objects);
+        if (lastFrame < 0) lastFrame = animationFrames;
+        return renderSequence(animationPath, *accels[accelIndex], SCR_WIDTH, SCR_HEIGHT, animationFrames,
+                              firstFrame, lastFrame, animationPrefix, framesInFlight) < 0 ? -1 : 0;
+    }
+    // 无窗口的远程渲染机
+    if (servePort >= 0)
+        return serveRemote(servePort);
+    // 远程查看端：画面来自渲染机，本地不追踪光线
+    bool remoteViewer = !connectHost.empty();
+    StreamConnection remote;
+    ViewState lastView;
+    std::memset(static_cast<void*>(&lastView), 0, sizeof(lastView)); // 第一帧必然与之不同，总会发送视图
+    if (remoteViewer) {
+        if (netInit()) remote.attach(connectTo(connectHost, connectPort));
+        if (!remote.open()) {
+            std::cerr << "failed to connect to " << connectHost << ":" << connectPort << std::endl;
+            return -1;
+        }
+    }
+
     // 初始化GLFW
     glfwInit();
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Ray Tracing", nullptr, nullptr);
@@ -263,6 +743,7 @@ int main() {
     initQuad(VAO, VBO);
     initTexture(texture, pixelBuffer, SCR_WIDTH, SCR_HEIGHT);
     framebuffer_size_callback(window, SCR_WIDTH, SCR_HEIGHT);
+    if (backendIndex == BACKEND_GPU) selectBackend();
 
     // 初始化 Dear ImGui
     initImGui(window);
@@ -280,17 +761,44 @@ int main() {
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
-        if (makeImGui(light, camera)) {
-            // 渲染
-            float beg = glfwGetTime();
-            renderScene(pixelBuffer, SCR_WIDTH, SCR_HEIGHT, camera, light);
-            std::cout << "Render time: " << glfwGetTime() - beg << "\n";
+        bool updated;
+        if (remoteViewer) {
+            updated = updateRemote(remote, light, camera, lastView);
+        } else if (backendIndex == BACKEND_GPU) {
+            std::vector<int> tiles;
+            if (makeImGui(light, camera))
+                tiles = dirtyTracker.collect(objects, camera, light, SCR_WIDTH, SCR_HEIGHT);
+            if (light.shape != LIGHT_POINT) {
+                // 计算着色器只实现了点光源，下一帧起由 CPU 整帧重绘
+                std::cerr << "GPU backend supports point lights only, using CPU" << std::endl;
+                backendIndex = BACKEND_CPU;
+                selectBackend();
+            } else {
+                renderGpu(tiles, camera, light);
+            }
+            updated = false; // 纹理已由计算着色器写入
+        } else {
+            // 光标位置决定 tile 的优先级（纹理第 0 行在画面底部）
+            double cursorX, cursorY;
+            int windowWidth, windowHeight;
+            glfwGetCursorPos(window, &cursorX, &cursorY);
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            if (windowWidth > 0 && windowHeight > 0)
+                tileScheduler.focus = glm::vec2(cursorX / windowWidth * SCR_WIDTH, (1.0 - cursorY / windowHeight) * SCR_HEIGHT);
+
+            std::vector<int> tiles;
+            if (makeImGui(light, camera))
+                tiles = dirtyTracker.collect(objects, camera, light, SCR_WIDTH, SCR_HEIGHT);
+            updated = renderChanges(tiles, camera, light);
+        }
 
+        if (updated) {
             // 更新纹理数据
             glBindTexture(GL_TEXTURE_2D, texture);
             glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixelBuffer.data());
         }
 
+
         // 绘制纹理到屏幕
         glClear(GL_COLOR_BUFFER_BIT);
         ourShader.use();
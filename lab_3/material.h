@@ -0,0 +1,137 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+#include "accel.h"
+#include "irradiance.h"
+#include "photon.h"
+#include "envmap.h"
+#include "arealight.h"
+
+#include <vector>
+
+// 整数次幂，编译期展开为若干次乘法（平方-乘法）
+template <int N>
+inline float powi(float x) {
+    if constexpr (N == 0) return 1.0f;
+    else if constexpr (N % 2 == 0) {
+        float h = powi<N / 2>(x);
+        return h * h;
+    } else return x * powi<N - 1>(x);
+}
+
+// 波前中的一条光线，weight 为沿路径累乘的反射率，pixel 为结果累加到的位置，
+// lod 为光线未命中时读取的环境贴图 mip 层
+struct PathRay {
+    Ray ray;
+    vec3a weight;
+    int pixel;
+    float lod = 0.0f;
+};
+
+// 一次命中的着色输入
+struct HitRecord {
+    vec3a point;
+    vec3a normal;
+    vec3a direction;        // 入射光线方向
+    vec3a weight;
+    const Object* object;
+    int pixel;
+    float lod = 0.0f;       // 入射光线的 lod
+};
+
+// 着色核：Diffuse / Exponent / Reflect 都是编译期常量，不同材质的分支在编译期被消除。
+// 对一组同材质的命中逐个着色，直接光照（以及开启时的间接漫反射和焦散）累加到 colors[pixel]，反射光线放入下一波
+template <bool Diffuse, int Exponent, bool Reflect>
+struct ShadingKernel {
+    static void shade(const HitRecord* hits, int count, const Accel& accel, const Light& light,
+                      vec3a* colors, std::vector<PathRay>& next) {
+        vec3a lightPosition = toAligned(light.position);
+        vec3a lightColor = toAligned(light.color);
+        for (int i = 0; i < count; ++i) {
+            const HitRecord& h = hits[i];
+
+            if constexpr (Diffuse || Exponent > 0) {
+                // 来自 lightDir 方向、没有遮挡时的直接光照
+                auto direct = [&](const vec3a& lightDir) {
+                    vec3a result(0.0f);
+                    if constexpr (Diffuse) {
+                        // 计算漫反射
+                        float diff = glm::max(glm::dot(h.normal, lightDir), 0.0f);
+                        result += diff * toAligned(h.object->color) * lightColor;
+                    }
+                    if constexpr (Exponent > 0) {
+                        // 计算镜面反射
+                        vec3a viewDir = glm::normalize(-h.direction);
+                        vec3a reflectDir = glm::reflect(-lightDir, h.normal);
+                        result += powi<Exponent>(glm::max(glm::dot(viewDir, reflectDir), 0.0f)) * lightColor;
+                    }
+                    return result;
+                };
+
+                if (light.shape == LIGHT_POINT) {
+                    vec3a toLight = lightPosition - h.point;
+                    vec3a lightDir = glm::normalize(toLight);
+
+                    // 检测阴影：检查光源到交点之间是否有阻挡
+                    Ray shadowRay;
+                    shadowRay.origin = h.point + h.normal * 0.001f; // 偏移以避免浮点精度问题
+                    shadowRay.direction = lightDir;
+                    tracedRays++;
+                    if (!accel.occluded(shadowRay, glm::length(toLight)))
+                        colors[h.pixel] += h.weight * direct(lightDir);
+                } else {
+                    // 面光源：分层采样光源表面，半影处自适应加密
+                    colors[h.pixel] += h.weight * areaLights.illuminate(light, h.point, h.normal, accel, direct);
+                }
+            }
+
+            if constexpr (Diffuse) {
+                if (environment.enabled) {
+                    // 环境光：BRDF 为 color / π，辐照度按环境贴图的亮度重要性采样
+                    glm::vec3 sky = environment.irradiance(toVec3(h.point), toVec3(h.normal), accel);
+                    colors[h.pixel] += h.weight * toAligned(h.object->color * sky * glm::one_over_pi<float>());
+                }
+                if (irradianceCache.enabled) {
+                    // 间接漫反射：BRDF 为 color / π，辐照度由缓存插值
+                    glm::vec3 indirect = irradianceCache.irradiance(toVec3(h.point), toVec3(h.normal), accel, light);
+                    colors[h.pixel] += h.weight * toAligned(h.object->color * indirect * glm::one_over_pi<float>());
+                }
+                if (photonMap.enabled) {
+                    // 焦散：光子图的密度估计
+                    glm::vec3 caustic = photonMap.irradiance(toVec3(h.point), toVec3(h.normal));
+                    colors[h.pixel] += h.weight * toAligned(h.object->color * caustic * glm::one_over_pi<float>());
+                }
+            }
+
+            if constexpr (Reflect) {
+                PathRay reflected;
+                reflected.ray.origin = h.point + h.normal * 0.001f; // 避免浮点精度问题
+                reflected.ray.direction = glm::reflect(h.direction, h.normal);
+                reflected.weight = h.weight * h.object->reflectivity;
+                reflected.pixel = h.pixel;
+                // 光泽表面的反射光线未命中时读取模糊的 mip 层，镜面沿用入射光线的层
+                reflected.lod = Exponent > 0 ? std::max(h.lod, environment.glossyLevel) : h.lod;
+                next.push_back(reflected);
+            }
+        }
+    }
+};
+
+typedef ShadingKernel<true, 0, false>  LambertKernel;
+typedef ShadingKernel<true, 32, false> PhongKernel;
+typedef ShadingKernel<false, 0, true>  MirrorKernel;
+typedef ShadingKernel<true, 32, true>  GlossyKernel;
+
+typedef void (*ShadeFunc)(const HitRecord*, int, const Accel&, const Light&, vec3a*, std::vector<PathRay>&);
+
+// 按 MaterialType 索引的着色核
+const ShadeFunc shadeKernels[MATERIAL_COUNT] = {
+    &LambertKernel::shade,
+    &PhongKernel::shade,
+    &MirrorKernel::shade,
+    &GlossyKernel::shade,
+};
+#endif
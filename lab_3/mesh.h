@@ -0,0 +1,614 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+#include "accel.h"
+#include "bvh.h"
+
+#include <vector>
+#include <list>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <type_traits>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 只读的文件内存映射
+class MappedFile {
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // randomAccess 为 false 时保留内核的顺序预读，适合一次读完整个文件
+    bool open(const std::string& path, bool randomAccess = true) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) { close(); return false; }
+        base = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!base) { close(); return false; }
+        length = size_t(fileSize.QuadPart);
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { close(); return false; }
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) { close(); return false; }
+        base = static_cast<const char*>(p);
+        length = size_t(st.st_size);
+        // 光线访问的簇没有顺序可言，关闭内核的顺序预读，改为由 willNeed() 按簇预取
+        madvise(p, length, randomAccess ? MADV_RANDOM : MADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base) munmap(const_cast<char*>(base), length);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+    // 提示内核异步读入 [offset, offset + bytes)
+    void willNeed(size_t offset, size_t bytes) const {
+#ifndef _WIN32
+        madvise(const_cast<char*>(base) + offset, bytes, MADV_WILLNEED);
+#endif
+    }
+
+    // 提示内核可以丢弃这段页面，下次访问时从文件重新读入。
+    // Windows 上文件映射的页面由系统的工作集管理回收，这里不做处理
+    void dontNeed(size_t offset, size_t bytes) const {
+#ifndef _WIN32
+        madvise(const_cast<char*>(base) + offset, bytes, MADV_DONTNEED);
+#endif
+    }
+
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// BVH 缓存文件布局：文件头 | 二叉节点 | order | 8 叉节点 | primitives。
+// key 为三角形数据与构建设置的哈希，几何、构建方式或节点布局变化后缓存即失效，打开网格时自动重建
+const uint32_t BVH_CACHE_MAGIC = 0x48435642; // "BVCH"
+const uint32_t BVH_CACHE_VERSION = 1;
+
+struct BVHCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t triangleCount;
+    uint32_t nodeBytes;         // sizeof(BVHNode)，结构体布局变化时缓存失效
+    uint32_t wideNodeBytes;     // sizeof(BVH8Node)
+    uint64_t nodeCount;
+    uint64_t wideNodeCount;
+    uint64_t primitiveCount;
+    float sahCost;
+    uint32_t padding;
+};
+
+// 按 8 字节一组混合的 64 位哈希，用于判断几何是否变化（不要求抗碰撞）
+inline uint64_t hashBytes(const void* data, size_t bytes, uint64_t h = 0x9e3779b97f4a7c15ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    auto mix = [&](uint64_t w) {
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    };
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        mix(w);
+    }
+    uint64_t tail = 0;
+    if (i < bytes) std::memcpy(&tail, p + i, bytes - i);
+    mix(tail ^ (uint64_t(bytes) << 56));
+    return h;
+}
+
+// 缓存的键：三角形数据、构建方式和叶子大小
+inline uint64_t meshCacheKey(const std::vector<Triangle>& triangles, BVHBuilder builder, int maxLeafSize) {
+    uint64_t h = hashBytes(triangles.data(), triangles.size() * sizeof(Triangle));
+    uint32_t settings[3] = {uint32_t(builder), uint32_t(maxLeafSize), BVH_CACHE_VERSION};
+    return hashBytes(settings, sizeof(settings), h);
+}
+
+// 常驻内存的三角形网格，可以选择二叉 BVH 或 8 叉压缩 BVH 求交。
+// 三角形只保存一份，按当前所用 BVH 的叶子顺序排列，求交时顺序读取
+class TriangleMesh : public Object {
+public:
+    // cachePath 非空时先尝试映射该文件，吻合时求交直接使用映射中的 BVH，不再复制；
+    // 文件不存在或与当前几何、设置不符时重新构建并写回，下次打开同一网格只需映射文件
+    TriangleMesh(const std::vector<Triangle>& triangles, const glm::vec3& color, float reflectivity,
+                 BVHBuilder builder = BVH_BUILD_MEDIAN, const std::string& cachePath = "")
+        : Object(color, reflectivity) {
+        uint64_t key = cachePath.empty() ? 0 : meshCacheKey(triangles, builder, 3);
+        cached = !cachePath.empty() && loadCache(cachePath, key, triangles.size());
+        if (cached) {
+            box.min = binaryNodes[0].min;
+            box.max = binaryNodes[0].max;
+        } else {
+            std::vector<AABB> boxes(triangles.size());
+            for (size_t i = 0; i < triangles.size(); ++i) {
+                boxes[i].expand(triangles[i].v0);
+                boxes[i].expand(triangles[i].v1);
+                boxes[i].expand(triangles[i].v2);
+                box.expand(boxes[i]);
+            }
+            binary.build(boxes, 3, builder);
+            wideBVH.build(binary);
+            if (!cachePath.empty() && !saveCache(cachePath, key, triangles.size()))
+                std::cerr << "failed to write bvh cache " << cachePath << std::endl;
+            binaryNodes = binary.nodes.data();
+            binaryOrder = binary.order.data();
+            wideNodes = wideBVH.nodes.data();
+            widePrimitives = wideBVH.primitives.data();
+            binaryNodeTotal = binary.nodes.size();
+            wideNodeTotal = wideBVH.nodes.size();
+        }
+        packed.resize(triangles.size());
+        for (size_t i = 0; i < triangles.size(); ++i) packed[i] = packTriangle(triangles[widePrimitives[i]]);
+    }
+
+    // 切换求交所用的 BVH（默认 8 叉），把三角形重排为另一种 BVH 的叶子顺序。
+    // 不能在渲染过程中调用
+    void setWide(bool value) {
+        if (value == wide) return;
+        const uint32_t* from = wide ? widePrimitives : binaryOrder;
+        const uint32_t* to = value ? widePrimitives : binaryOrder;
+        std::vector<uint32_t> slot(packed.size());
+        for (size_t i = 0; i < packed.size(); ++i) slot[from[i]] = uint32_t(i);
+        std::vector<PackedTriangle> reordered(packed.size());
+        for (size_t i = 0; i < packed.size(); ++i) reordered[i] = packed[slot[to[i]]];
+        packed.swap(reordered);
+        wide = value;
+    }
+    bool isWide() const { return wide; }
+
+    size_t triangleCount() const { return packed.size(); }
+    size_t binaryNodeBytes() const { return binaryNodeTotal * sizeof(BVHNode); }
+    size_t wideNodeBytes() const { return wideNodeTotal * sizeof(BVH8Node); }
+    size_t binaryNodeCount() const { return binaryNodeTotal; }
+    const BVHBuildStats& buildStats() const { return binary.stats; }
+    bool loadedFromCache() const { return cached; }
+
+    bool intersect(const Ray& ray, float& t, vec3a& normal) const override {
+        float closest = std::numeric_limits<float>::max();
+        glm::vec3 n;
+        auto leaf = [&](uint32_t first, uint32_t count) {
+            for (uint32_t i = first; i < first + count; ++i) intersectTriangle(packed[i], ray, closest, n);
+            return closest;
+        };
+        if (wide) BVH8::traverse(wideNodes, wideNodeTotal, ray, closest, leaf);
+        else BinaryBVH::traverse(binaryNodes, binaryNodeTotal, ray, closest, leaf);
+        if (closest == std::numeric_limits<float>::max()) return false;
+        t = closest;
+        normal = toAligned(n);
+        return true;
+    }
+
+    BoundingSphere bounds() const override {
+        return {(box.min + box.max) * 0.5f, 0.5f * glm::length(box.max - box.min)};
+    }
+
+    void convexHull(std::vector<glm::vec3>& points) const override {
+        for (int i = 0; i < 8; ++i)
+            points.push_back(glm::vec3(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z));
+    }
+
+private:
+    AABB box;
+    BinaryBVH binary;   // 重新构建时的 BVH；从缓存打开时为空，只保留统计
+    BVH8 wideBVH;
+    MappedFile cacheFile;
+    // 求交使用的节点和图元顺序：指向 binary、wideBVH 中的数组，或者指向映射的缓存文件
+    const BVHNode* binaryNodes = nullptr;
+    const uint32_t* binaryOrder = nullptr;
+    const BVH8Node* wideNodes = nullptr;
+    const uint32_t* widePrimitives = nullptr;
+    size_t binaryNodeTotal = 0, wideNodeTotal = 0;
+    std::vector<PackedTriangle> packed; // 按 wide 所选 BVH 的叶子顺序排列
+    bool wide = true;                   // 使用 8 叉压缩 BVH
+    bool cached = false;
+
+    // 映射缓存文件并校验文件头，全部吻合时各段指针直接指向映射（文件在网格的生命期内保持映射）；
+    // stats.ms 记为打开耗时
+    bool loadCache(const std::string& path, uint64_t key, size_t triangleCount) {
+        auto beg = std::chrono::steady_clock::now();
+        if (!cacheFile.open(path) || cacheFile.size() < sizeof(BVHCacheHeader)) return false;
+        BVHCacheHeader header;
+        std::memcpy(&header, cacheFile.data(), sizeof(header));
+        size_t bytes = sizeof(header) + header.nodeCount * sizeof(BVHNode) + triangleCount * sizeof(uint32_t) +
+                       header.wideNodeCount * sizeof(BVH8Node) + header.primitiveCount * sizeof(uint32_t);
+        if (header.magic != BVH_CACHE_MAGIC || header.version != BVH_CACHE_VERSION || header.key != key ||
+            header.triangleCount != triangleCount || header.nodeBytes != sizeof(BVHNode) ||
+            header.wideNodeBytes != sizeof(BVH8Node) || header.nodeCount == 0 || header.primitiveCount != triangleCount ||
+            cacheFile.size() != bytes) {
+            cacheFile.close();
+            return false;
+        }
+
+        // 各段按文件中的顺序排列，映射起点按页对齐，偏移不满足节点的对齐要求时放弃映射
+        const char* p = cacheFile.data() + sizeof(header);
+        bool aligned = true;
+        auto section = [&](auto*& pointer, size_t count) {
+            using T = std::remove_const_t<std::remove_reference_t<decltype(*pointer)>>;
+            aligned &= reinterpret_cast<uintptr_t>(p) % alignof(T) == 0;
+            pointer = reinterpret_cast<const T*>(p);
+            p += count * sizeof(T);
+        };
+        section(binaryNodes, header.nodeCount);
+        section(binaryOrder, triangleCount);
+        section(wideNodes, header.wideNodeCount);
+        section(widePrimitives, header.primitiveCount);
+        if (!aligned) {
+            cacheFile.close();
+            return false;
+        }
+        binaryNodeTotal = header.nodeCount;
+        wideNodeTotal = header.wideNodeCount;
+        binary.stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+        binary.stats.sahCost = header.sahCost;
+        return true;
+    }
+
+    // 先写临时文件再改名，写到一半失败或其他进程同时打开时不会留下半个缓存
+    bool saveCache(const std::string& path, uint64_t key, size_t triangleCount) const {
+        BVHCacheHeader header = {};
+        header.magic = BVH_CACHE_MAGIC;
+        header.version = BVH_CACHE_VERSION;
+        header.key = key;
+        header.triangleCount = triangleCount;
+        header.nodeBytes = sizeof(BVHNode);
+        header.wideNodeBytes = sizeof(BVH8Node);
+        header.nodeCount = binary.nodes.size();
+        header.wideNodeCount = wideBVH.nodes.size();
+        header.primitiveCount = wideBVH.primitives.size();
+        header.sahCost = binary.stats.sahCost;
+
+        std::string temp = path + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(binary.nodes.data()), binary.nodes.size() * sizeof(BVHNode));
+            out.write(reinterpret_cast<const char*>(binary.order.data()), binary.order.size() * sizeof(uint32_t));
+            out.write(reinterpret_cast<const char*>(wideBVH.nodes.data()), wideBVH.nodes.size() * sizeof(BVH8Node));
+            out.write(reinterpret_cast<const char*>(wideBVH.primitives.data()), wideBVH.primitives.size() * sizeof(uint32_t));
+            if (!out) {
+                out.close();
+                std::remove(temp.c_str());
+                return false;
+            }
+        }
+        std::remove(path.c_str());
+        return std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+};
+
+// 簇文件布局：文件头 | BVH 节点 | 按叶子顺序排列的簇。
+// 每个簇占一页（4 KB），是驻留管理和 madvise 的最小单位；
+// 簇按 BVH 叶子的深度优先顺序存放，空间上相邻的三角形在文件中也相邻
+const uint32_t CLUSTER_MAGIC = 0x484d4c43; // "CLMH"
+const uint32_t CLUSTER_VERSION = 1;
+const int CLUSTER_BYTES = 4096;
+
+struct ClusterFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t clusterCount;
+    uint64_t triangleCount;
+    uint64_t clusterOffset;   // 第一个簇在文件中的偏移，按页对齐
+    glm::vec3 min, max;
+};
+
+// BVH 节点：cluster >= 0 为叶子，对应一个簇；否则两个子节点为 child 和 child + 1
+struct ClusterNode {
+    glm::vec3 min;
+    int32_t child;
+    glm::vec3 max;
+    int32_t cluster;
+};
+
+struct ClusterHeader {
+    uint32_t count;
+    uint32_t padding[3];
+};
+
+const int TRIANGLES_PER_CLUSTER = int((CLUSTER_BYTES - sizeof(ClusterHeader)) / sizeof(PackedTriangle));
+
+// 为 triangles 建立以簇为叶子的 BVH 并写入 path。
+// 建立过程在内存中进行（离线处理），渲染时只需映射生成的文件
+inline bool writeClusterFile(const std::string& path, const std::vector<Triangle>& triangles,
+                             BVHBuilder builder = BVH_BUILD_MEDIAN) {
+    if (triangles.empty()) return false;
+    std::vector<AABB> boxes(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        boxes[i].expand(triangles[i].v0);
+        boxes[i].expand(triangles[i].v1);
+        boxes[i].expand(triangles[i].v2);
+    }
+    BinaryBVH bvh;
+    bvh.build(boxes, TRIANGLES_PER_CLUSTER, builder);
+    const std::vector<uint32_t>& order = bvh.order;
+
+    // 叶子区间在 order 中按深度优先顺序排列，簇号即叶子按区间起点排序后的序号
+    std::vector<ClusterNode> nodes(bvh.nodes.size());
+    std::vector<std::pair<size_t, size_t>> leaves; // 每个簇在 order 中的区间
+    for (size_t i = 0; i < bvh.nodes.size(); ++i) {
+        const BVHNode& node = bvh.nodes[i];
+        nodes[i] = {node.min, node.count > 0 ? -1 : int32_t(node.first), node.max, -1};
+        if (node.count > 0) leaves.push_back({node.first, node.first + node.count});
+    }
+    std::sort(leaves.begin(), leaves.end());
+    for (size_t i = 0; i < bvh.nodes.size(); ++i)
+        if (bvh.nodes[i].count > 0)
+            nodes[i].cluster = int32_t(std::lower_bound(leaves.begin(), leaves.end(), std::make_pair(size_t(bvh.nodes[i].first), size_t(0))) - leaves.begin());
+
+    ClusterFileHeader header = {};
+    header.magic = CLUSTER_MAGIC;
+    header.version = CLUSTER_VERSION;
+    header.nodeCount = (uint32_t)nodes.size();
+    header.clusterCount = (uint32_t)leaves.size();
+    header.triangleCount = triangles.size();
+    size_t nodeEnd = sizeof(header) + nodes.size() * sizeof(ClusterNode);
+    header.clusterOffset = (nodeEnd + CLUSTER_BYTES - 1) / CLUSTER_BYTES * CLUSTER_BYTES;
+    header.min = nodes[0].min;
+    header.max = nodes[0].max;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(ClusterNode));
+    std::vector<char> page(CLUSTER_BYTES, 0);
+    out.write(page.data(), header.clusterOffset - nodeEnd);
+    for (const auto& leaf : leaves) {
+        std::fill(page.begin(), page.end(), 0);
+        ClusterHeader* cluster = reinterpret_cast<ClusterHeader*>(page.data());
+        cluster->count = uint32_t(leaf.second - leaf.first);
+        PackedTriangle* packed = reinterpret_cast<PackedTriangle*>(cluster + 1);
+        for (size_t i = leaf.first; i < leaf.second; ++i) {
+            const Triangle& tri = triangles[order[i]];
+            packed[i - leaf.first] = packTriangle(tri);
+        }
+        out.write(page.data(), CLUSTER_BYTES);
+    }
+    return bool(out);
+}
+
+// 读入 OBJ 文件中的全部三角形，供 writeClusterFile 离线转换。
+// 只取 v 和 f 两种行，多边形按扇形三角化，支持负（相对）下标；下标越界时返回 false
+inline bool readObjTriangles(const std::string& path, std::vector<Triangle>& triangles) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> face;
+    std::string line;
+    while (std::getline(in, line)) {
+        const char* p = line.c_str();
+        while (*p == ' ' || *p == '\t') ++p;
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            char* end;
+            glm::vec3 v;
+            v.x = std::strtof(p + 1, &end);
+            v.y = std::strtof(end, &end);
+            v.z = std::strtof(end, &end);
+            positions.push_back(v);
+        } else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            face.clear();
+            for (p++;;) {
+                char* end;
+                long index = std::strtol(p, &end, 10);
+                if (end == p) break;
+                long k = index < 0 ? long(positions.size()) + index : index - 1;
+                if (k < 0 || k >= long(positions.size())) return false;
+                face.push_back(uint32_t(k));
+                for (p = end; *p && *p != ' ' && *p != '\t'; ++p) {} // 跳过 /vt/vn
+            }
+            for (size_t i = 2; i < face.size(); ++i)
+                triangles.push_back({positions[face[0]], positions[face[i - 1]], positions[face[i]]});
+        }
+    }
+    return true;
+}
+
+// 每帧的簇访问统计
+struct ClusterStats {
+    size_t touchedBytes = 0;    // 本帧访问过的簇
+    size_t loadedBytes = 0;     // 其中上一帧结束时不在驻留集中的簇
+    size_t evictedBytes = 0;    // 本帧结束时被换出的簇
+    size_t residentBytes = 0;   // 换出后驻留集的大小
+};
+
+// 几何数据放在内存映射文件中的三角形网格，可以大于物理内存。
+// BVH 内部节点常驻内存，叶子簇在光线第一次访问时才从文件读入；
+// 驻留集按 LRU 维护在 residentBudget 以内，每帧结束时调用 endFrame() 更新并换出
+class ClusterMesh : public Object {
+public:
+    size_t residentBudget = size_t(256) << 20;  // 驻留簇的字节数上限
+    int prefetchClusters = 4;                    // 访问冷簇时，预取文件中紧随其后的簇数
+
+    ClusterMesh(const glm::vec3& color, float reflectivity) : Object(color, reflectivity) {}
+
+    bool open(const std::string& path) {
+        if (!file.open(path) || file.size() < sizeof(ClusterFileHeader)) return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != CLUSTER_MAGIC || header.version != CLUSTER_VERSION ||
+            header.nodeCount == 0 || header.clusterCount == 0 ||
+            header.clusterOffset < sizeof(header) + size_t(header.nodeCount) * sizeof(ClusterNode) ||
+            header.clusterOffset > file.size() ||
+            header.clusterCount > (file.size() - header.clusterOffset) / CLUSTER_BYTES) {
+            file.close();
+            return false;
+        }
+        // 文件中的二叉节点读入后合并为 8 叉压缩 BVH 常驻内存，每个叶子恰好是一个簇。
+        // 子节点总在父节点之后，据此拒绝越界或成环的节点
+        std::vector<ClusterNode> fileNodes(header.nodeCount);
+        std::memcpy(fileNodes.data(), file.data() + sizeof(header), fileNodes.size() * sizeof(ClusterNode));
+        for (size_t i = 0; i < fileNodes.size(); ++i) {
+            const ClusterNode& node = fileNodes[i];
+            bool valid = node.cluster >= 0 ? uint32_t(node.cluster) < header.clusterCount
+                                           : node.child > int64_t(i) && size_t(node.child) + 1 < fileNodes.size();
+            if (!valid) {
+                file.close();
+                return false;
+            }
+        }
+        BinaryBVH binary;
+        binary.nodes.resize(fileNodes.size());
+        binary.order.resize(header.clusterCount);
+        for (size_t i = 0; i < fileNodes.size(); ++i) {
+            const ClusterNode& node = fileNodes[i];
+            bool leaf = node.cluster >= 0;
+            binary.nodes[i] = {node.min, uint32_t(leaf ? node.cluster : node.child), node.max, leaf ? 1u : 0u};
+            if (leaf) binary.order[node.cluster] = uint32_t(node.cluster);
+        }
+        bvh.build(binary);
+        stamp.reset(new std::atomic<unsigned int>[header.clusterCount]);
+        for (uint32_t c = 0; c < header.clusterCount; ++c) stamp[c] = 0;
+        lru.clear();
+        lruPosition.assign(header.clusterCount, lru.end());
+        frame = 2; // 帧号 0 表示从未访问，与“上一帧访问过”区分开
+        return true;
+    }
+
+    size_t triangleCount() const { return header.triangleCount; }
+    size_t clusterCount() const { return header.clusterCount; }
+    size_t fileBytes() const { return file.size(); }
+    size_t nodeBytes() const { return bvh.memoryBytes() + bvh.primitives.size() * sizeof(uint32_t); }
+    const ClusterStats& lastFrame() const { return stats; }
+
+    bool intersect(const Ray& ray, float& t, vec3a& normal) const override {
+        float closest = std::numeric_limits<float>::max();
+        glm::vec3 n;
+        bvh.traverse(ray, closest, [&](uint32_t first, uint32_t count) {
+            for (uint32_t i = first; i < first + count; ++i) intersectCluster(bvh.primitives[i], ray, closest, n);
+            return closest;
+        });
+        if (closest == std::numeric_limits<float>::max()) return false;
+        t = closest;
+        normal = toAligned(n);
+        return true;
+    }
+
+    BoundingSphere bounds() const override {
+        return {(header.min + header.max) * 0.5f, 0.5f * glm::length(header.max - header.min)};
+    }
+
+    void convexHull(std::vector<glm::vec3>& points) const override {
+        for (int i = 0; i < 8; ++i)
+            points.push_back(glm::vec3(i & 1 ? header.max.x : header.min.x, i & 2 ? header.max.y : header.min.y, i & 4 ? header.max.z : header.min.z));
+    }
+
+    // 一帧渲染结束后调用（此时没有渲染线程在访问）：
+    // 把本帧访问过的簇移到 LRU 队首，超出预算的簇从队尾换出
+    const ClusterStats& endFrame() {
+        stats = ClusterStats();
+        for (uint32_t c = 0; c < header.clusterCount; ++c) {
+            if (stamp[c].load(std::memory_order_relaxed) != frame) continue;
+            stats.touchedBytes += CLUSTER_BYTES;
+            if (lruPosition[c] == lru.end()) {
+                stats.loadedBytes += CLUSTER_BYTES;
+                lru.push_front(c);
+            } else {
+                lru.splice(lru.begin(), lru, lruPosition[c]);
+            }
+            lruPosition[c] = lru.begin();
+        }
+        while (!lru.empty() && lru.size() * CLUSTER_BYTES > residentBudget) {
+            uint32_t c = lru.back();
+            lru.pop_back();
+            lruPosition[c] = lru.end();
+            file.dontNeed(clusterOffset(c), CLUSTER_BYTES);
+            stats.evictedBytes += CLUSTER_BYTES;
+        }
+        stats.residentBytes = lru.size() * CLUSTER_BYTES;
+        frame++;
+        return stats;
+    }
+
+private:
+    MappedFile file;
+    ClusterFileHeader header = {};
+    BVH8 bvh;
+    std::unique_ptr<std::atomic<unsigned int>[]> stamp; // 最近一次被访问的帧号
+    unsigned int frame = 2;
+    std::list<uint32_t> lru;
+    std::vector<std::list<uint32_t>::iterator> lruPosition;
+    ClusterStats stats;
+
+    size_t clusterOffset(uint32_t c) const {
+        return header.clusterOffset + size_t(c) * CLUSTER_BYTES;
+    }
+
+    // 记录簇的访问。本帧第一次访问、且上一帧也没有访问的簇可能不在内存中，
+    // 顺便预取文件中紧随其后的簇：它们在空间上相邻，很可能马上被访问
+    void touch(uint32_t c) const {
+        unsigned int previous = stamp[c].exchange(frame, std::memory_order_relaxed);
+        if (previous == frame || previous + 1 == frame) return;
+        uint32_t count = std::min<uint32_t>(prefetchClusters, header.clusterCount - c - 1);
+        if (count > 0) file.willNeed(clusterOffset(c + 1), size_t(count) * CLUSTER_BYTES);
+    }
+
+    void intersectCluster(uint32_t c, const Ray& ray, float& closest, glm::vec3& normal) const {
+        touch(c);
+        const char* page = file.data() + clusterOffset(c);
+        // 簇头在第一次访问时才读入，不在 open() 中逐页检查，损坏的计数在这里截断
+        uint32_t count = std::min<uint32_t>(reinterpret_cast<const ClusterHeader*>(page)->count, TRIANGLES_PER_CLUSTER);
+        const PackedTriangle* triangles = reinterpret_cast<const PackedTriangle*>(page + sizeof(ClusterHeader));
+        for (uint32_t i = 0; i < count; ++i) intersectTriangle(triangles[i], ray, closest, normal);
+    }
+};
+#endif
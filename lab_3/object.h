@@ -1,35 +1,75 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "simd.h"
+
 #include <vector>
 #include <limits>
 
 struct Ray {
-    glm::vec3 origin;
-    glm::vec3 direction;
+    vec3a origin;
+    vec3a direction;
+};
+
+// 包围球，用于把物体的影响范围保守地投影到屏幕上
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+};
+
+// 材质类型，每种类型对应 material.h 中一个编译期特化的着色核
+enum MaterialType {
+    MATERIAL_LAMBERT,   // 仅漫反射
+    MATERIAL_PHONG,     // 漫反射 + 固定指数的 Phong 高光
+    MATERIAL_MIRROR,    // 仅镜面反射
+    MATERIAL_GLOSSY,    // Phong + 镜面反射
+    MATERIAL_COUNT
 };
 
 class Object {
 public:
     glm::vec3 color;        // 物体颜色
     float reflectivity;     // 物体的反射率
+    MaterialType material;  // 材质类型
 
+    // 未指定材质时保持原先的着色方式：有反射率的物体为 Glossy，否则为 Phong
     Object(const glm::vec3& color, float reflectivity) 
-        : color(color), reflectivity(reflectivity) {}
+        : color(color), reflectivity(reflectivity), material(reflectivity > 0.0f ? MATERIAL_GLOSSY : MATERIAL_PHONG) {}
 
     // 纯虚函数，要求子类实现
-    virtual bool intersect(const Ray& ray, float& t, glm::vec3& normal) const = 0;
+    virtual bool intersect(const Ray& ray, float& t, vec3a& normal) const = 0;
+    virtual BoundingSphere bounds() const = 0;
+
+    // 追加若干点，其凸包包含整个物体；默认取包围球的外接立方体
+    virtual void convexHull(std::vector<glm::vec3>& points) const {
+        BoundingSphere s = bounds();
+        for (int i = 0; i < 8; ++i)
+            points.push_back(s.center + s.radius * glm::vec3(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1));
+    }
+
+    // 是否会产生反射光线
+    bool reflective() const {
+        return (material == MATERIAL_MIRROR || material == MATERIAL_GLOSSY) && reflectivity > 0.0f;
+    }
+
+    // 平面反射体返回镜面所在平面，用于求物体在镜中的虚像；曲面反射体返回 false
+    virtual bool mirrorPlane(glm::vec3&, glm::vec3&) const { return false; }
 };
 
 class Sphere : public Object {
 public:
-    glm::vec3 center;
+    vec3a center;
     float radius;
 
     Sphere(const glm::vec3& center, float radius, const glm::vec3& color, float reflectivity)
-        : Object(color, reflectivity), center(center), radius(radius) {}
+        : Object(color, reflectivity), center(toAligned(center)), radius(radius) {}
 
     // 重写 intersect 方法
-    bool intersect(const Ray& ray, float& t, glm::vec3& normal) const override {
-        glm::vec3 oc = ray.origin - center;
+    bool intersect(const Ray& ray, float& t, vec3a& normal) const override {
+        vec3a oc = ray.origin - center;
         float a = glm::dot(ray.direction, ray.direction);
         float b = 2.0f * glm::dot(oc, ray.direction);
         float c = glm::dot(oc, oc) - radius * radius;
@@ -41,39 +81,42 @@ public:
         if (t < 0) t = (-b + glm::sqrt(discriminant)) / (2.0f * a);
         if (t < 0) return false;
 
-        glm::vec3 hitPoint = ray.origin + t * ray.direction;
+        vec3a hitPoint = ray.origin + t * ray.direction;
         normal = glm::normalize(hitPoint - center);
         return true;
     }
+
+    BoundingSphere bounds() const override {
+        return {toVec3(center), radius};
+    }
 };
 
 class Wall : public Object {
 public:
-    glm::vec3 point;    // 墙的中心点
-    glm::vec3 normal;   // 墙的法线方向
-    glm::vec3 right;    // 墙的右方向向量（需要与 normal 垂直）
+    vec3a point;        // 墙的中心点
+    vec3a normal;       // 墙的法线方向
+    vec3a right;        // 墙的右方向向量（需要与 normal 垂直）
+    vec3a up;           // 墙的“上”方向向量，由 normal 和 right 求出
     float width;        // 墙的宽度
     float height;       // 墙的高度
 
     Wall(const glm::vec3& point, const glm::vec3& normal, const glm::vec3& right, float width, float height, const glm::vec3& color, float reflectivity)
-        : Object(color, reflectivity), point(point), normal(glm::normalize(normal)), right(glm::normalize(right)), width(width), height(height) {
+        : Object(color, reflectivity), point(toAligned(point)), normal(toAligned(glm::normalize(normal))), width(width), height(height) {
         // 确保 right 向量和 normal 向量是垂直的
-        this->right = glm::normalize(right - glm::dot(right, normal) * normal);
+        this->right = toAligned(glm::normalize(right - glm::dot(right, normal) * normal));
+        up = cross3(this->normal, this->right);
     }
 
     // 重写 intersect 方法
-    bool intersect(const Ray& ray, float& t, glm::vec3& outNormal) const override {
+    bool intersect(const Ray& ray, float& t, vec3a& outNormal) const override {
         float denom = glm::dot(normal, ray.direction);
         if (glm::abs(denom) > 1e-6) { // 检查光线是否平行于墙壁
             t = glm::dot(point - ray.origin, normal) / denom;
             if (t >= 0) {
-                glm::vec3 hitPoint = ray.origin + t * ray.direction;
-
-                // 计算墙的“上”方向向量
-                glm::vec3 up = glm::cross(normal, right);
+                vec3a hitPoint = ray.origin + t * ray.direction;
 
                 // 将 hitPoint 转换为墙的局部坐标系
-                glm::vec3 localHit = hitPoint - point;
+                vec3a localHit = hitPoint - point;
                 float hitX = glm::dot(localHit, right);  // 在 right 方向上的投影，代表水平位置
                 float hitY = glm::dot(localHit, up);     // 在 up 方向上的投影，代表垂直位置
 
@@ -87,12 +130,40 @@ public:
         }
         return false;
     }
+
+    BoundingSphere bounds() const override {
+        return {toVec3(point), 0.5f * glm::sqrt(width * width + height * height)};
+    }
+
+    void convexHull(std::vector<glm::vec3>& points) const override {
+        for (int i = 0; i < 4; ++i)
+            points.push_back(toVec3(point + (i & 1 ? 0.5f : -0.5f) * width * right + (i & 2 ? 0.5f : -0.5f) * height * up));
+    }
+
+    bool mirrorPlane(glm::vec3& outPoint, glm::vec3& outNormal) const override {
+        outPoint = toVec3(point);
+        outNormal = toVec3(normal);
+        return true;
+    }
 };
 
 
+// 光源形状。面光源相当于均匀分布在其表面上的一组点光源，亮度与同样颜色的点光源相同，
+// 只是阴影带有半影，见 arealight.h
+enum LightShape {
+    LIGHT_POINT,
+    LIGHT_RECTANGLE,    // 以 position 为中心、两条边为 edgeU 和 edgeV 的矩形
+    LIGHT_SPHERE,       // 以 position 为球心、半径为 radius 的球
+    LIGHT_SHAPE_COUNT
+};
+
 struct Light {
     glm::vec3 position;
     glm::vec3 color;
+    LightShape shape = LIGHT_POINT;
+    glm::vec3 edgeU = glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 edgeV = glm::vec3(0.0f, 0.0f, 1.0f);
+    float radius = 0.5f;
 };
 
 struct Camera {
@@ -100,4 +171,45 @@ struct Camera {
     glm::vec3 direction;  // 相机朝向方向
     float angle;          // 相机绕朝向旋转的角度
     float fov;            // 视野（FOV）
-};
\ No newline at end of file
+};
+
+// 由相机参数和画面尺寸得到的成像坐标系，用于生成主光线以及把世界坐标投影回像素坐标
+struct CameraFrame {
+    glm::vec3 position;
+    glm::vec3 forward, right, up;
+    float aspectRatio, scale;
+    int width, height;
+
+    CameraFrame(const Camera& camera, int width, int height)
+        : position(camera.position), width(width), height(height) {
+        aspectRatio = float(width) / float(height);
+        scale = glm::tan(glm::radians(camera.fov * 0.5f));
+
+        // 计算前方向、右方向、上方向
+        forward = glm::normalize(camera.direction);
+        right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        up = glm::normalize(glm::cross(right, forward));
+
+        glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(camera.angle), forward);
+        right = glm::vec3(rotation * glm::vec4(right, 1.0f));
+        up = glm::vec3(rotation * glm::vec4(up, 1.0f));
+    }
+
+    // 穿过像素 (x, y) 内某一点的主光线，x、y 为连续像素坐标（像素中心为 +0.5）
+    Ray primaryRay(float x, float y) const {
+        float px = (2 * x / float(width) - 1) * aspectRatio * scale;
+        float py = (2 * y / float(height) - 1) * scale;
+        return {toAligned(position), toAligned(glm::normalize(forward + px * right + py * up))};
+    }
+
+    // 把世界坐标投影为连续像素坐标，z 分量为沿 forward 的深度（<= 0 表示在相机后方）
+    glm::vec3 project(const glm::vec3& p) const {
+        glm::vec3 local = p - position;
+        float z = glm::dot(local, forward);
+        float px = glm::dot(local, right) / z;
+        float py = glm::dot(local, up) / z;
+        return {(px / (aspectRatio * scale) + 1) * 0.5f * width,
+                (py / scale + 1) * 0.5f * height, z};
+    }
+};
+#endif
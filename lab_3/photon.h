@@ -0,0 +1,317 @@
+#ifndef PHOTON_H
+#define PHOTON_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "object.h"
+#include "accel.h"
+#include "placement.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+// 光子图中的一个光子（28 字节）。入射方向按球坐标量化为两个字节（Jensen 的做法），
+// axis 为它在 kd-tree 中作为节点时的分割轴
+struct Photon {
+    glm::vec3 position;
+    glm::vec3 power;
+    unsigned char theta, phi;
+    unsigned char axis;
+    unsigned char pad;
+};
+
+// 一帧中光子图的统计
+struct PhotonStats {
+    size_t emitted = 0;         // 发射的光子数
+    size_t stored = 0;          // 存入光子图的光子数
+    double traceMs = 0.0;       // 光子追踪耗时
+    double buildMs = 0.0;       // kd-tree 构建耗时
+    long long gathers = 0;      // 本帧的 k 近邻查询次数
+    double gatherMs = 0.0;      // 本帧查询耗时，为各渲染线程耗时之和
+};
+
+// 焦散光子图：从光源向反射物体发射光子，经过至少一次镜面反射后落在漫反射表面上的光子存入光子图，
+// 着色时用 k 近邻的密度估计求出焦散的辐照度（Jensen 1996）。
+// 光子按左平衡 kd-tree 存放在一个数组中，节点 i 的子节点为 2i+1、2i+2，不需要指针。
+// 光子追踪、kd-tree 构建和查询都在渲染线程上进行
+class PhotonMap {
+public:
+    bool enabled = false;
+    int photonCount = 200000;   // 每次构建发射的光子总数，平均分给各个反射物体
+    int gatherCount = 64;       // 密度估计使用的最近光子数 k
+    float maxRadius = 0.25f;    // 查询半径上限
+    // 光源的辐射强度（每球面度）与 light.color 之比。直接光照 color * light.color * cosθ 相当于
+    // BRDF 为 color / π、辐照度为 π * light.color * cosθ 且没有距离衰减；光子按点光源的 1/r² 传播，
+    // 取 36π 时与距光源 6 个单位处（实验场景中物体所在的位置）的直接光照相当
+    float intensity = 113.0f;
+
+    bool empty() const { return photons.empty(); }
+    const PhotonStats& stats() const { return frameStats; }
+
+    // 开始新的一帧：清零查询统计
+    void beginFrame() {
+        gathers = 0;
+        gatherNs = 0;
+    }
+
+    // 结束一帧，汇总查询统计
+    const PhotonStats& endFrame() {
+        frameStats.gathers = gathers;
+        frameStats.gatherMs = gatherNs / 1e6;
+        return frameStats;
+    }
+
+    // 在 workers 安排的线程上追踪光子并构建 kd-tree。accel 需要已经按 objects 构建好
+    void build(const std::vector<Object*>& objects, const Accel& accel, const Light& light, const std::vector<WorkerSlot>& workers) {
+        auto beg = std::chrono::steady_clock::now();
+        std::vector<const Object*> targets;
+        for (const auto* object : objects)
+            if (object->reflective()) targets.push_back(object);
+
+        int workerCount = int(workers.size());
+        int perTarget = targets.empty() ? 0 : photonCount / int(targets.size());
+        std::vector<std::vector<Photon>> stored(workerCount);
+        std::vector<std::thread> threads;
+        for (int w = 0; w < workerCount; ++w) {
+            threads.emplace_back([&, w]() {
+                pinCurrentThread(workers[w].cpu);
+                std::mt19937 rng(1234567u + 7919u * w);
+                for (const Object* target : targets) {
+                    int first = int((long long)perTarget * w / workerCount);
+                    int last = int((long long)perTarget * (w + 1) / workerCount);
+                    emit(target, last - first, perTarget, accel, light, rng, stored[w]);
+                }
+                totalRays += tracedRays;
+                tracedRays = 0;
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        std::vector<Photon> flat;
+        for (auto& part : stored) flat.insert(flat.end(), part.begin(), part.end());
+        auto mid = std::chrono::steady_clock::now();
+        balance(flat, workers);
+        auto end = std::chrono::steady_clock::now();
+
+        frameStats = PhotonStats();
+        frameStats.emitted = size_t(perTarget) * targets.size();
+        frameStats.stored = photons.size();
+        frameStats.traceMs = std::chrono::duration<double, std::milli>(mid - beg).count();
+        frameStats.buildMs = std::chrono::duration<double, std::milli>(end - mid).count();
+    }
+
+    // 点 p（法线 n）处焦散的辐照度：最近的 k 个光子中从正面入射的光子功率之和除以查询圆盘的面积
+    glm::vec3 irradiance(const glm::vec3& p, const glm::vec3& n) const {
+        if (photons.empty()) return glm::vec3(0.0f);
+        auto beg = std::chrono::steady_clock::now();
+        thread_local std::vector<std::pair<float, uint32_t>> heap;
+        heap.clear();
+        float maxDist2 = maxRadius * maxRadius;
+        locate(0, p, heap, maxDist2);
+
+        glm::vec3 flux(0.0f);
+        for (const auto& entry : heap) {
+            const Photon& photon = photons[entry.second];
+            if (glm::dot(direction(photon), n) < 0.0f) flux += photon.power;
+        }
+        gathers++;
+        gatherNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - beg).count();
+        return flux / (glm::pi<float>() * maxDist2);
+    }
+
+private:
+    static const int MAX_BOUNCES = 6;
+
+    std::vector<Photon> photons;    // 左平衡 kd-tree，按堆的顺序存放
+    PhotonStats frameStats;
+    mutable std::atomic<long long> gathers{0};
+    mutable std::atomic<long long> gatherNs{0};
+
+    static void encode(Photon& photon, const glm::vec3& d) {
+        float theta = std::acos(glm::clamp(d.z, -1.0f, 1.0f));
+        float phi = std::atan2(d.y, d.x);
+        photon.theta = (unsigned char)glm::clamp(int(theta * (256.0f / glm::pi<float>())), 0, 255);
+        photon.phi = (unsigned char)glm::clamp(int((phi + glm::pi<float>()) * (256.0f / glm::two_pi<float>())), 0, 255);
+    }
+
+    // 量化方向的解码表
+    static glm::vec3 direction(const Photon& photon) {
+        static const struct Table {
+            float cosTheta[256], sinTheta[256], cosPhi[256], sinPhi[256];
+            Table() {
+                for (int i = 0; i < 256; ++i) {
+                    float theta = (i + 0.5f) * glm::pi<float>() / 256.0f;
+                    float phi = (i + 0.5f) * glm::two_pi<float>() / 256.0f - glm::pi<float>();
+                    cosTheta[i] = std::cos(theta);
+                    sinTheta[i] = std::sin(theta);
+                    cosPhi[i] = std::cos(phi);
+                    sinPhi[i] = std::sin(phi);
+                }
+            }
+        } table;
+        return {table.sinTheta[photon.theta] * table.cosPhi[photon.phi],
+                table.sinTheta[photon.theta] * table.sinPhi[photon.phi],
+                table.cosTheta[photon.theta]};
+    }
+
+    // 向 target 的包围球所张的圆锥内均匀发射 count 个光子（该物体共分到 total 个）。
+    // 只保留首先击中 target 的光子：方向落在多个圆锥内时，由首先击中的物体负责，不会重复计入
+    void emit(const Object* target, int count, int total, const Accel& accel, const Light& light,
+              std::mt19937& rng, std::vector<Photon>& out) const {
+        BoundingSphere bounds = target->bounds();
+        glm::vec3 axis = bounds.center - light.position;
+        float distance = glm::length(axis);
+        axis = distance > 0.0f ? axis / distance : glm::vec3(0.0f, 0.0f, -1.0f);
+        float cosMax = distance > bounds.radius ? std::sqrt(1.0f - (bounds.radius / distance) * (bounds.radius / distance)) : -1.0f;
+        float solidAngle = glm::two_pi<float>() * (1.0f - cosMax);
+        glm::vec3 power = intensity * light.color * solidAngle / float(total);
+
+        glm::vec3 t = std::fabs(axis.x) > 0.5f ? glm::vec3(axis.y, -axis.x, 0.0f) : glm::vec3(0.0f, axis.z, -axis.y);
+        t = glm::normalize(t);
+        glm::vec3 b = glm::cross(axis, t);
+        std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+
+        for (int i = 0; i < count; ++i) {
+            float cosTheta = 1.0f - uni(rng) * (1.0f - cosMax);
+            float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+            float phi = glm::two_pi<float>() * uni(rng);
+            glm::vec3 dir = std::cos(phi) * sinTheta * t + std::sin(phi) * sinTheta * b + cosTheta * axis;
+
+            Ray ray;
+            ray.origin = toAligned(light.position);
+            ray.direction = toAligned(dir);
+            glm::vec3 flux = power;
+            for (int bounce = 0; bounce < MAX_BOUNCES; ++bounce) {
+                tracedRays++;
+                Hit hit;
+                if (!accel.intersect(ray, hit)) break;
+                if (bounce == 0 && hit.object != target) break;
+                glm::vec3 point = toVec3(ray.origin + hit.t * ray.direction);
+                glm::vec3 normal = toVec3(hit.normal);
+                glm::vec3 d = toVec3(ray.direction);
+                if (glm::dot(normal, d) > 0.0f) normal = -normal;
+
+                // 经过镜面反射后落在有漫反射的表面上，存为焦散光子
+                if (bounce > 0 && hit.object->material != MATERIAL_MIRROR) {
+                    Photon photon;
+                    photon.position = point;
+                    photon.power = flux;
+                    photon.axis = 0;
+                    photon.pad = 0;
+                    encode(photon, d);
+                    out.push_back(photon);
+                }
+                if (!hit.object->reflective()) break;
+                flux *= hit.object->reflectivity;
+                ray.origin = toAligned(point + normal * 0.001f);
+                ray.direction = toAligned(glm::reflect(d, normal));
+            }
+        }
+    }
+
+    // n 个节点的左平衡树中左子树的节点数：除最后一层外都是满的，最后一层从左向右填充
+    static size_t leftSubtreeSize(size_t n) {
+        if (n <= 1) return 0;
+        size_t full = 1;
+        while (full * 2 <= n) full *= 2;
+        size_t last = n - (full - 1);
+        size_t half = full / 2;
+        return (half - 1) + std::min(last, half);
+    }
+
+    // 把 src[lo, hi) 中的中位数（使左子树大小符合左平衡树）放到节点 index，分割轴取包围盒最长的轴；
+    // 返回中位数的位置，左右两侧分别属于两棵子树
+    size_t splitNode(std::vector<Photon>& src, size_t lo, size_t hi, size_t index) {
+        glm::vec3 boxMin(std::numeric_limits<float>::max()), boxMax(-std::numeric_limits<float>::max());
+        for (size_t i = lo; i < hi; ++i) {
+            boxMin = glm::min(boxMin, src[i].position);
+            boxMax = glm::max(boxMax, src[i].position);
+        }
+        glm::vec3 extent = boxMax - boxMin;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        size_t median = lo + leftSubtreeSize(hi - lo);
+        std::nth_element(src.begin() + lo, src.begin() + median, src.begin() + hi,
+                         [axis](const Photon& a, const Photon& b) { return a.position[axis] < b.position[axis]; });
+        photons[index] = src[median];
+        photons[index].axis = (unsigned char)axis;
+        return median;
+    }
+
+    void balanceRange(std::vector<Photon>& src, size_t lo, size_t hi, size_t index) {
+        while (hi > lo) {
+            size_t median = splitNode(src, lo, hi, index);
+            balanceRange(src, lo, median, 2 * index + 1);
+            lo = median + 1;
+            index = 2 * index + 2;
+        }
+    }
+
+    // 上面若干层在当前线程划分，其下的子树作为独立任务分给渲染线程
+    void balance(std::vector<Photon>& src, const std::vector<WorkerSlot>& workers) {
+        photons.resize(src.size());
+        struct Task { size_t lo, hi, index; };
+        std::vector<Task> tasks = {{0, src.size(), 0}};
+        bool split = workers.size() > 1;
+        while (split && tasks.size() < workers.size() * 4) {
+            std::vector<Task> next;
+            split = false;
+            for (const Task& task : tasks) {
+                if (task.hi - task.lo < 4096) {
+                    next.push_back(task);
+                    continue;
+                }
+                size_t median = splitNode(src, task.lo, task.hi, task.index);
+                next.push_back({task.lo, median, 2 * task.index + 1});
+                next.push_back({median + 1, task.hi, 2 * task.index + 2});
+                split = true;
+            }
+            tasks.swap(next);
+        }
+
+        std::atomic<size_t> nextTask(0);
+        std::vector<std::thread> threads;
+        for (const auto& worker : workers) {
+            threads.emplace_back([&, worker]() {
+                pinCurrentThread(worker.cpu);
+                for (size_t i = nextTask++; i < tasks.size(); i = nextTask++)
+                    balanceRange(src, tasks[i].lo, tasks[i].hi, tasks[i].index);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    // k 近邻查询：heap 为按距离平方排列的大顶堆，装满后 maxDist2 收缩为堆顶
+    void locate(size_t i, const glm::vec3& p, std::vector<std::pair<float, uint32_t>>& heap, float& maxDist2) const {
+        const Photon& photon = photons[i];
+        size_t left = 2 * i + 1;
+        if (left < photons.size()) {
+            float delta = p[photon.axis] - photon.position[photon.axis];
+            size_t nearChild = delta < 0.0f ? left : left + 1;
+            size_t farChild = delta < 0.0f ? left + 1 : left;
+            if (nearChild < photons.size()) locate(nearChild, p, heap, maxDist2);
+            if (delta * delta < maxDist2 && farChild < photons.size()) locate(farChild, p, heap, maxDist2);
+        }
+        glm::vec3 d = photon.position - p;
+        float d2 = glm::dot(d, d);
+        if (d2 >= maxDist2) return;
+        if ((int)heap.size() < gatherCount) {
+            heap.push_back({d2, uint32_t(i)});
+            std::push_heap(heap.begin(), heap.end());
+            if ((int)heap.size() == gatherCount) maxDist2 = heap.front().first;
+        } else {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = {d2, uint32_t(i)};
+            std::push_heap(heap.begin(), heap.end());
+            maxDist2 = heap.front().first;
+        }
+    }
+};
+
+PhotonMap photonMap;
+#endif
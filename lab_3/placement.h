@@ -0,0 +1,195 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <cctype>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+// 渲染线程的放置策略
+enum PlacementPolicy {
+    PLACEMENT_NONE,      // 不绑定，线程数为 hardware_concurrency()，由系统调度
+    PLACEMENT_PHYSICAL,  // 每个物理核一个线程，不使用超线程
+    PLACEMENT_SMT,       // 使用全部逻辑核，同一物理核上的两个线程领取相邻的 tile
+    PLACEMENT_NUMA,      // 每个 NUMA 节点领取一段连续的 tile，帧缓冲由本节点的线程首次写入
+    PLACEMENT_COUNT
+};
+const char* const placementNames[PLACEMENT_COUNT] = {"none", "physical", "smt", "numa"};
+
+// 逻辑处理器的拓扑信息
+struct LogicalCpu {
+    int id;       // 绑定时使用的逻辑处理器编号
+    int core;     // 物理核编号（在所属 package 内）
+    int package;  // 插槽编号
+    int node;     // NUMA 节点编号
+};
+
+#ifdef __linux__
+inline int readSysInt(const std::string& path, int fallback) {
+    std::ifstream in(path);
+    int value;
+    return (in >> value) ? value : fallback;
+}
+#endif
+
+// 读取当前进程可用的逻辑处理器拓扑，只在第一次调用时查询。
+// Linux 读取 sysfs，Windows 使用 GetLogicalProcessorInformation（只覆盖第一个处理器组，最多 64 个逻辑核）。
+// 查询失败时把每个逻辑核当作单独的物理核，全部归入节点 0
+inline const std::vector<LogicalCpu>& cpuTopology() {
+    static const std::vector<LogicalCpu> cpus = []() {
+        std::vector<LogicalCpu> result;
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int id = 0; id < CPU_SETSIZE; ++id) {
+                if (!CPU_ISSET(id, &allowed)) continue;
+                std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+                LogicalCpu cpu = {id, readSysInt(dir + "/topology/core_id", id), readSysInt(dir + "/topology/physical_package_id", 0), 0};
+                // 所属节点以 cpuN/nodeM 链接的形式给出
+                if (DIR* d = opendir(dir.c_str())) {
+                    while (dirent* entry = readdir(d)) {
+                        std::string name = entry->d_name;
+                        if (name.size() > 4 && name.compare(0, 4, "node") == 0 && isdigit((unsigned char)name[4]))
+                            cpu.node = std::stoi(name.substr(4));
+                    }
+                    closedir(d);
+                }
+                result.push_back(cpu);
+            }
+        }
+#elif defined(_WIN32)
+        DWORD length = 0;
+        GetLogicalProcessorInformation(nullptr, &length);
+        std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        if (!info.empty() && GetLogicalProcessorInformation(info.data(), &length)) {
+            int core = 0, package = 0;
+            std::vector<int> coreOf(64, -1), packageOf(64, 0), nodeOf(64, 0);
+            for (const auto& item : info) {
+                for (int id = 0; id < 64; ++id) {
+                    if (!(item.ProcessorMask & (ULONG_PTR(1) << id))) continue;
+                    if (item.Relationship == RelationProcessorCore) coreOf[id] = core;
+                    else if (item.Relationship == RelationProcessorPackage) packageOf[id] = package;
+                    else if (item.Relationship == RelationNumaNode) nodeOf[id] = int(item.NumaNode.NodeNumber);
+                }
+                if (item.Relationship == RelationProcessorCore) core++;
+                else if (item.Relationship == RelationProcessorPackage) package++;
+            }
+            for (int id = 0; id < 64; ++id)
+                if (coreOf[id] >= 0) result.push_back({id, coreOf[id], packageOf[id], nodeOf[id]});
+        }
+#endif
+        if (result.empty()) {
+            int count = std::max(1u, std::thread::hardware_concurrency());
+            for (int id = 0; id < count; ++id) result.push_back({id, id, 0, 0});
+        }
+        return result;
+    }();
+    return cpus;
+}
+
+// 一个渲染线程的位置：绑定的逻辑核（-1 表示不绑定）和领取 tile 的分组
+struct WorkerSlot {
+    int cpu;
+    int group;
+};
+
+// 按策略安排渲染线程，maxThreads > 0 时最多使用这么多线程。
+// 同组线程从同一段连续的 tile 中领取：SMT 策略下一组是一个物理核，NUMA 策略下一组是一个节点
+inline std::vector<WorkerSlot> planWorkers(PlacementPolicy policy, int maxThreads = 0) {
+    std::vector<LogicalCpu> cpus = cpuTopology();
+    std::vector<WorkerSlot> slots;
+    if (policy == PLACEMENT_NONE) {
+        int count = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < count; ++i) slots.push_back({-1, 0});
+    } else {
+        // 按 节点、插槽、物理核 排序，同一物理核的超线程相邻
+        std::stable_sort(cpus.begin(), cpus.end(), [](const LogicalCpu& a, const LogicalCpu& b) {
+            if (a.node != b.node) return a.node < b.node;
+            if (a.package != b.package) return a.package < b.package;
+            return a.core < b.core;
+        });
+        if (policy == PLACEMENT_PHYSICAL) {
+            for (size_t i = 0; i < cpus.size(); ++i)
+                if (i == 0 || cpus[i].core != cpus[i - 1].core || cpus[i].package != cpus[i - 1].package)
+                    slots.push_back({cpus[i].id, 0});
+        } else {
+            // 线程数受限时，先在每个组各放一个线程，再补齐同组的其余线程，使负载分布到所有组上
+            std::vector<int> group(cpus.size(), 0);
+            for (size_t i = 1; i < cpus.size(); ++i) {
+                bool same = policy == PLACEMENT_SMT
+                    ? cpus[i].core == cpus[i - 1].core && cpus[i].package == cpus[i - 1].package && cpus[i].node == cpus[i - 1].node
+                    : cpus[i].node == cpus[i - 1].node;
+                group[i] = group[i - 1] + (same ? 0 : 1);
+            }
+            for (size_t i = 0; i < cpus.size(); ++i) slots.push_back({cpus[i].id, group[i]});
+            if (maxThreads > 0 && maxThreads < (int)slots.size()) {
+                // 依次取每组的第 k 个线程
+                std::vector<WorkerSlot> spread;
+                for (int k = 0; spread.size() < slots.size(); ++k) {
+                    int rank = 0;
+                    for (size_t i = 0; i < slots.size(); ++i) {
+                        rank = (i > 0 && slots[i].group == slots[i - 1].group) ? rank + 1 : 0;
+                        if (rank == k) spread.push_back(slots[i]);
+                    }
+                }
+                slots = spread;
+            }
+        }
+    }
+    if (maxThreads > 0 && maxThreads < (int)slots.size()) slots.resize(maxThreads);
+    return slots;
+}
+
+// 把当前线程绑定到一个逻辑核
+inline bool pinCurrentThread(int cpu) {
+    if (cpu < 0) return false;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    return cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+    return false;
+#endif
+}
+
+// resize() 时不做值初始化的分配器。帧缓冲的页面因此在渲染线程第一次写入时才分配，
+// 在 NUMA 系统上落在写入它的线程所在的节点上（first-touch）。
+// 只适合随后被整帧写满的缓冲区（动画的帧槽位等）；可能显示未渲染 tile 的交互画面需要显式清零
+template <typename T>
+struct DefaultInitAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind { typedef DefaultInitAllocator<U> other; };
+
+    DefaultInitAllocator() = default;
+    template <typename U>
+    DefaultInitAllocator(const DefaultInitAllocator<U>&) {}
+
+    template <typename U>
+    void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+};
+
+typedef std::vector<unsigned char, DefaultInitAllocator<unsigned char>> PixelBuffer;
+#endif
@@ -0,0 +1,104 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+// 混合渲染的可见性阶段：主光线的第一个交点不再逐条光线遍历加速结构，而是按物体顺序在 tile 内光栅化，
+// 相当于 GPU 上用包围矩形绘制球体 impostor、在片元中解析求交再做深度测试。
+// 每个候选物体只遍历它在屏幕上的投影范围（TileBins 中的矩形），深度缓冲保留最近交点，
+// 得到与光线追踪相同的 (物体, t, 法线)，之后只从这些命中点追踪阴影和反射光线
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+#include "material.h"
+#include "tile.h"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+// 一个 tile 的可见性缓冲：每个像素的主光线方向、最近交点距离、物体和法线
+struct TileVisibility {
+    int x0 = 0, y0 = 0, width = 0, height = 0;
+    std::vector<vec3a> direction;
+    std::vector<float> depth;
+    std::vector<const Object*> object;
+    std::vector<vec3a> normal;
+
+    void reset(const CameraFrame& frame, int tx0, int ty0, int tx1, int ty1) {
+        x0 = tx0;
+        y0 = ty0;
+        width = tx1 - tx0;
+        height = ty1 - ty0;
+        direction.resize(width * height);
+        for (int y = ty0; y < ty1; ++y)
+            for (int x = tx0; x < tx1; ++x)
+                direction[(y - ty0) * width + (x - tx0)] = frame.primaryRay(x + 0.5f, y + 0.5f).direction;
+        depth.assign(width * height, std::numeric_limits<float>::max());
+        object.assign(width * height, nullptr);
+        normal.resize(width * height);
+    }
+};
+
+// 在像素范围 [px0, px1) x [py0, py1) 内光栅化一个物体。T 为物体的实际类型，
+// 直接调用 T::intersect（没有虚函数分派，球和墙面的求交可以内联进循环；T 为 Object 时走虚函数），
+// 交点与光线追踪逐位相同；t > 0.001 的判定与加速结构一致
+template <typename T>
+inline void rasterObject(TileVisibility& vis, const CameraFrame& frame, const T& object, int px0, int py0, int px1, int py1,
+                         const std::vector<char>* mask) {
+    Ray ray;
+    ray.origin = toAligned(frame.position);
+    for (int y = py0; y < py1; ++y) {
+        for (int x = px0; x < px1; ++x) {
+            if (mask && !(*mask)[y * frame.width + x]) continue;
+            int i = (y - vis.y0) * vis.width + (x - vis.x0);
+            ray.direction = vis.direction[i];
+            float t;
+            vec3a normal;
+            bool found;
+            if constexpr (std::is_same_v<T, Object>) found = object.intersect(ray, t, normal);
+            else found = object.T::intersect(ray, t, normal);
+            if (!found || t <= 0.001f || t >= vis.depth[i]) continue;
+            vis.depth[i] = t;
+            vis.object[i] = &object;
+            vis.normal[i] = normal;
+        }
+    }
+}
+
+// 光栅化 tile [x0, x1) x [y0, y1) 内的候选物体，按物体顺序做深度测试（相同深度保留靠前的物体，
+// 与逐个遍历物体求交一致），再把命中写成第一层的 HitRecord。mask 非空时只处理其中标记的像素
+inline void rasterizeTile(std::vector<HitRecord>& hits, TileVisibility& vis, const CameraFrame& frame, const TileCandidates& candidates,
+                          int x0, int y0, int x1, int y1, const std::vector<char>* mask) {
+    vis.reset(frame, x0, y0, x1, y1);
+    for (size_t k = 0; k < candidates.count; ++k) {
+        // 投影矩形含 1 像素余量，像素中心落在矩形内的像素才可能被覆盖
+        const ScreenRect& r = candidates.rects[k];
+        int px0 = std::max(x0, int(std::floor(r.x0)));
+        int py0 = std::max(y0, int(std::floor(r.y0)));
+        int px1 = std::min(x1, int(std::ceil(r.x1)));
+        int py1 = std::min(y1, int(std::ceil(r.y1)));
+        if (px0 >= px1 || py0 >= py1) continue;
+
+        const Object* object = candidates.objects[k];
+        if (const Sphere* sphere = dynamic_cast<const Sphere*>(object))
+            rasterObject(vis, frame, *sphere, px0, py0, px1, py1, mask);
+        else if (const Wall* wall = dynamic_cast<const Wall*>(object))
+            rasterObject(vis, frame, *wall, px0, py0, px1, py1, mask);
+        else
+            rasterObject(vis, frame, *object, px0, py0, px1, py1, mask);
+    }
+
+    hits.clear();
+    vec3a origin = toAligned(frame.position);
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            int i = (y - y0) * vis.width + (x - x0);
+            if (!vis.object[i]) continue;
+            hits.push_back({origin + vis.depth[i] * vis.direction[i], vis.normal[i], vis.direction[i],
+                            vec3a(1.0f), vis.object[i], i});
+        }
+    }
+}
+#endif
@@ -0,0 +1,141 @@
+#ifndef REPROJECTION_H
+#define REPROJECTION_H
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+#include "tile.h"
+#include "tracer.h"
+
+#include <vector>
+#include <limits>
+
+// 时域重投影缓存：保存上一帧每个像素的命中位置、法线和着色结果。
+// 只有相机移动时，把上一帧的命中点投影到新视角下复用，
+// 只重新追踪没有有效样本（被遮挡后重新露出、移出画面等）的像素，
+// 外加每帧按比例轮换刷新的一部分像素，以逐步修正随视角变化的高光和反射
+class ReprojectionCache {
+public:
+    bool enabled = true;
+    float refreshFraction = 0.05f;  // 每帧强制重新追踪的像素比例
+    float depthTolerance = 0.05f;   // 与 3x3 邻域最近深度的相对差超过此值视为背景透过前景的空洞
+    float minFacing = 0.05f;        // 法线与新视线夹角余弦的下限，过于掠射或背向的表面不复用
+    float maxViewChange = 0.2f;     // 同一点新旧视线夹角余弦的最大减小量，限制高光的失真
+
+    void invalidate() {
+        valid = false;
+    }
+
+    // 保存本帧结果，作为下一帧重投影的来源
+    void store(const PixelBuffer& pixels, const GBuffer& gbuffer, const Camera& camera) {
+        prevPixels = pixels;
+        prevGBuffer = gbuffer;
+        prevCamera = camera;
+        valid = true;
+    }
+
+    // 把上一帧重投影到 camera 视角下，直接写入 pixels 和 gbuffer；
+    // mask 中标记需要重新追踪的像素，返回其数量。无法重投影时返回 -1
+    int reproject(const Camera& camera, int width, int height, PixelBuffer& pixels,
+                  GBuffer& gbuffer, std::vector<char>& mask) {
+        if (!enabled || !valid || prevGBuffer.width != width || prevGBuffer.height != height) return -1;
+        frameIndex++;
+
+        CameraFrame frame(camera, width, height);
+        int count = width * height;
+        depth.assign(count, std::numeric_limits<float>::max());
+        source.assign(count, -1);
+
+        // 前向投影：每个旧样本落到新画面中的一个像素，深度近者优先
+        for (int i = 0; i < count; ++i) {
+            if (!prevGBuffer.hit[i]) continue;
+            const glm::vec3& p = prevGBuffer.position[i];
+            const glm::vec3& n = prevGBuffer.normal[i];
+            glm::vec3 toCamera = camera.position - p;
+            float distance = glm::length(toCamera);
+            if (glm::dot(n, toCamera) < minFacing * distance) continue;
+
+            // 视角变化过大时高光和反射会明显错误
+            glm::vec3 toPrevCamera = glm::normalize(prevCamera.position - p);
+            if (glm::dot(toPrevCamera, toCamera / distance) < 1.0f - maxViewChange) continue;
+
+            glm::vec3 q = frame.project(p);
+            if (q.z <= 1e-3f) continue;
+            int x = int(std::floor(q.x)), y = int(std::floor(q.y));
+            if (x < 0 || y < 0 || x >= width || y >= height) continue;
+            int j = y * width + x;
+            if (distance < depth[j]) {
+                depth[j] = distance;
+                source[j] = i;
+            }
+        }
+
+        // 深度测试：样本明显比邻域内最近的样本远，说明它来自被前景挡住的背景
+        mask.assign(count, 0);
+        int retrace = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                int j = y * width + x;
+                bool reuse = source[j] >= 0;
+                if (reuse) {
+                    float nearest = depth[j];
+                    for (int dy = -1; dy <= 1; ++dy)
+                        for (int dx = -1; dx <= 1; ++dx) {
+                            int nx = x + dx, ny = y + dy;
+                            if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                            nearest = std::min(nearest, depth[ny * width + nx]);
+                        }
+                    reuse = depth[j] <= nearest * (1.0f + depthTolerance);
+                }
+                // 按像素和帧号散列，轮换刷新一部分像素
+                if (reuse && hash(x, y, frameIndex) < refreshFraction) reuse = false;
+
+                if (reuse) {
+                    int i = source[j];
+                    for (int c = 0; c < 3; ++c) pixels[j * 3 + c] = prevPixels[i * 3 + c];
+                    gbuffer.position[j] = prevGBuffer.position[i];
+                    gbuffer.normal[j] = prevGBuffer.normal[i];
+                    gbuffer.hit[j] = 1;
+                } else {
+                    mask[j] = 1;
+                    retrace++;
+                }
+            }
+        }
+        return retrace;
+    }
+
+private:
+    bool valid = false;
+    unsigned int frameIndex = 0;
+    PixelBuffer prevPixels;
+    GBuffer prevGBuffer;
+    Camera prevCamera;
+    std::vector<float> depth;
+    std::vector<int> source;
+
+    static float hash(int x, int y, unsigned int frame) {
+        unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ frame * 83492791u;
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        h ^= h >> 15;
+        return (h & 0xffffff) / float(0x1000000);
+    }
+};
+
+// mask 中含有待追踪像素的 tile
+inline std::vector<int> tilesInMask(const std::vector<char>& mask, int width, int height) {
+    TileGrid grid(width, height);
+    std::vector<int> tiles;
+    for (int t = 0; t < grid.count(); ++t) {
+        int x0, y0, x1, y1;
+        grid.bounds(t, x0, y0, x1, y1);
+        bool any = false;
+        for (int y = y0; y < y1 && !any; ++y)
+            for (int x = x0; x < x1 && !any; ++x)
+                any = mask[y * width + x] != 0;
+        if (any) tiles.push_back(t);
+    }
+    return tiles;
+}
+#endif
@@ -0,0 +1,173 @@
+#ifndef SCALING_H
+#define SCALING_H
+
+#include <glm/glm.hpp>
+
+#include "tile.h"
+#include "placement.h"
+
+#include <vector>
+#include <algorithm>
+
+// tiles 覆盖的像素数
+inline long long tilePixels(const TileGrid& grid, const std::vector<int>& tiles) {
+    long long pixels = 0;
+    for (int t : tiles) {
+        int x0, y0, x1, y1;
+        grid.bounds(t, x0, y0, x1, y1);
+        pixels += (long long)(x1 - x0) * (y1 - y0);
+    }
+    return pixels;
+}
+
+// 一帧实际追踪的像素数：tiles 中除 unfinished 外的 tile，mask 非空时只计其中标记的像素
+inline long long tracedPixels(const TileGrid& grid, const std::vector<int>& tiles, const std::vector<int>& unfinished,
+                              const std::vector<char>* mask) {
+    std::vector<char> skipped(grid.count(), 0);
+    for (int t : unfinished) skipped[t] = 1;
+    long long pixels = 0;
+    for (int t : tiles) {
+        if (skipped[t]) continue;
+        int x0, y0, x1, y1;
+        grid.bounds(t, x0, y0, x1, y1);
+        if (!mask) {
+            pixels += (long long)(x1 - x0) * (y1 - y0);
+            continue;
+        }
+        for (int y = y0; y < y1; ++y)
+            for (int x = x0; x < x1; ++x)
+                pixels += (*mask)[size_t(y) * grid.width + x] != 0;
+    }
+    return pixels;
+}
+
+// 帧时限驱动的采样密度：交互过程中（相机、光源或物体每帧都在变化）按测得的每像素耗时，
+// 选出能在时限内完成的稀疏采样级别，只追踪一部分像素，其余像素由相邻的样本填充；
+// 停止交互后再以全分辨率重绘这些 tile。
+// 级别 0 为全分辨率，1 为棋盘格（1/2 的像素），k >= 2 为每 2^(k-1) x 2^(k-1) 的块追踪中心一个像素。
+// 块的边长整除 TILE_SIZE，每个 tile 独立采样和填充，只重绘部分 tile 时也不会越界
+class ResolutionScaler {
+public:
+    float deadlineMs = 0.0f;    // 交互时每帧的目标耗时，0 表示不降低采样密度
+    int level = 0;              // 最近一帧使用的级别
+
+    static int maxLevel() {
+        int k = 1;
+        while ((1 << k) <= TILE_SIZE) ++k;
+        return k; // 块边长等于 TILE_SIZE 时每个 tile 只追踪一个像素
+    }
+
+    // 级别 k 下追踪的像素比例
+    static double fraction(int k) {
+        if (k == 0) return 1.0;
+        if (k == 1) return 0.5;
+        int block = 1 << (k - 1);
+        return 1.0 / (double(block) * block);
+    }
+
+    static const char* levelName(int k) {
+        static const char* names[] = {"full", "checkerboard", "1/4", "1/16", "1/64", "1/256", "1/1024"};
+        return k < int(sizeof(names) / sizeof(names[0])) ? names[k] : "sparse";
+    }
+
+    // 为即将追踪的 pixels 个像素选择级别：估计耗时不超过时限的最小级别，
+    // 还没有测量数据时使用全分辨率
+    int choose(long long pixels) {
+        level = 0;
+        if (deadlineMs <= 0.0f || msPerPixel <= 0.0) return level;
+        while (level < maxLevel() && msPerPixel * pixels * fraction(level) > deadlineMs) ++level;
+        return level;
+    }
+
+    // 记录一帧的渲染耗时和实际追踪的像素数，更新每像素耗时的滑动平均。
+    // 像素太少的帧主要是线程启动等固定开销，不计入
+    void record(double ms, long long tracedPixels) {
+        if (tracedPixels < TILE_SIZE * TILE_SIZE * 4) return;
+        double sample = ms / tracedPixels;
+        msPerPixel = msPerPixel > 0.0 ? 0.7 * msPerPixel + 0.3 * sample : sample;
+    }
+
+    // 级别 k 下 tile 内需要追踪的像素写入 mask（其余 tile 的像素不修改）
+    void buildMask(std::vector<char>& mask, const TileGrid& grid, const std::vector<int>& tiles, int k) const {
+        mask.assign(size_t(grid.width) * grid.height, 0);
+        for (int t : tiles) {
+            int x0, y0, x1, y1;
+            grid.bounds(t, x0, y0, x1, y1);
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x)
+                    mask[size_t(y) * grid.width + x] = sampled(x, y, x1, y1, k);
+        }
+    }
+
+    // 用级别 k 的样本填充 tiles 中没有追踪的像素：棋盘格取左右相邻样本的平均，块取块内的样本
+    void upsample(PixelBuffer& pixels, const TileGrid& grid, const std::vector<int>& tiles, int k) const {
+        for (int t : tiles) {
+            int x0, y0, x1, y1;
+            grid.bounds(t, x0, y0, x1, y1);
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x) {
+                    if (sampled(x, y, x1, y1, k)) continue;
+                    unsigned char* p = pixels.data() + (size_t(y) * grid.width + x) * 3;
+                    if (k == 1) {
+                        const unsigned char* left = x > x0 ? p - 3 : p + 3;
+                        const unsigned char* right = x + 1 < x1 ? p + 3 : p - 3;
+                        for (int c = 0; c < 3; ++c) p[c] = (unsigned char)((left[c] + right[c] + 1) / 2);
+                    } else {
+                        int sx, sy;
+                        blockSample(x, y, x1, y1, k, sx, sy);
+                        const unsigned char* s = pixels.data() + (size_t(sy) * grid.width + sx) * 3;
+                        p[0] = s[0];
+                        p[1] = s[1];
+                        p[2] = s[2];
+                    }
+                }
+            }
+        }
+    }
+
+    // 渲染结束后调用：tiles 中除 unfinished 外的 tile 已用级别 k 渲染，k > 0 的 tile 等待全分辨率重绘
+    void rendered(const TileGrid& grid, const std::vector<int>& tiles, const std::vector<int>& unfinished, int k) {
+        level = k;
+        if (int(coarse.size()) != grid.count()) coarse.assign(grid.count(), 0);
+        std::vector<char> skipped(grid.count(), 0);
+        for (int t : unfinished) skipped[t] = 1;
+        for (int t : tiles)
+            if (!skipped[t]) coarse[t] = k > 0;
+    }
+
+    // 追加等待全分辨率重绘的 tile（已在 tiles 中的不重复追加）
+    void appendCoarse(std::vector<int>& tiles, const TileGrid& grid) const {
+        if (int(coarse.size()) != grid.count()) return;
+        std::vector<char> listed(grid.count(), 0);
+        for (int t : tiles) listed[t] = 1;
+        for (int t = 0; t < grid.count(); ++t)
+            if (coarse[t] && !listed[t]) tiles.push_back(t);
+    }
+
+    // 画面尺寸变化后整帧重绘，原先的标记失效
+    void clear() {
+        coarse.clear();
+    }
+
+private:
+    double msPerPixel = 0.0;    // 每个追踪像素的平均耗时
+    std::vector<char> coarse;   // 以降低的密度渲染、还没有全分辨率重绘的 tile
+
+    // 块的样本取块中心，块被 tile 的右上边界截断时取截断后的中心
+    static void blockSample(int x, int y, int x1, int y1, int k, int& sx, int& sy) {
+        int block = 1 << (k - 1);
+        int bx = x - x % block, by = y - y % block;
+        sx = (bx + std::min(bx + block, x1)) / 2;
+        sy = (by + std::min(by + block, y1)) / 2;
+    }
+
+    static bool sampled(int x, int y, int x1, int y1, int k) {
+        if (k == 0) return true;
+        if (k == 1) return ((x + y) & 1) == 0;
+        int sx, sy;
+        blockSample(x, y, x1, y1, k, sx, sy);
+        return x == sx && y == sy;
+    }
+};
+ResolutionScaler resolutionScaler;
+#endif
@@ -0,0 +1,125 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <glm/glm.hpp>
+
+#include "tile.h"
+#include "placement.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// 有时间预算时 tile 的渲染顺序。预算用完后剩下的 tile 保留旧的结果、留到下一帧，
+// 因此先渲染的区域先收敛；优先级每帧按当前的光标位置和上一次的渲染结果重新计算
+enum TilePriority {
+    PRIORITY_SCANLINE,  // 按 tile 编号，即从画面底部逐行向上
+    PRIORITY_CURSOR,    // 离鼠标光标越近越先渲染
+    PRIORITY_CENTER,    // 离画面中心越近越先渲染
+    PRIORITY_VARIANCE,  // 上一次渲染结果中亮度方差越大（边缘、高光、反射）越先渲染
+    PRIORITY_COUNT
+};
+const char* const priorityNames[PRIORITY_COUNT] = {"scanline", "cursor", "center", "variance"};
+
+// tile 内像素亮度的方差
+inline float tileVariance(const PixelBuffer& pixels, const TileGrid& grid, int tile) {
+    int x0, y0, x1, y1;
+    grid.bounds(tile, x0, y0, x1, y1);
+    double sum = 0.0, sum2 = 0.0;
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            const unsigned char* p = pixels.data() + (size_t(y) * grid.width + x) * 3;
+            double l = (0.2126 * p[0] + 0.7152 * p[1] + 0.0722 * p[2]) / 255.0;
+            sum += l;
+            sum2 += l * l;
+        }
+    }
+    double n = double(x1 - x0) * (y1 - y0);
+    double mean = sum / n;
+    return float(std::max(sum2 / n - mean * mean, 0.0));
+}
+
+class TileScheduler {
+public:
+    TilePriority priority = PRIORITY_CURSOR;
+    glm::vec2 focus = glm::vec2(-1.0f); // 光标的像素坐标（第 0 行在画面底部），在画面外时按画面中心
+    int maxAge = 8;                     // 在队列中等待超过这么多帧的 tile 不再参与排序，直接排在最前
+
+    // 上一帧没有渲染完的 tile
+    const std::vector<int>& pending() const { return waiting; }
+
+    void clear() {
+        waiting.clear();
+    }
+
+    // 把上一帧遗留的 tile 追加到 tiles（已在其中的不重复追加）
+    void appendPending(std::vector<int>& tiles, const TileGrid& grid) const {
+        std::vector<char> listed(grid.count(), 0);
+        for (int t : tiles) listed[t] = 1;
+        for (int t : waiting)
+            if (t < grid.count() && !listed[t]) tiles.push_back(t);
+    }
+
+    // 把本帧需要渲染的 tiles 与上一帧遗留的 tile 合并去重，按优先级从高到低排序
+    std::vector<int> order(const std::vector<int>& tiles, const TileGrid& grid) {
+        resize(grid);
+
+        std::vector<char> queued(grid.count(), 0);
+        std::vector<int> result;
+        for (int t : waiting) {
+            queued[t] = 1;
+            result.push_back(t);
+        }
+        for (int t : tiles) {
+            if (queued[t]) continue;
+            queued[t] = 1;
+            age[t] = 0;
+            result.push_back(t);
+        }
+
+        glm::vec2 target = focus;
+        if (priority == PRIORITY_CENTER || target.x < 0.0f || target.y < 0.0f || target.x > grid.width || target.y > grid.height)
+            target = 0.5f * glm::vec2(grid.width, grid.height);
+        std::vector<float> score(grid.count(), 0.0f);
+        for (int t : result) {
+            int x0, y0, x1, y1;
+            grid.bounds(t, x0, y0, x1, y1);
+            glm::vec2 center = 0.5f * glm::vec2(x0 + x1, y0 + y1);
+            if (priority == PRIORITY_SCANLINE) score[t] = -float(t);
+            else if (priority == PRIORITY_VARIANCE) score[t] = variance[t] < 0.0f ? 1e30f : variance[t]; // 从未渲染过的最先
+            else score[t] = -glm::length(center - target);
+            if (age[t] >= maxAge) score[t] = 2e30f + age[t];
+        }
+        std::stable_sort(result.begin(), result.end(), [&](int a, int b) { return score[a] > score[b]; });
+        return result;
+    }
+
+    // 渲染结束后调用：tiles 为 order() 的结果，unfinished 为其中预算内没有渲染的 tile。
+    // 记录已渲染 tile 的亮度方差，未渲染的 tile 留到下一帧
+    void finish(const std::vector<int>& tiles, const std::vector<int>& unfinished, const PixelBuffer& pixels, const TileGrid& grid) {
+        resize(grid);
+        std::vector<char> skipped(grid.count(), 0);
+        for (int t : unfinished) skipped[t] = 1;
+        for (int t : tiles)
+            if (!skipped[t]) variance[t] = tileVariance(pixels, grid, t);
+        waiting = unfinished;
+        for (int t : waiting) age[t]++;
+    }
+
+private:
+    std::vector<int> waiting;       // 上一帧遗留的 tile
+    std::vector<int> age;           // 每个 tile 已经等待的帧数
+    std::vector<float> variance;    // 每个 tile 最近一次渲染结果的亮度方差，-1 表示还没有渲染过
+    int tilesX = 0;
+
+    // 画面尺寸变化后清空所有记录
+    void resize(const TileGrid& grid) {
+        if (int(age.size()) == grid.count() && tilesX == grid.tilesX) return;
+        tilesX = grid.tilesX;
+        age.assign(grid.count(), 0);
+        variance.assign(grid.count(), -1.0f);
+        waiting.clear();
+    }
+};
+TileScheduler tileScheduler;
+#endif
@@ -14,6 +14,8 @@ class Shader
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // a compute program is built when vertexPath and fragmentPath are null and computePath is given
+    // (a compute shader cannot be linked together with graphics stages)
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char *computePath = nullptr)
     {
@@ -33,19 +35,22 @@ public:
         cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
         try 
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
+            if(vertexPath != nullptr)
+            {
+                // open files
+                vShaderFile.open(vertexPath);
+                fShaderFile.open(fragmentPath);
+                std::stringstream vShaderStream, fShaderStream;
+                // read file's buffer contents into streams
+                vShaderStream << vShaderFile.rdbuf();
+                fShaderStream << fShaderFile.rdbuf();		
+                // close file handlers
+                vShaderFile.close();
+                fShaderFile.close();
+                // convert stream into string
+                vertexCode = vShaderStream.str();
+                fragmentCode = fShaderStream.str();			
+            }
             // if geometry shader path is present, also load a geometry shader
             if(geometryPath != nullptr)
             {
@@ -71,19 +76,22 @@ public:
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        unsigned int vertex = 0, fragment = 0;
+        if(vertexPath != nullptr)
+        {
+            // vertex shader
+            vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertex, 1, &vShaderCode, NULL);
+            glCompileShader(vertex);
+            checkCompileErrors(vertex, "VERTEX");
+            // fragment Shader
+            fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fShaderCode, NULL);
+            glCompileShader(fragment);
+            checkCompileErrors(fragment, "FRAGMENT");
+        }
         // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
+        unsigned int geometry = 0;
         if(geometryPath != nullptr)
         {
             const char * gShaderCode = geometryCode.c_str();
@@ -92,11 +100,10 @@ public:
             glCompileShader(geometry);
             checkCompileErrors(geometry, "GEOMETRY");
         }
-        unsigned int compute;
+        unsigned int compute = 0;
         if(computePath != nullptr)
         {
             const char * cShaderCode = computeCode.c_str();
-            unsigned int compute;
             compute = glCreateShader(GL_COMPUTE_SHADER);
             glShaderSource(compute, 1, &cShaderCode, NULL);
             glCompileShader(compute);
@@ -105,8 +112,11 @@ public:
 
         // shader Program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
+        if(vertexPath != nullptr)
+        {
+            glAttachShader(ID, vertex);
+            glAttachShader(ID, fragment);
+        }
         if(geometryPath != nullptr)
             glAttachShader(ID, geometry);
         if(computePath != nullptr)
@@ -115,8 +125,11 @@ public:
         checkCompileErrors(ID, "PROGRAM");
 
         // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        if(vertexPath != nullptr)
+        {
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+        }
         if(geometryPath != nullptr)
             glDeleteShader(geometry);
         if(computePath != nullptr)
@@ -140,6 +153,11 @@ public:
         glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
     }
     // ------------------------------------------------------------------------
+    void setIVec2(const std::string &name, int x, int y) const
+    { 
+        glUniform2i(glGetUniformLocation(ID, name.c_str()), x, y); 
+    }
+    // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
         glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
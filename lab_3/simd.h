@@ -0,0 +1,51 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// 热路径（光线、求交、着色）使用的三维向量类型。
+// 默认构建中 vec3a 就是 glm::vec3（12 字节，GLM 按分量逐个计算）；
+// 定义 LAB3_SIMD 并开启 GLM 的 intrinsic 路径时，vec3a 为 16 字节对齐的 aligned_vec4，w 分量保持为 0，
+// 加减乘、dot、length、normalize、reflect 都走 include/glm/simd 中的 SSE 实现，值可以一直留在 XMM 寄存器中。
+// GLM 的配置宏必须在第一次包含 glm 之前定义，因此由命令行给出，见 .vscode/tasks.json 中的 SIMD 构建任务：
+//     -DLAB3_SIMD -DGLM_FORCE_INTRINSICS -DGLM_FORCE_ALIGNED_GENTYPES -msse4.1
+// 网格文件、BVH 节点、G-buffer 等存储格式仍使用 glm::vec3，在边界处用 toAligned / toVec3 转换
+
+#include <glm/glm.hpp>
+
+#ifdef LAB3_SIMD
+#if GLM_CONFIG_SIMD != GLM_ENABLE || GLM_CONFIG_ALIGNED_GENTYPES != GLM_ENABLE || !(GLM_ARCH & GLM_ARCH_SSE2_BIT)
+#error "LAB3_SIMD 需要在命令行定义 GLM_FORCE_INTRINSICS 和 GLM_FORCE_ALIGNED_GENTYPES，并且目标平台支持 SSE2"
+#endif
+#include <glm/gtc/type_aligned.hpp>
+
+typedef glm::aligned_vec4 vec3a;
+
+inline vec3a toAligned(const glm::vec3& v) {
+    return vec3a(v, 0.0f);
+}
+
+// 叉积：w 分量的乘积相减后仍为 0
+inline vec3a cross3(const vec3a& a, const vec3a& b) {
+    vec3a result;
+    result.data = glm_vec4_cross(a.data, b.data);
+    return result;
+}
+
+const char* const simdBuildName = "simd (aligned vec4, GLM intrinsics)";
+#else
+typedef glm::vec3 vec3a;
+
+inline vec3a toAligned(const glm::vec3& v) {
+    return v;
+}
+
+inline vec3a cross3(const vec3a& a, const vec3a& b) {
+    return glm::cross(a, b);
+}
+
+const char* const simdBuildName = "scalar (vec3)";
+#endif
+
+inline glm::vec3 toVec3(const vec3a& v) {
+    return glm::vec3(v);
+}
+#endif
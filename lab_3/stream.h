@@ -0,0 +1,401 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+// 远程查看：渲染机以 --serve 无窗口运行，把画面通过 TCP 推送给 --connect 启动的查看端，
+// 查看端的控制面板修改（相机、光源、球体参数、窗口尺寸）再发回渲染机。
+// 每帧只发送内容有变化的 tile：与查看端已有的画面逐字节异或，未变化的 tile 异或结果全为 0，直接跳过；
+// 变化的 tile 把异或结果按像素做 PackBits 式的行程编码，大片未变化或颜色相同的区域只占几个字节。
+// 两端假定为同一字节序（x86），消息体直接按内存布局收发
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+#include "tile.h"
+#include "placement.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+const SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+typedef int SocketHandle;
+const SocketHandle INVALID_SOCKET_HANDLE = -1;
+#endif
+
+// 消息类型，每条消息由 MessageHeader 和 size 字节的消息体组成
+enum StreamMessage : uint32_t {
+    MESSAGE_FRAME = 1,  // 渲染机 -> 查看端：FrameHeader + 若干个 (TileHeader + 编码数据)
+    MESSAGE_VIEW,       // 查看端 -> 渲染机：ViewState
+    MESSAGE_SPHERE,     // 查看端 -> 渲染机：SphereEdit
+};
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t size;
+};
+
+// FrameHeader::flags
+enum FrameFlags : uint32_t {
+    FRAME_KEYFRAME = 1,     // 差异按全黑画面计算，查看端应用前先把画面清零
+};
+
+struct FrameHeader {
+    uint32_t width, height;
+    uint32_t frame;         // 帧编号
+    uint32_t tileCount;     // 本帧发送的 tile 数
+    uint32_t flags;
+};
+
+struct TileHeader {
+    uint32_t tile;
+    uint32_t size;          // 编码后的字节数
+};
+
+// 查看端的相机、光源和窗口尺寸
+struct ViewState {
+    Camera camera;
+    Light light;
+    int32_t width, height;
+};
+
+// 查看端修改了第 index 个球
+struct SphereEdit {
+    int32_t index;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 color;
+    float reflectivity;
+    int32_t material;
+};
+
+// 远程画面的最大边长，超出范围的尺寸来自损坏或恶意的消息
+const int MAX_STREAM_SIZE = 8192;
+
+inline bool validStreamSize(int width, int height) {
+    return width >= 1 && width <= MAX_STREAM_SIZE && height >= 1 && height <= MAX_STREAM_SIZE;
+}
+
+// 每种消息体允许的最大字节数，receive 在分配缓冲区之前检查，未知类型为 0
+inline size_t maxMessageSize(uint32_t type) {
+    switch (type) {
+    case MESSAGE_FRAME: {
+        // 最坏情况下每个像素 3 字节原样保存，每 128 个像素 1 个控制字节，另加每个 tile 的 TileHeader
+        size_t pixels = size_t(MAX_STREAM_SIZE) * MAX_STREAM_SIZE;
+        size_t tiles = size_t((MAX_STREAM_SIZE + TILE_SIZE - 1) / TILE_SIZE) * ((MAX_STREAM_SIZE + TILE_SIZE - 1) / TILE_SIZE);
+        return sizeof(FrameHeader) + pixels * 3 + pixels / 128 + tiles * (sizeof(TileHeader) + 1);
+    }
+    case MESSAGE_VIEW: return sizeof(ViewState);
+    case MESSAGE_SPHERE: return sizeof(SphereEdit);
+    default: return 0;
+    }
+}
+
+// 程序中第一次使用套接字之前调用（Windows 需要初始化 Winsock）
+inline bool netInit() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+inline void closeSocket(SocketHandle s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+// 关闭 Nagle 算法：控制消息很小，需要立即发出
+inline void setNoDelay(SocketHandle s) {
+    int flag = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&flag, sizeof(flag));
+}
+
+// 在 port 上监听（0 表示由系统分配），实际端口写回 port
+inline SocketHandle listenOn(int& port) {
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET_HANDLE) return s;
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(uint16_t(port));
+    socklen_t length = sizeof(addr);
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 1) != 0 ||
+        getsockname(s, (sockaddr*)&addr, &length) != 0) {
+        closeSocket(s);
+        return INVALID_SOCKET_HANDLE;
+    }
+    port = ntohs(addr.sin_port);
+    return s;
+}
+
+inline SocketHandle acceptClient(SocketHandle listener) {
+    SocketHandle s = accept(listener, nullptr, nullptr);
+    if (s != INVALID_SOCKET_HANDLE) setNoDelay(s);
+    return s;
+}
+
+inline SocketHandle connectTo(const std::string& host, int port) {
+    addrinfo hints = {}, *result = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) return INVALID_SOCKET_HANDLE;
+    SocketHandle s = INVALID_SOCKET_HANDLE;
+    for (addrinfo* p = result; p; p = p->ai_next) {
+        s = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (s == INVALID_SOCKET_HANDLE) continue;
+        if (connect(s, p->ai_addr, int(p->ai_addrlen)) == 0) break;
+        closeSocket(s);
+        s = INVALID_SOCKET_HANDLE;
+    }
+    freeaddrinfo(result);
+    if (s != INVALID_SOCKET_HANDLE) setNoDelay(s);
+    return s;
+}
+
+// 一条 TCP 连接上的消息收发
+class StreamConnection {
+public:
+    StreamConnection() {}
+    explicit StreamConnection(SocketHandle s) : s(s) {}
+    ~StreamConnection() { close(); }
+    StreamConnection(const StreamConnection&) = delete;
+    StreamConnection& operator=(const StreamConnection&) = delete;
+
+    bool open() const { return s != INVALID_SOCKET_HANDLE; }
+
+    void attach(SocketHandle socket) {
+        close();
+        s = socket;
+    }
+
+    void close() {
+        if (open()) closeSocket(s);
+        s = INVALID_SOCKET_HANDLE;
+    }
+
+    bool send(uint32_t type, const void* data, size_t size) {
+        MessageHeader header = {type, uint32_t(size)};
+        if (!sendAll(&header, sizeof(header)) || !sendAll(data, size)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // 等待 timeoutMs 毫秒，返回是否有数据可读（连接断开时也返回 true，随后的 receive 会失败）
+    bool poll(int timeoutMs) const {
+        if (!open()) return false;
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(s, &readable);
+        timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        return select(int(s) + 1, &readable, nullptr, nullptr, &timeout) > 0;
+    }
+
+    // 阻塞读取一条完整的消息；类型未知或长度超过该类型上限时断开连接
+    bool receive(uint32_t& type, std::vector<unsigned char>& payload) {
+        MessageHeader header;
+        if (!receiveAll(&header, sizeof(header)) || header.size > maxMessageSize(header.type)) {
+            close();
+            return false;
+        }
+        type = header.type;
+        payload.resize(header.size);
+        if (!receiveAll(payload.data(), header.size)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    SocketHandle s = INVALID_SOCKET_HANDLE;
+
+    bool sendAll(const void* data, size_t size) {
+        const char* p = (const char*)data;
+        while (size > 0) {
+            int n = ::send(s, p, int(std::min<size_t>(size, 1 << 20)), 0);
+            if (n <= 0) return false;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool receiveAll(void* data, size_t size) {
+        char* p = (char*)data;
+        while (size > 0) {
+            int n = ::recv(s, p, int(std::min<size_t>(size, 1 << 20)), 0);
+            if (n <= 0) return false;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+};
+
+// 行程编码：控制字节 c < 128 表示其后 1 个像素重复 c + 1 次，c >= 128 表示其后 c - 127 个像素原样保存
+inline void encodeRuns(const unsigned char* pixels, int count, std::vector<unsigned char>& out) {
+    auto same = [&](int a, int b) { return std::memcmp(pixels + a * 3, pixels + b * 3, 3) == 0; };
+    int i = 0;
+    while (i < count) {
+        int run = 1;
+        while (i + run < count && run < 128 && same(i, i + run)) ++run;
+        if (run >= 2) {
+            out.push_back((unsigned char)(run - 1));
+            out.insert(out.end(), pixels + i * 3, pixels + i * 3 + 3);
+            i += run;
+            continue;
+        }
+        // 原样段延伸到下一个长度至少为 2 的重复段之前
+        int literal = 1;
+        while (i + literal < count && literal < 128 && !(i + literal + 1 < count && same(i + literal, i + literal + 1))) ++literal;
+        out.push_back((unsigned char)(127 + literal));
+        out.insert(out.end(), pixels + i * 3, pixels + (i + literal) * 3);
+        i += literal;
+    }
+}
+
+// 解码 count 个像素，返回消耗的字节数；数据不完整时返回 0
+inline size_t decodeRuns(const unsigned char* data, size_t size, unsigned char* pixels, int count) {
+    size_t p = 0;
+    int i = 0;
+    while (i < count) {
+        if (p >= size) return 0;
+        int c = data[p++];
+        int n = c < 128 ? c + 1 : c - 127;
+        size_t bytes = c < 128 ? 3 : size_t(n) * 3;
+        if (i + n > count || p + bytes > size) return 0;
+        for (int k = 0; k < n; ++k)
+            std::memcpy(pixels + (i + k) * 3, data + p + (c < 128 ? 0 : k * 3), 3);
+        p += bytes;
+        i += n;
+    }
+    return p;
+}
+
+// 渲染机一侧：记住查看端当前的画面，每帧只编码有变化的 tile
+class TileDeltaEncoder {
+public:
+    size_t rawBytes = 0, encodedBytes = 0; // 累计的原始像素字节数和发送的字节数
+
+    // 把 pixels 与查看端已有的画面比较，编码为一条 MESSAGE_FRAME 的消息体，返回发送的 tile 数
+    int encode(const PixelBuffer& pixels, int width, int height, uint32_t frame, std::vector<unsigned char>& out) {
+        if (width != this->width || height != this->height) {
+            // 尺寸变化后按全黑画面计算差异，并通知查看端先清零（它缩放后的画面内容未定义）
+            this->width = width;
+            this->height = height;
+            sent.assign(size_t(width) * height * 3, 0);
+            keyframe = true;
+        }
+        TileGrid grid(width, height);
+        out.resize(sizeof(FrameHeader));
+        int tileCount = 0;
+        uint32_t flags = 0;
+        if (keyframe) {
+            keyframe = false;
+            flags |= FRAME_KEYFRAME;
+        }
+        for (int tile = 0; tile < grid.count(); ++tile) {
+            int x0, y0, x1, y1;
+            grid.bounds(tile, x0, y0, x1, y1);
+            int tileWidth = x1 - x0, count = tileWidth * (y1 - y0);
+            delta.resize(size_t(count) * 3);
+            unsigned char changed = 0;
+            for (int y = y0; y < y1; ++y) {
+                size_t row = (size_t(y) * width + x0) * 3;
+                unsigned char* d = delta.data() + size_t(y - y0) * tileWidth * 3;
+                for (int k = 0; k < tileWidth * 3; ++k) {
+                    d[k] = pixels[row + k] ^ sent[row + k];
+                    changed |= d[k];
+                }
+            }
+            if (!changed) continue;
+
+            size_t headerAt = out.size();
+            out.resize(headerAt + sizeof(TileHeader));
+            encodeRuns(delta.data(), count, out);
+            TileHeader header = {uint32_t(tile), uint32_t(out.size() - headerAt - sizeof(TileHeader))};
+            std::memcpy(out.data() + headerAt, &header, sizeof(header));
+            for (int y = y0; y < y1; ++y) {
+                size_t row = (size_t(y) * width + x0) * 3;
+                std::memcpy(sent.data() + row, pixels.data() + row, size_t(tileWidth) * 3);
+            }
+            tileCount++;
+        }
+        FrameHeader header = {uint32_t(width), uint32_t(height), frame, uint32_t(tileCount), flags};
+        std::memcpy(out.data(), &header, sizeof(header));
+        rawBytes += size_t(width) * height * 3;
+        encodedBytes += out.size() + sizeof(MessageHeader);
+        return tileCount;
+    }
+
+    // 查看端重新连接或画面丢失时，下一帧整帧发送
+    void reset() {
+        width = height = 0;
+    }
+
+private:
+    int width = 0, height = 0;
+    bool keyframe = false;
+    PixelBuffer sent;
+    std::vector<unsigned char> delta;
+};
+
+// 查看端一侧：把收到的 tile 差异异或到本地画面上。尺寸与本地画面不一致的帧（窗口尺寸刚变化）被丢弃
+inline bool applyFrame(const std::vector<unsigned char>& payload, PixelBuffer& pixels, int width, int height) {
+    if (payload.size() < sizeof(FrameHeader)) return false;
+    FrameHeader header;
+    std::memcpy(&header, payload.data(), sizeof(header));
+    if (int(header.width) != width || int(header.height) != height) return false;
+    if (header.flags & FRAME_KEYFRAME) std::fill(pixels.begin(), pixels.begin() + size_t(width) * height * 3, 0);
+
+    TileGrid grid(width, height);
+    std::vector<unsigned char> delta(TILE_SIZE * TILE_SIZE * 3);
+    size_t p = sizeof(FrameHeader);
+    for (uint32_t t = 0; t < header.tileCount; ++t) {
+        TileHeader tile;
+        if (p + sizeof(tile) > payload.size()) return false;
+        std::memcpy(&tile, payload.data() + p, sizeof(tile));
+        p += sizeof(tile);
+        if (int(tile.tile) >= grid.count() || p + tile.size > payload.size()) return false;
+        int x0, y0, x1, y1;
+        grid.bounds(tile.tile, x0, y0, x1, y1);
+        int tileWidth = x1 - x0;
+        if (decodeRuns(payload.data() + p, tile.size, delta.data(), tileWidth * (y1 - y0)) != tile.size) return false;
+        p += tile.size;
+        for (int y = y0; y < y1; ++y) {
+            unsigned char* row = pixels.data() + (size_t(y) * width + x0) * 3;
+            const unsigned char* d = delta.data() + size_t(y - y0) * tileWidth * 3;
+            for (int k = 0; k < tileWidth * 3; ++k) row[k] ^= d[k];
+        }
+    }
+    return true;
+}
+#endif
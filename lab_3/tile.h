@@ -0,0 +1,358 @@
+#ifndef TILE_H
+#define TILE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "object.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+const int TILE_SIZE = 32;
+
+// 屏幕被划分为 TILE_SIZE x TILE_SIZE 的块，tile 是渲染和缓存的最小单位
+struct TileGrid {
+    int width = 0, height = 0;
+    int tilesX = 0, tilesY = 0;
+
+    TileGrid() {}
+    TileGrid(int width, int height)
+        : width(width), height(height),
+          tilesX((width + TILE_SIZE - 1) / TILE_SIZE),
+          tilesY((height + TILE_SIZE - 1) / TILE_SIZE) {}
+
+    int count() const { return tilesX * tilesY; }
+
+    // tile 覆盖的像素范围 [x0, x1) x [y0, y1)
+    void bounds(int tile, int& x0, int& y0, int& x1, int& y1) const {
+        x0 = (tile % tilesX) * TILE_SIZE;
+        y0 = (tile / tilesX) * TILE_SIZE;
+        x1 = std::min(x0 + TILE_SIZE, width);
+        y1 = std::min(y0 + TILE_SIZE, height);
+    }
+};
+
+// 连续像素坐标下的屏幕矩形
+struct ScreenRect {
+    float x0, y0, x1, y1;
+
+    bool empty() const { return x0 > x1 || y0 > y1; }
+
+    static ScreenRect none() { return {1.0f, 1.0f, 0.0f, 0.0f}; }
+    static ScreenRect full() {
+        float inf = std::numeric_limits<float>::max();
+        return {-inf, -inf, inf, inf};
+    }
+
+    ScreenRect merge(const ScreenRect& o) const {
+        if (empty()) return o;
+        if (o.empty()) return *this;
+        return {std::min(x0, o.x0), std::min(y0, o.y0), std::max(x1, o.x1), std::max(y1, o.y1)};
+    }
+
+    ScreenRect clip(const ScreenRect& o) const {
+        return {std::max(x0, o.x0), std::max(y0, o.y0), std::min(x1, o.x1), std::min(y1, o.y1)};
+    }
+};
+
+// 物体的影响体，用若干点的凸包表示；阴影区域和镜像都能保守地写成这种形式
+typedef std::vector<glm::vec3> Influence;
+
+// 包围球的外接立方体的 8 个角点
+inline void addSphereCorners(Influence& hull, const BoundingSphere& s) {
+    for (int i = 0; i < 8; ++i)
+        hull.push_back(s.center + s.radius * glm::vec3(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1));
+}
+
+// 凸包在屏幕上的保守投影。凸包被近平面截断时，截断后的凸包等于前方各点
+// 加上每条前后点连线与近平面的交点所构成的凸包
+inline ScreenRect projectHull(const CameraFrame& frame, const Influence& hull) {
+    const float nearZ = 1e-3f;
+    std::vector<glm::vec3> front, back;
+    for (const auto& p : hull)
+        (glm::dot(p - frame.position, frame.forward) >= nearZ ? front : back).push_back(p);
+
+    std::vector<glm::vec3> clipped = front;
+    for (const auto& f : front) {
+        float zf = glm::dot(f - frame.position, frame.forward);
+        for (const auto& b : back) {
+            float zb = glm::dot(b - frame.position, frame.forward);
+            clipped.push_back(glm::mix(f, b, (zf - nearZ) / (zf - zb)));
+        }
+    }
+
+    ScreenRect rect = ScreenRect::none();
+    for (const auto& p : clipped) {
+        glm::vec3 q = frame.project(p);
+        rect = rect.merge({q.x, q.y, q.x, q.y});
+    }
+    if (rect.empty()) return rect;
+    // 留 1 像素余量，覆盖像素中心采样带来的取整误差
+    return {rect.x0 - 1.0f, rect.y0 - 1.0f, rect.x1 + 1.0f, rect.y1 + 1.0f};
+}
+
+// 屏幕矩形覆盖的 tile 范围 [tx0, tx1] x [ty0, ty1]，矩形完全在画面之外时返回 false
+inline bool tileSpan(const TileGrid& grid, const ScreenRect& r, int& tx0, int& ty0, int& tx1, int& ty1) {
+    if (r.empty()) return false;
+    tx0 = std::max(0, int(std::floor(std::max(r.x0, -1.0f) / TILE_SIZE)));
+    ty0 = std::max(0, int(std::floor(std::max(r.y0, -1.0f) / TILE_SIZE)));
+    tx1 = std::min(grid.tilesX - 1, int(std::floor(std::min(r.x1, float(grid.width)) / TILE_SIZE)));
+    ty1 = std::min(grid.tilesY - 1, int(std::floor(std::min(r.y1, float(grid.height)) / TILE_SIZE)));
+    return tx0 <= tx1 && ty0 <= ty1;
+}
+
+// 一个 tile 的主光线候选物体及其屏幕投影
+struct TileCandidates {
+    const Object* const* objects;
+    const ScreenRect* rects;
+    size_t count;
+};
+
+// 主光线的分块候选表：每帧把各物体凸包的屏幕投影分到它覆盖的 tile 中，
+// tile 内的主光线只与本 tile 的候选物体求交，不被任何物体覆盖的 tile（天空）不做求交。
+// 候选按物体在场景中的顺序排列，结果与逐个遍历全部物体相同。
+// 每个 tile 要逐个测试候选，物体很多时不如网格等加速结构，只在物体较少时使用
+struct TileBins {
+    std::vector<int> start;                 // 第 i 个 tile 的候选为 objects[start[i], start[i + 1])
+    std::vector<const Object*> objects;
+    std::vector<ScreenRect> rects;          // 与 objects 一一对应，供光栅化可见性阶段裁剪像素范围
+
+    void build(const std::vector<Object*>& sceneObjects, const CameraFrame& frame, const TileGrid& grid) {
+        // 先求各物体覆盖的 tile 范围并计数，再按物体顺序填入，与 binRays 相同的计数排序
+        std::vector<glm::ivec4> spans(sceneObjects.size(), glm::ivec4(0, 0, -1, -1));
+        std::vector<ScreenRect> objectRects(sceneObjects.size());
+        start.assign(grid.count() + 1, 0);
+        Influence hull;
+        for (size_t i = 0; i < sceneObjects.size(); ++i) {
+            hull.clear();
+            sceneObjects[i]->convexHull(hull);
+            objectRects[i] = projectHull(frame, hull);
+            glm::ivec4& s = spans[i];
+            if (!tileSpan(grid, objectRects[i], s.x, s.y, s.z, s.w)) continue;
+            for (int ty = s.y; ty <= s.w; ++ty)
+                for (int tx = s.x; tx <= s.z; ++tx)
+                    start[ty * grid.tilesX + tx + 1]++;
+        }
+        for (int t = 0; t < grid.count(); ++t) start[t + 1] += start[t];
+
+        objects.resize(start[grid.count()]);
+        rects.resize(start[grid.count()]);
+        std::vector<int> fill(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < sceneObjects.size(); ++i) {
+            const glm::ivec4& s = spans[i];
+            for (int ty = s.y; ty <= s.w; ++ty)
+                for (int tx = s.x; tx <= s.z; ++tx) {
+                    int k = fill[ty * grid.tilesX + tx]++;
+                    objects[k] = sceneObjects[i];
+                    rects[k] = objectRects[i];
+                }
+        }
+    }
+
+    TileCandidates candidates(int tile) const {
+        return {objects.data() + start[tile], rects.data() + start[tile], size_t(start[tile + 1] - start[tile])};
+    }
+
+    int emptyTiles() const {
+        int count = 0;
+        for (size_t t = 0; t + 1 < start.size(); ++t) count += start[t + 1] == start[t];
+        return count;
+    }
+};
+
+// 本帧相对上一帧的变化类型
+enum SceneChange {
+    CHANGE_NONE,
+    CHANGE_OBJECTS,     // 只有物体被修改
+    CHANGE_CAMERA,      // 只有相机移动，场景与光照不变
+    CHANGE_ALL,         // 光源、画面尺寸等变化，或首次渲染
+};
+
+// 记录上一帧的场景快照，根据本帧的修改算出需要重新追踪的 tile
+// 相机、光源或画面尺寸变化时整帧重绘；物体被修改时，只重绘其新旧包围球、
+// 投下的阴影以及它们在各反射体中的像所覆盖的 tile，其余 tile 保留上一帧的结果
+class DirtyTracker {
+public:
+    int maxDepth = 3; // 与 trace() 的递归深度一致，决定需要追踪几级反射
+    SceneChange lastChange = CHANGE_NONE; // 最近一次 collect() 检测到的变化
+
+    // 标记物体在本帧被修改；旧的包围球取自上一帧的快照，因此修改前后调用均可
+    void touch(const Object* object) {
+        touched.push_back(object);
+    }
+
+    void invalidateAll() {
+        valid = false;
+    }
+
+    // 返回本帧需要重新追踪的 tile 编号，并把当前场景记为新的快照
+    std::vector<int> collect(const std::vector<Object*>& objects, const Camera& camera, const Light& light, int width, int height) {
+        TileGrid grid(width, height);
+        std::vector<int> tiles;
+
+        bool sceneChanged = !valid || width != lastWidth || height != lastHeight ||
+                            objects.size() != lastBounds.size() ||
+                            std::memcmp(&light, &lastLight, sizeof(Light)) != 0;
+        bool cameraChanged = std::memcmp(&camera, &lastCamera, sizeof(Camera)) != 0;
+        bool full = sceneChanged || cameraChanged;
+
+        if (sceneChanged || (cameraChanged && !touched.empty())) lastChange = CHANGE_ALL;
+        else if (cameraChanged) lastChange = CHANGE_CAMERA;
+        else if (!touched.empty()) lastChange = CHANGE_OBJECTS;
+        else lastChange = CHANGE_NONE;
+
+        if (full) {
+            for (int i = 0; i < grid.count(); ++i) tiles.push_back(i);
+        } else if (!touched.empty()) {
+            CameraFrame frame(camera, width, height);
+            std::vector<char> dirty(grid.count(), 0);
+
+            // 被修改物体的新旧包围球及其阴影锥
+            std::vector<Influence> sources;
+            for (size_t i = 0; i < objects.size(); ++i) {
+                if (std::find(touched.begin(), touched.end(), objects[i]) == touched.end()) continue;
+                addSources(sources, lastBounds[i], objects[i], objects, light);
+                addSources(sources, objects[i]->bounds(), objects[i], objects, light);
+            }
+
+            markInfluences(dirty, grid, frame, sources, objects);
+
+            for (int i = 0; i < grid.count(); ++i)
+                if (dirty[i]) tiles.push_back(i);
+        }
+
+        valid = true;
+        lastWidth = width;
+        lastHeight = height;
+        lastCamera = camera;
+        lastLight = light;
+        lastBounds.clear();
+        for (const auto* object : objects) lastBounds.push_back(object->bounds());
+        touched.clear();
+        return tiles;
+    }
+
+private:
+    bool valid = false;
+    int lastWidth = 0, lastHeight = 0;
+    Camera lastCamera;
+    Light lastLight;
+    std::vector<BoundingSphere> lastBounds;
+    std::vector<const Object*> touched;
+
+    // 物体本身，加上它投在其余物体上的阴影
+    static void addSources(std::vector<Influence>& sources, const BoundingSphere& s, const Object* self,
+                           const std::vector<Object*>& objects, const Light& light) {
+        Influence body;
+        addSphereCorners(body, s);
+        sources.push_back(body);
+
+        glm::vec3 toObject = s.center - light.position;
+        float d = glm::length(toObject);
+        if (d <= s.radius || light.shape != LIGHT_POINT) {
+            // 光源在包围球内，或者是面光源（半影比点光源的阴影锥宽），阴影可能落在任何物体上
+            for (const auto* object : objects) {
+                Influence hull;
+                object->convexHull(hull);
+                sources.push_back(hull);
+            }
+            return;
+        }
+        glm::vec3 axis = toObject / d;
+        float tanHalf = s.radius / glm::sqrt(d * d - s.radius * s.radius);
+
+        for (const auto* receiver : objects) {
+            if (receiver == self) continue;
+            Influence shadow;
+            glm::vec3 p, n;
+            if (receiver->mirrorPlane(p, n)) {
+                // 平面接收体：阴影落在从光源看去的轮廓圆（取其外切八边形）在平面上的中心投影之内
+                glm::vec3 u = glm::normalize(glm::cross(axis, glm::abs(axis.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0)));
+                glm::vec3 v = glm::cross(axis, u);
+                glm::vec3 rimCenter = light.position + axis * (d - s.radius * s.radius / d);
+                float rimRadius = s.radius * glm::sqrt(d * d - s.radius * s.radius) / d / glm::cos(glm::pi<float>() / 8);
+                bool beyond = false, unbounded = false;
+                for (int i = 0; i < 8; ++i) {
+                    float a = i * glm::pi<float>() / 4;
+                    glm::vec3 c = rimCenter + rimRadius * (glm::cos(a) * u + glm::sin(a) * v);
+                    float denom = glm::dot(c - light.position, n);
+                    float k = glm::abs(denom) > 1e-6f ? glm::dot(p - light.position, n) / denom : -1.0f;
+                    if (k <= 0.0f) { unbounded = true; break; }
+                    if (k >= 1.0f) beyond = true;
+                    shadow.push_back(light.position + k * (c - light.position));
+                }
+                if (!unbounded && !beyond) continue; // 平面整个位于光源和物体之间
+                if (unbounded) {
+                    // 投影发散到无穷远，退化为整个接收体
+                    shadow.clear();
+                    receiver->convexHull(shadow);
+                }
+            } else {
+                // 其他接收体：阴影既在接收体内，也在阴影锥与接收体包围球轴向范围重叠的一段内，取较小者
+                BoundingSphere b = receiver->bounds();
+                float tr = glm::dot(b.center - light.position, axis);
+                float t0 = glm::max(d - s.radius, tr - b.radius), t1 = tr + b.radius;
+                if (t1 < t0) continue;
+                float lateral = glm::length(b.center - light.position - tr * axis);
+                if (lateral - b.radius > s.radius + t1 * tanHalf) continue;
+                if (b.radius <= s.radius + t1 * tanHalf) {
+                    receiver->convexHull(shadow);
+                } else {
+                    addSphereCorners(shadow, {light.position + axis * t0, s.radius + t0 * tanHalf});
+                    addSphereCorners(shadow, {light.position + axis * t1, s.radius + t1 * tanHalf});
+                }
+            }
+            sources.push_back(shadow);
+        }
+    }
+
+    static Influence mirror(const Influence& inf, const glm::vec3& p, const glm::vec3& n) {
+        Influence m = inf;
+        for (auto& q : m) q -= 2.0f * glm::dot(q - p, n) * n;
+        return m;
+    }
+
+    static void markRect(std::vector<char>& dirty, const TileGrid& grid, const ScreenRect& r) {
+        int tx0, ty0, tx1, ty1;
+        if (!tileSpan(grid, r, tx0, ty0, tx1, ty1)) return;
+        for (int ty = ty0; ty <= ty1; ++ty)
+            for (int tx = tx0; tx <= tx1; ++tx)
+                dirty[ty * grid.tilesX + tx] = 1;
+    }
+
+    void markInfluences(std::vector<char>& dirty, const TileGrid& grid, const CameraFrame& frame,
+                        const std::vector<Influence>& sources, const std::vector<Object*>& objects) const {
+        // 直接可见的部分
+        for (const auto& inf : sources) markRect(dirty, grid, projectHull(frame, inf));
+
+        // 逐级反射：平面镜中的像是影响体关于镜面的对称体，且只会出现在镜面的投影范围内；
+        // 曲面反射体里的像无法简单表示，但一定出现在反射体自身的投影范围内，
+        // 下一级反射中用反射体自身的包围球代替它里面的像
+        std::vector<Influence> level = sources;
+        for (int depth = 1; depth <= maxDepth && !level.empty(); ++depth) {
+            std::vector<Influence> next;
+            for (const auto* object : objects) {
+                if (!object->reflective()) continue;
+                Influence reflector;
+                object->convexHull(reflector);
+                ScreenRect reflectorRect = projectHull(frame, reflector);
+                glm::vec3 p, n;
+                if (object->mirrorPlane(p, n)) {
+                    for (const auto& inf : level) {
+                        Influence image = mirror(inf, p, n);
+                        markRect(dirty, grid, projectHull(frame, image).clip(reflectorRect));
+                        next.push_back(image);
+                    }
+                } else {
+                    markRect(dirty, grid, reflectorRect);
+                    next.push_back(reflector);
+                }
+            }
+            level.swap(next);
+        }
+    }
+};
+#endif
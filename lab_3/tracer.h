@@ -0,0 +1,280 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <glm/glm.hpp>
+
+#include "object.h"
+#include "accel.h"
+#include "material.h"
+#include "tile.h"
+#include "raster.h"
+#include "placement.h"
+#include "schedule.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+
+const int MAX_DEPTH = 3; // 最大反射深度
+
+// 渲染选项，可在控制面板和命令行中修改
+struct RenderSettings {
+    bool binSecondaryRays = true;   // 次级光线先按起点区域和方向卦限分组，再逐组追踪
+    bool binPrimaryRays = true;     // 物体较少时主光线只与所在 tile 的候选物体求交，见 TileBins
+    int maxBinnedObjects = 32;      // 超过这个物体数时主光线仍走加速结构
+    bool rasterPrimary = false;     // 主光线的第一个交点由 raster.h 中的光栅化可见性阶段得到
+    PlacementPolicy placement = PLACEMENT_NONE; // 渲染线程的绑定方式
+    int threads = 0;                // 渲染线程数上限，0 表示由放置策略决定
+    float frameBudgetMs = 0.0f;     // 每帧的渲染时间预算，0 表示不限；超时后剩下的 tile 留到下一帧，见 schedule.h
+};
+RenderSettings renderSettings;
+
+// 把一个 tile 的次级光线按方向卦限和起点所在区域做计数排序。
+// 同一组内的光线从相近位置出发、朝相近方向前进，会访问相同的格子和物体，
+// 逐组追踪时缓存命中率更高
+void binRays(std::vector<PathRay>& wave) {
+    const int REGIONS = 4; // 每个轴上的起点区域数
+    const int BINS = 8 * REGIONS * REGIONS * REGIONS;
+    thread_local std::vector<PathRay> sorted;
+    thread_local std::vector<unsigned short> keys;
+
+    AABB box;
+    for (const auto& path : wave) box.expand(toVec3(path.ray.origin));
+    glm::vec3 scale = float(REGIONS) / glm::max(box.max - box.min, glm::vec3(1e-6f));
+
+    int start[BINS + 1] = {0};
+    keys.resize(wave.size());
+    for (size_t i = 0; i < wave.size(); ++i) {
+        const Ray& ray = wave[i].ray;
+        int octant = (ray.direction.x < 0) | (ray.direction.y < 0) << 1 | (ray.direction.z < 0) << 2;
+        glm::ivec3 r = glm::min(glm::ivec3((toVec3(ray.origin) - box.min) * scale), glm::ivec3(REGIONS - 1));
+        keys[i] = (unsigned short)(((octant * REGIONS + r.z) * REGIONS + r.y) * REGIONS + r.x);
+        start[keys[i] + 1]++;
+    }
+    for (int b = 0; b < BINS; ++b) start[b + 1] += start[b];
+
+    sorted.resize(wave.size());
+    for (size_t i = 0; i < wave.size(); ++i) sorted[start[keys[i]]++] = wave[i];
+    wave.swap(sorted);
+}
+
+// 把一层命中按材质分组，每组交给对应的着色核一次处理完，反射光线放入 next
+void shadeHits(std::vector<HitRecord>& hits, const Accel& accel, const Light& light, vec3a* colors, std::vector<PathRay>& next) {
+    thread_local std::vector<HitRecord> grouped;
+
+    // 按材质做计数排序
+    int start[MATERIAL_COUNT + 1] = {0};
+    for (const auto& h : hits) start[h.object->material + 1]++;
+    for (int m = 0; m < MATERIAL_COUNT; ++m) start[m + 1] += start[m];
+    grouped.resize(hits.size());
+    int fill[MATERIAL_COUNT];
+    std::copy(start, start + MATERIAL_COUNT, fill);
+    for (const auto& h : hits) grouped[fill[h.object->material]++] = h;
+
+    // 每种材质整组着色
+    next.clear();
+    for (int m = 0; m < MATERIAL_COUNT; ++m)
+        if (start[m + 1] > start[m])
+            shadeKernels[m](grouped.data() + start[m], start[m + 1] - start[m], accel, light, colors, next);
+}
+
+// 以波前方式追踪一批光线：每一层先对整批光线求交，再把命中按材质分组着色，
+// 反射光线组成下一层的波前
+// primaryHits 非空时记录第一层的命中，供 G-buffer 使用；primary 非空时第一层只与其中的候选物体求交
+void traceWave(std::vector<PathRay>& wave, const Accel& accel, const Light& light, vec3a* colors, int depth = 0,
+               std::vector<HitRecord>* primaryHits = nullptr, const TileCandidates* primary = nullptr) {
+    thread_local std::vector<HitRecord> hits;
+    thread_local std::vector<PathRay> next;
+
+    for (int first = depth; depth <= MAX_DEPTH && !wave.empty(); ++depth) {
+        // 主光线本来就按像素顺序排列，只对反射产生的次级光线分组
+        if (depth > 0 && renderSettings.binSecondaryRays) binRays(wave);
+
+        // 求交，未命中的光线贡献背景颜色（环境贴图，未开启时为黑色）
+        hits.clear();
+        for (const auto& path : wave) {
+            tracedRays++;
+            Hit hit;
+            bool found = primary && depth == first ? intersectObjects(primary->objects, primary->count, path.ray, hit)
+                                                   : accel.intersect(path.ray, hit);
+            if (!found) {
+                if (environment.enabled)
+                    colors[path.pixel] += path.weight * toAligned(environment.radiance(toVec3(path.ray.direction), path.lod));
+                continue;
+            }
+            hits.push_back({path.ray.origin + hit.t * path.ray.direction, hit.normal, path.ray.direction,
+                            path.weight, hit.object, path.pixel, path.lod});
+        }
+
+        if (primaryHits && depth == first) *primaryHits = hits;
+
+        shadeHits(hits, accel, light, colors, next);
+        wave.swap(next);
+    }
+    wave.clear();
+}
+
+// 追踪单条光线，depth 为起始深度
+glm::vec3 trace(const Ray& ray, const Accel& accel, const Light& light, int depth) {
+    std::vector<PathRay> wave = {{ray, vec3a(1.0f), 0}};
+    vec3a color(0.0f);
+    traceWave(wave, accel, light, &color, depth);
+    return toVec3(color);
+}
+
+// 主光线的命中信息（G-buffer），供时域重投影等复用上一帧的结果
+struct GBuffer {
+    int width = 0, height = 0;
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec3> normal;
+    std::vector<char> hit;      // 主光线是否命中物体
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        position.assign(w * h, glm::vec3(0.0f));
+        normal.assign(w * h, glm::vec3(0.0f));
+        hit.assign(w * h, 0);
+    }
+};
+
+// 渲染单个 tile 的函数：整个 tile 的主光线作为一个波前。
+// mask 非空时只追踪 mask 为 1 的像素，其余像素保留原值；bins 非空时主光线只与本 tile 的候选物体求交，
+// 开启 rasterPrimary 时改为光栅化这些候选物体得到第一层命中，只追踪阴影和反射光线
+void renderTile(PixelBuffer& pixelBuffer, int tile, const TileGrid& grid, const CameraFrame& frame, const Accel& accel, const Light& light,
+                GBuffer* gbuffer, const std::vector<char>* mask, const TileBins* bins = nullptr) {
+    int x0, y0, x1, y1;
+    grid.bounds(tile, x0, y0, x1, y1);
+    int tileWidth = x1 - x0;
+
+    thread_local std::vector<PathRay> wave;
+    thread_local std::vector<vec3a> colors;
+    thread_local std::vector<HitRecord> primaryHits;
+    wave.clear();
+    colors.assign(tileWidth * (y1 - y0), vec3a(0.0f));
+
+    TileCandidates candidates;
+    if (bins) candidates = bins->candidates(tile);
+    if (bins && renderSettings.rasterPrimary) {
+        thread_local TileVisibility visibility;
+        rasterizeTile(primaryHits, visibility, frame, candidates, x0, y0, x1, y1, mask);
+        if (environment.enabled) {
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x) {
+                    int i = (y - y0) * tileWidth + (x - x0);
+                    if ((!mask || (*mask)[y * grid.width + x]) && !visibility.object[i])
+                        colors[i] += toAligned(environment.radiance(toVec3(visibility.direction[i])));
+                }
+        }
+        shadeHits(primaryHits, accel, light, colors.data(), wave);
+        traceWave(wave, accel, light, colors.data(), 1);
+    } else {
+        for (int y = y0; y < y1; ++y)
+            for (int x = x0; x < x1; ++x)
+                if (!mask || (*mask)[y * grid.width + x])
+                    wave.push_back({frame.primaryRay(x + 0.5f, y + 0.5f), vec3a(1.0f), (y - y0) * tileWidth + (x - x0)});
+        if (wave.empty()) return;
+        traceWave(wave, accel, light, colors.data(), 0, gbuffer ? &primaryHits : nullptr, bins ? &candidates : nullptr);
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            if (mask && !(*mask)[y * grid.width + x]) continue;
+            const vec3a& color = colors[(y - y0) * tileWidth + (x - x0)];
+
+            // 每个 tile 只由一个线程写入，不需要加锁
+            int index = (y * grid.width + x) * 3;
+            pixelBuffer[index] = static_cast<unsigned char>(glm::clamp(color.r, 0.0f, 1.0f) * 255);
+            pixelBuffer[index + 1] = static_cast<unsigned char>(glm::clamp(color.g, 0.0f, 1.0f) * 255);
+            pixelBuffer[index + 2] = static_cast<unsigned char>(glm::clamp(color.b, 0.0f, 1.0f) * 255);
+            if (gbuffer) gbuffer->hit[y * grid.width + x] = 0;
+        }
+    }
+
+    if (gbuffer) {
+        for (const auto& h : primaryHits) {
+            int index = (y0 + h.pixel / tileWidth) * grid.width + x0 + h.pixel % tileWidth;
+            gbuffer->position[index] = toVec3(h.point);
+            gbuffer->normal[index] = toVec3(h.normal);
+            gbuffer->hit[index] = 1;
+        }
+    }
+}
+
+// 多线程渲染函数：各线程从 tiles 中依次领取 tile，未列出的 tile 保留 pixelBuffer 中的旧结果。
+// gbuffer 非空时同时写入主光线命中信息，mask 非空时只追踪其中标记的像素，
+// bins 非空时为本帧相机建立的主光线候选表。
+// unfinished 非空且设置了 frameBudgetMs 时，所有线程按 tiles 的顺序（优先级从高到低）领取，
+// 超过预算后不再领取新的 tile（每个线程至少完成一个），没有渲染的 tile 写入 unfinished
+void renderScene(PixelBuffer& pixelBuffer, int width, int height, const Camera& camera, const Light& light, const Accel& accel, const std::vector<int>& tiles,
+                 GBuffer* gbuffer = nullptr, const std::vector<char>* mask = nullptr, const TileBins* bins = nullptr,
+                 std::vector<int>* unfinished = nullptr) {
+    std::vector<WorkerSlot> workers = planWorkers(renderSettings.placement, renderSettings.threads);
+    if (workers.size() > tiles.size()) workers.resize(tiles.size());
+    TileGrid grid(width, height);
+    CameraFrame frame(camera, width, height);
+    bool budgeted = unfinished && renderSettings.frameBudgetMs > 0.0f;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(renderSettings.frameBudgetMs);
+    std::vector<char> done(budgeted ? tiles.size() : 0, 0);
+
+    // 每组线程先领取自己那一段连续的 tile，做完后再帮其他组领取剩余的 tile。
+    // 分段按组内线程数的比例划分，未绑定时只有一组，与逐个领取全部 tile 相同。
+    // 有时间预算时只用一组，保证优先级高的 tile 先被领取
+    int groupCount = 0;
+    for (auto& worker : workers) groupCount = budgeted ? 1 : std::max(groupCount, worker.group + 1);
+    std::vector<int> groupThreads(groupCount, 0);
+    for (auto& worker : workers) groupThreads[budgeted ? 0 : worker.group]++;
+    struct TileRange {
+        std::atomic<int> next;
+        int end;
+    };
+    std::unique_ptr<TileRange[]> ranges(new TileRange[groupCount]);
+    for (int g = 0, assigned = 0, begin = 0; g < groupCount; ++g) {
+        assigned += groupThreads[g];
+        int end = workers.empty() ? 0 : int((long long)tiles.size() * assigned / workers.size());
+        ranges[g].next = begin;
+        ranges[g].end = end;
+        begin = end;
+    }
+
+    std::vector<std::thread> threads;
+    for (const auto& worker : workers) {
+        threads.emplace_back([&, worker]() {
+            pinCurrentThread(worker.cpu);
+            for (int i = 0; i < groupCount; ++i) {
+                TileRange& range = ranges[(worker.group + i) % groupCount];
+                for (int k = range.next++; k < range.end; k = range.next++) {
+                    renderTile(pixelBuffer, tiles[k], grid, frame, accel, light, gbuffer, mask, bins);
+                    if (!budgeted) continue;
+                    done[k] = 1;
+                    if (std::chrono::steady_clock::now() >= deadline) break;
+                }
+            }
+            totalRays += tracedRays;
+            tracedRays = 0;
+        });
+    }
+
+    // 等待所有线程完成
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (unfinished) {
+        unfinished->clear();
+        for (size_t k = 0; k < done.size(); ++k)
+            if (!done[k]) unfinished->push_back(tiles[k]);
+    }
+}
+
+// 按 renderSettings 为本帧建立主光线候选表；未开启或物体太多时返回 nullptr，主光线走加速结构。
+// 光栅化可见性阶段按 tile 的候选物体进行，开启时不受物体数限制
+const TileBins* buildTileBins(TileBins& bins, const std::vector<Object*>& objects, const Camera& camera, int width, int height) {
+    bool binned = renderSettings.binPrimaryRays && int(objects.size()) <= renderSettings.maxBinnedObjects;
+    if (!binned && !renderSettings.rasterPrimary) return nullptr;
+    bins.build(objects, CameraFrame(camera, width, height), TileGrid(width, height));
+    return &bins;
+}
+#endif